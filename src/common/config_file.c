@@ -151,6 +151,43 @@ void _set_log_level(struct ledmon_conf *conf, char *s)
 #define BLACKLIST "BLACKLIST="
 #define BLACKLIST_LEN KEYLEN(BLACKLIST)
 
+#define FLUSH_RATE "FLUSH_RATE_"
+#define FLUSH_RATE_LEN KEYLEN(FLUSH_RATE)
+
+/*
+ * Parses the remainder of a FLUSH_RATE_<type>=N line, <type> being a
+ * controller type name understood by led_string_to_cntrl_type().
+ */
+static int _parse_flush_rate(struct ledmon_conf *conf, char *s)
+{
+	enum led_cntrl_type cntrl_type;
+	char *value;
+	int rate;
+
+	value = strchr(s, '=');
+	if (!value)
+		return -1;
+	*value = '\0';
+
+	/* Keys spell a space in the controller name as '_', e.g. DELL_SSD. */
+	for (char *p = s; *p; p++)
+		if (*p == '_')
+			*p = ' ';
+
+	cntrl_type = led_string_to_cntrl_type(s);
+	if (cntrl_type == LED_CNTRL_TYPE_UNKNOWN) {
+		fprintf(stderr, "config file: unknown controller type '%s'.\n", s);
+		return -1;
+	}
+	if (str_toi(&rate, value + 1, NULL, 10) != 0 || rate < 0) {
+		fprintf(stderr, "config file: invalid flush rate for '%s'.\n", s);
+		return -1;
+	}
+
+	conf->flush_rate[cntrl_type] = rate;
+	return 0;
+}
+
 static int parse_next(FILE *fd, struct ledmon_conf *conf)
 {
 	char buf[BUFSIZ];
@@ -211,6 +248,13 @@ static int parse_next(FILE *fd, struct ledmon_conf *conf)
 		conf->rebuild_blink_on_all = parse_bool(s);
 		if (conf->rebuild_blink_on_all < 0)
 			return -1;
+	} else if (!strncmp(s, "VERIFY_SLOTS_PER_CYCLE=", 23)) {
+		s += 23;
+		if (str_toi(&conf->verify_slots, s, NULL, 10) != 0 ||
+		    conf->verify_slots < 0)
+			conf->verify_slots = 0;
+	} else if (!strncmp(s, FLUSH_RATE, FLUSH_RATE_LEN)) {
+		return _parse_flush_rate(conf, s + FLUSH_RATE_LEN);
 	} else if (!strncmp(s, "RAID_MEMBERS_ONLY=", 18)) {
 		s += 18;
 		conf->raid_members_only = parse_bool(s);
@@ -329,6 +373,22 @@ int ledmon_write_shared_conf(struct ledmon_conf *conf)
 		 "REBUILD_BLINK_ON_ALL=%d\n", conf->rebuild_blink_on_all);
 	snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf),
 		 "INTERVAL=%d\n", conf->scan_interval);
+	if (conf->verify_slots)
+		snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf),
+			 "VERIFY_SLOTS_PER_CYCLE=%d\n", conf->verify_slots);
+	for (enum led_cntrl_type ct = LED_CNTRL_TYPE_DELLSSD;
+	     ct <= LED_CNTRL_TYPE_AMD; ct++) {
+		char name[32];
+
+		if (!conf->flush_rate[ct])
+			continue;
+		snprintf(name, sizeof(name), "%s", led_cntrl_type_to_string(ct));
+		for (char *p = name; *p; p++)
+			if (*p == ' ')
+				*p = '_';
+		snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf),
+			 "%s%s=%d\n", FLUSH_RATE, name, conf->flush_rate[ct]);
+	}
 	allowlist = conf_list_to_str(&conf->cntrls_allowlist);
 	if (allowlist) {
 		snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf),
@@ -17,6 +17,7 @@
 #include <led/libled.h>
 
 #define LEDMON_SHARE_MEM_FILE "/ledmon.conf"
+#define LEDMON_SOCKET_FILE "/var/run/ledmon.socket"
 #define LEDMON_DEF_CONF_FILE "/etc/ledmon.conf"
 #define LEDMON_DEF_LOG_FILE "/var/log/ledmon.log"
 #define LEDCTL_DEF_LOG_FILE "/var/log/ledctl.log"
@@ -39,6 +40,21 @@ struct ledmon_conf {
 	/* allowlist and excludelist of controllers for blinking */
 	struct list cntrls_allowlist;
 	struct list cntrls_excludelist;
+
+	/*
+	 * Maximum LED writes per second and controller, indexed by
+	 * controller type, 0 = unthrottled. Set with FLUSH_RATE_<type>=N
+	 * where <type> is a controller name as printed by ledctl --list-controllers,
+	 * e.g. FLUSH_RATE_SCSI=64.
+	 */
+	int flush_rate[LED_CNTRL_TYPE_AMD + 1];
+
+	/*
+	 * Number of slots whose LED state is read back and checked per scan
+	 * cycle, 0 disables the sampled verification. Set with
+	 * VERIFY_SLOTS_PER_CYCLE=N.
+	 */
+	int verify_slots;
 };
 
 int ledmon_read_conf(const char *filename, struct ledmon_conf *conf);
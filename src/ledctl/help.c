@@ -81,6 +81,11 @@ static struct help_option LIST_CTRL_HELP_OPTS[] = {
 	HELP_OPTION_LOG_LEVEL,
 };
 
+static struct help_option BATCH_HELP_OPTS[] = {
+	HELP_OPTION_HELP,
+	HELP_OPTION_LOG_LEVEL,
+};
+
 struct help_mode {
 	enum opt option_id;
 	struct option *opt;
@@ -121,6 +126,13 @@ static struct help_mode modes[] = {
 	HELP_MODE(SET_SLOT,
 		  "Set given state for given slot or device under the given controller.\n"
 		  "Options \"--slot\" and \"--device\" cannot be used simultaneously."),
+
+	HELP_MODE(BATCH,
+		  "Execute slot requests read from given file, \"-\" means standard input.\n"
+		  "Each line holds one request:\n"
+		  "<controller type> slot=<slot id> <pattern>\n"
+		  "<controller type> device=<devnode> <pattern>\n"
+		  "Devices are scanned once and hardware is flushed once for the whole file."),
 };
 
 /**
@@ -286,7 +298,8 @@ static struct help_option GENERAL_HELP_OPTS[] = {
 	{NULL, "Indicate IBPI mode, it is used as default.", &longopt_all[OPT_IBPI]},
 	{NULL, "Display list of controllers recognizable by ledctl.", &longopt_all[OPT_LIST_CTRL]},
 	{NULL, "Print all slots for a controller requested.", &longopt_all[OPT_LIST_SLOTS]},
-	{NULL, "Set state for slot/device by controller requested.", &longopt_all[OPT_SET_SLOT]}
+	{NULL, "Set state for slot/device by controller requested.", &longopt_all[OPT_SET_SLOT]},
+	{NULL, "Execute slot requests read from a file.", &longopt_all[OPT_BATCH]}
 };
 
 /**
@@ -8,13 +8,16 @@
 #include <linux/limits.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <syslog.h>
 #include <time.h>
 #include <unistd.h>
@@ -27,6 +30,7 @@
 
 #include "config.h"
 #include <common/config_file.h>
+#include <lib/hashmap.h>
 #include <lib/utils.h>
 #include <lib/list.h>
 #include <led/libled.h>
@@ -107,6 +111,16 @@ struct ibpi_state {
  */
 static struct list ibpi_list;
 
+/**
+ * @brief Index of requested block devices.
+ *
+ * Maps the canonical path of every device from the command line to the
+ * struct ibpi_state it was requested under. Membership and conflict checks
+ * while parsing hundreds of device arguments are O(1) lookups here instead
+ * of linear walks of the pattern lists. The map does not own its entries.
+ */
+static struct hash_map ledctl_block_map;
+
 enum print_param {
 	PRINT_ALL,
 	PRINT_STATE,
@@ -149,6 +163,11 @@ struct request {
 	 * Slot parameter to be printed on output.
 	 */
 	enum print_param to_print;
+
+	/**
+	 * Path of the batch command file, "-" means standard input.
+	 */
+	char batch_file[PATH_MAX];
 };
 
 static struct led_ctx *ctx;
@@ -162,7 +181,8 @@ static int possible_params_modes[] = {
 	OPT_SET_SLOT,
 	OPT_LIST_SLOTS,
 	OPT_LIST_CTRL,
-	OPT_IBPI
+	OPT_IBPI,
+	OPT_BATCH
 };
 
 static int possible_params_list_ctrl[] = {
@@ -195,10 +215,21 @@ static int possible_params_ibpi[] = {
 	COMMON_GETOPT_ARGS
 };
 
+static int possible_params_batch[] = {
+	COMMON_GETOPT_ARGS
+};
+
 static int listed_only;
 
 static bool test_params;
 
+/**
+ * Connection to the control socket of a running monitor service, -1 when the
+ * daemon is absent. When the connection exists, IBPI requests are forwarded
+ * to the daemon and the full local scan is skipped.
+ */
+static int daemon_fd = -1;
+
 static void ibpi_state_fini(struct ibpi_state *p)
 {
 	list_clear(&p->block_list);
@@ -218,6 +249,7 @@ static void _ledctl_fini(void)
 {
 	led_free(ctx);
 	list_erase(&ibpi_list);
+	hash_map_fini(&ledctl_block_map);
 	log_close(&conf);
 }
 
@@ -295,18 +327,6 @@ static struct ibpi_state *_ibpi_state_get(const char *name)
 	return state;
 }
 
-bool _block_device_search(const struct list *block_list,
-						 const char *path)
-{
-	char *block;
-
-	list_for_each(block_list, block) {
-		if (strcmp(block, path) == 0)
-			return true;
-	}
-	return false;
-}
-
 /**
  * @brief Adds a block device to a block list.
  *
@@ -325,28 +345,43 @@ bool _block_device_search(const struct list *block_list,
 static led_status_t _ibpi_state_add_block(struct ibpi_state *state, char *name)
 {
 	char path[PATH_MAX];
-	led_status_t rc = led_device_name_lookup(ctx, name, path);
+	struct ibpi_state *owner;
+	char *path_copy;
+	led_status_t rc;
 
-	if (rc != LED_STATUS_SUCCESS) {
-		log_error("Could not find %s.", name);
-		return rc;
-	}
+	if (daemon_fd >= 0) {
+		/* The daemon resolves names against its warm context. */
+		str_cpy(path, name, PATH_MAX);
+	} else {
+		rc = led_device_name_lookup(ctx, name, path);
+		if (rc != LED_STATUS_SUCCESS) {
+			log_error("Could not find %s.", name);
+			return rc;
+		}
 
-	if (!led_is_management_supported(ctx, path)) {
-		log_error("%s: device not supported", name);
-		return LED_STATUS_NOT_SUPPORTED;
+		if (!led_is_management_supported(ctx, path)) {
+			log_error("%s: device not supported", name);
+			return LED_STATUS_NOT_SUPPORTED;
+		}
 	}
 
-	if (!_block_device_search(&state->block_list, path)) {
-		char *path_copy = strdup(path);
-
-		if (!path_copy || !list_append(&state->block_list, path_copy)) {
-			free(path_copy);
-			return LED_STATUS_OUT_OF_MEMORY;
-		}
-	} else {
+	owner = hash_map_find(&ledctl_block_map, path);
+	if (owner == state) {
 		log_info("%s: %s: device already on the list.", ibpi2str(state->ibpi), path);
+		return LED_STATUS_SUCCESS;
 	}
+	if (owner) {
+		/* Keep the historic behavior, the pattern listed last wins. */
+		log_warning("%s: device listed under both %s and %s.",
+			    path, ibpi2str(owner->ibpi), ibpi2str(state->ibpi));
+	}
+
+	path_copy = strdup(path);
+	if (!path_copy || !list_append(&state->block_list, path_copy)) {
+		free(path_copy);
+		return LED_STATUS_OUT_OF_MEMORY;
+	}
+	hash_map_insert(&ledctl_block_map, path_copy, state);
 	return LED_STATUS_SUCCESS;
 }
 
@@ -544,6 +579,10 @@ void _cmdline_parse_modes(int argc, char *argv[], struct request *req)
 	case 'I':
 		req->chosen_opt = OPT_IBPI;
 		break;
+	case 'B':
+		req->chosen_opt = OPT_BATCH;
+		strncpy(req->batch_file, optarg, PATH_MAX - 1);
+		break;
 	default:
 		/* It is fair to assume IBPI here, we need to reset option index */
 		optind = 1;
@@ -585,6 +624,10 @@ bool _setup_mode_options(struct request * const req, char **shortopts, struct op
 		setup_options(longopts, shortopts, possible_params_ibpi,
 			      ARRAY_SIZE(possible_params_ibpi));
 		break;
+	case OPT_BATCH:
+		setup_options(longopts, shortopts, possible_params_batch,
+			      ARRAY_SIZE(possible_params_batch));
+		break;
 	case OPT_VERSION:
 	case OPT_HELP:
 	default:
@@ -908,6 +951,264 @@ led_status_t execute_request(struct led_ctx *ctx, struct request *req)
 	}
 }
 
+/**
+ * @brief One parsed line of a batch file, see execute_batch().
+ */
+struct batch_op {
+	struct request req;
+	int line_no;
+};
+
+/**
+ * @brief A per-controller partition of a batch and its worker thread.
+ */
+struct batch_part {
+	struct led_ctx *ctx;
+	struct list ops;
+	pthread_t thread;
+	led_status_t status;
+};
+
+static void *_batch_part_run(void *arg)
+{
+	struct batch_part *part = arg;
+	struct batch_op *op;
+
+	list_for_each(&part->ops, op) {
+		led_status_t rc = verify_request(part->ctx, &op->req);
+
+		if (rc == LED_STATUS_SUCCESS)
+			rc = execute_request(part->ctx, &op->req);
+		if (rc != LED_STATUS_SUCCESS) {
+			log_error("Batch line %d failed: %s.", op->line_no,
+				  ledctl_strstatus(rc));
+			part->status = rc;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Runs the per-controller batch partitions, one thread each.
+ *
+ * Partitions target different controller types and thus disjoint hardware,
+ * so they can proceed concurrently; the whole batch then takes as long as
+ * its slowest controller instead of the sum of all of them. A lone
+ * partition runs on the calling thread, and partitions whose thread could
+ * not be started fall back to it as well.
+ */
+static void _batch_run_parts(struct batch_part **parts, size_t count)
+{
+	size_t started, i;
+
+	if (count == 1) {
+		_batch_part_run(parts[0]);
+		return;
+	}
+
+	for (started = 0; started < count; started++)
+		if (pthread_create(&parts[started]->thread, NULL,
+				   _batch_part_run, parts[started]) != 0)
+			break;
+	for (i = started; i < count; i++)
+		_batch_part_run(parts[i]);
+	for (i = 0; i < started; i++)
+		pthread_join(parts[i]->thread, NULL);
+}
+
+/**
+ * @brief Executes a batch of slot requests from a command file.
+ *
+ * Each non-empty line of the file describes one slot operation:
+ *
+ *	<controller type> slot=<slot id> <ibpi state>
+ *	<controller type> device=<device node> <ibpi state>
+ *
+ * Lines starting with '#' are comments. The device model is scanned once
+ * before this function is called and the hardware is flushed once after
+ * the whole file is processed, so a batch of N updates costs one scan and
+ * one transmission per controller instead of N of each. Operations are
+ * partitioned by controller type and each partition executes on its own
+ * thread, see _batch_run_parts().
+ *
+ * @param[in]       ctx       library context.
+ * @param[in]       req       structure with request, batch_file names the input,
+ *                            "-" means standard input.
+ *
+ * @return LED_STATUS_SUCCESS if all lines succeeded, otherwise the status
+ *         of the last failed line.
+ */
+static led_status_t execute_batch(struct led_ctx *ctx, struct request *req)
+{
+	char line[PATH_MAX], cntrl[PATH_MAX], sel[PATH_MAX], state[PATH_MAX];
+	struct batch_part parts[LED_CNTRL_TYPE_AMD + 1];
+	struct batch_part *run[LED_CNTRL_TYPE_AMD + 1];
+	led_status_t status = LED_STATUS_SUCCESS;
+	int line_no = 0;
+	size_t nparts = 0, i;
+	FILE *file;
+
+	if (strcmp(req->batch_file, "-") == 0)
+		file = stdin;
+	else
+		file = fopen(req->batch_file, "r");
+	if (!file) {
+		log_error("Unable to open batch file '%s'.", req->batch_file);
+		return LED_STATUS_INVALID_PATH;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(parts); i++) {
+		parts[i].ctx = ctx;
+		parts[i].status = LED_STATUS_SUCCESS;
+		list_init(&parts[i].ops, free);
+	}
+
+	while (fgets(line, sizeof(line), file)) {
+		struct batch_op *op;
+		int tokens;
+
+		line_no++;
+		tokens = sscanf(line, " %s %s %s", cntrl, sel, state);
+		/* Blank lines and '#' comments are skipped silently. */
+		if (tokens <= 0 || cntrl[0] == '#')
+			continue;
+		if (tokens != 3) {
+			log_error("Batch line %d malformed, expected 'controller slot=|device= state'.",
+				  line_no);
+			status = LED_STATUS_CMDLINE_ERROR;
+			continue;
+		}
+
+		op = malloc(sizeof(*op));
+		if (!op) {
+			status = LED_STATUS_OUT_OF_MEMORY;
+			break;
+		}
+		request_init(&op->req);
+		op->req.chosen_opt = OPT_SET_SLOT;
+		op->req.cntrl = led_string_to_cntrl_type(cntrl);
+		op->req.state = string2ibpi(state);
+		if (strncmp(sel, "slot=", strlen("slot=")) == 0)
+			strncpy(op->req.slot, sel + strlen("slot="),
+				PATH_MAX - 1);
+		else if (strncmp(sel, "device=", strlen("device=")) == 0)
+			strncpy(op->req.device, sel + strlen("device="),
+				PATH_MAX - 1);
+		op->line_no = line_no;
+
+		if (!list_append(&parts[op->req.cntrl].ops, op)) {
+			free(op);
+			status = LED_STATUS_OUT_OF_MEMORY;
+			break;
+		}
+	}
+
+	if (file != stdin)
+		fclose(file);
+
+	for (i = 0; i < ARRAY_SIZE(parts); i++)
+		if (!list_is_empty(&parts[i].ops))
+			run[nparts++] = &parts[i];
+	if (nparts)
+		_batch_run_parts(run, nparts);
+
+	for (i = 0; i < ARRAY_SIZE(parts); i++) {
+		if (parts[i].status != LED_STATUS_SUCCESS)
+			status = parts[i].status;
+		list_erase(&parts[i].ops);
+	}
+
+	/* One transmission per controller for everything queued above. */
+	led_flush(ctx);
+	return status;
+}
+
+/**
+ * @brief Connects to the control socket of the monitor service.
+ *
+ * This is internal function of ledctl utility. On success the descriptor is
+ * stored in daemon_fd and IBPI requests will be forwarded to the daemon
+ * instead of scanning locally.
+ *
+ * @return true if a running daemon accepted the connection, otherwise false.
+ */
+static bool _daemon_connect(void)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return false;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, LEDMON_SOCKET_FILE, sizeof(addr.sun_path) - 1);
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return false;
+	}
+
+	daemon_fd = fd;
+	return true;
+}
+
+/**
+ * @brief Forwards IBPI requests to the monitor service.
+ *
+ * This is internal function of ledctl utility. The function sends the
+ * requested patterns over the daemon control socket (see ledmon server.h for
+ * the protocol) and waits for the final status line. The daemon applies the
+ * request on its already scanned context, so no local scan is needed.
+ *
+ * @param[in]      ibpi_local_list	    pointer to list of ipbi_state.
+ *
+ * @return LED_STATUS_SUCCESS if successful, otherwise a valid led_status_t.
+ */
+static led_status_t _daemon_execute_ibpi(struct list *ibpi_local_list)
+{
+	char reply[BUFFER_MAX];
+	struct ibpi_state *state;
+	FILE *daemon_conn;
+	char *device;
+	int status;
+
+	daemon_conn = fdopen(daemon_fd, "r+");
+	if (!daemon_conn) {
+		close(daemon_fd);
+		daemon_fd = -1;
+		return LED_STATUS_OUT_OF_MEMORY;
+	}
+	/* The descriptor is owned by the stream now. */
+	daemon_fd = -1;
+
+	if (!listed_only)
+		fputs("OFFALL\n", daemon_conn);
+
+	list_for_each(ibpi_local_list, state)
+		list_for_each(&state->block_list, device)
+			fprintf(daemon_conn, "SET %d %s\n", (int)state->ibpi,
+				device);
+
+	fputs("COMMIT\n", daemon_conn);
+	fflush(daemon_conn);
+
+	if (!fgets(reply, sizeof(reply), daemon_conn)) {
+		fclose(daemon_conn);
+		log_error("No response from ledmon control socket.");
+		return LED_STATUS_DATA_ERROR;
+	}
+	fclose(daemon_conn);
+
+	if (strncmp(reply, "OK", 2) == 0)
+		return LED_STATUS_SUCCESS;
+	if (strncmp(reply, "ERR ", 4) == 0 &&
+	    str_toi(&status, reply + 4, NULL, 10) == 0)
+		return (led_status_t)status;
+	return LED_STATUS_DATA_ERROR;
+}
+
 /**
  * @brief Send IBPI pattern.
  *
@@ -926,6 +1227,9 @@ static led_status_t _ledctl_execute_ibpi(struct list *ibpi_local_list)
 	struct ibpi_state *state;
 	char *device;
 
+	if (daemon_fd >= 0)
+		return _daemon_execute_ibpi(ibpi_local_list);
+
 	if (!listed_only) {
 		off_all(ctx);
 	}
@@ -968,6 +1272,8 @@ static void _unset_unused_options(void)
 	conf.raid_members_only = false;
 	conf.rebuild_blink_on_all = false;
 	conf.scan_interval = 0;
+	memset(conf.flush_rate, 0, sizeof(conf.flush_rate));
+	conf.verify_slots = 0;
 }
 
 static led_status_t _init_ledctl_conf(void)
@@ -1109,16 +1415,38 @@ int main(int argc, char *argv[])
 		log_error("Unable to set library preferences %s", ledctl_strstatus(status));
 		return status;
 	}
-	status = led_scan(ctx);
-	if (status != LED_STATUS_SUCCESS) {
-		log_error("Error on led_scan %s", ledctl_strstatus(status));
-		return status;
+
+	/*
+	 * IBPI requests can be served by a running monitor service over its
+	 * control socket, which avoids the full local scan.
+	 */
+	if (req.chosen_opt == OPT_IBPI)
+		_daemon_connect();
+
+	if (daemon_fd < 0) {
+		uint32_t scan_mask = LED_SCAN_MASK_ALL;
+
+		/* Slot requests name their controller family, scan just it. */
+		if ((req.chosen_opt == OPT_GET_SLOT ||
+		     req.chosen_opt == OPT_SET_SLOT ||
+		     req.chosen_opt == OPT_LIST_SLOTS) &&
+		    req.cntrl != LED_CNTRL_TYPE_UNKNOWN)
+			scan_mask = LED_SCAN_MASK(req.cntrl);
+
+		status = led_scan_filtered(ctx, scan_mask);
+		if (status != LED_STATUS_SUCCESS) {
+			log_error("Error on led_scan %s", ledctl_strstatus(status));
+			return status;
+		}
 	}
 
 	if (status != LED_STATUS_SUCCESS)
 		exit(LED_STATUS_CMDLINE_ERROR);
 
 	list_init(&ibpi_list, (item_free_t)ibpi_state_fini);
+	hash_map_init(&ledctl_block_map);
+	if (req.chosen_opt == OPT_BATCH)
+		return execute_batch(ctx, &req);
 	if (req.chosen_opt != OPT_NULL_ELEMENT && req.chosen_opt != OPT_IBPI) {
 		status = verify_request(ctx, &req);
 		if (status == LED_STATUS_SUCCESS)
@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2026 Intel Corporation.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <common/config_file.h>
+#include <led/libled.h>
+#include <lib/utils.h>
+#include "journal.h"
+
+extern struct ledmon_conf conf;
+
+#define JOURNAL_DIR		"/run/ledmon"
+#define JOURNAL_FILE		JOURNAL_DIR "/journal.bin"
+
+#define JOURNAL_MAGIC		0x4c4a4d4cU	/* "LMJL" */
+#define JOURNAL_VERSION		1U
+
+/**
+ * Record slots in the mapped file. Sized for far more writes than a single
+ * pass produces; once full, appends stop until the next snapshot resets
+ * the journal.
+ */
+#define JOURNAL_MAX_RECORDS	4096U
+
+/**
+ * On disk header of the journal file, followed by JOURNAL_MAX_RECORDS
+ * fixed-size record slots of which the first count are valid.
+ */
+struct journal_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+#define JOURNAL_PATH_LEN	246U
+
+/**
+ * One journaled LED write. Fixed size keeps appends a single memcpy; the
+ * rare sysfs path longer than JOURNAL_PATH_LEN is not journaled and relies
+ * on the snapshot alone. The timestamp is wall clock, for diagnosis only.
+ */
+struct journal_record {
+	uint64_t ts_ns;
+	uint8_t ibpi;
+	uint8_t len;
+	char path[JOURNAL_PATH_LEN];
+};
+
+#define JOURNAL_SIZE	(sizeof(struct journal_header) + \
+			 JOURNAL_MAX_RECORDS * sizeof(struct journal_record))
+
+static struct journal_header *journal_hdr;
+static struct journal_record *journal_recs;
+static int journal_fd = -1;
+
+/*
+ * Replays the journal of a previous instance. See journal.h for details.
+ */
+int journal_replay(struct hash_map *map)
+{
+	struct journal_header hdr;
+	char path[JOURNAL_PATH_LEN + 1];
+	int replayed = 0;
+	uint32_t i, count;
+	FILE *f;
+
+	f = fopen(JOURNAL_FILE, "r");
+	if (!f)
+		return -1;
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    hdr.magic != JOURNAL_MAGIC || hdr.version != JOURNAL_VERSION) {
+		log_warning("journal: %s is not a valid write journal.",
+			    JOURNAL_FILE);
+		fclose(f);
+		return -1;
+	}
+
+	count = hdr.count;
+	if (count > JOURNAL_MAX_RECORDS)
+		count = JOURNAL_MAX_RECORDS;
+
+	for (i = 0; i < count; i++) {
+		struct journal_record rec;
+
+		if (fread(&rec, sizeof(rec), 1, f) != 1) {
+			log_warning("journal: %s is truncated.", JOURNAL_FILE);
+			break;
+		}
+		if (rec.len == 0 || rec.len > JOURNAL_PATH_LEN ||
+		    rec.ibpi <= LED_IBPI_PATTERN_UNKNOWN ||
+		    rec.ibpi >= LED_IBPI_PATTERN_COUNT)
+			continue;
+		memcpy(path, rec.path, rec.len);
+		path[rec.len] = '\0';
+
+		/* Write order, the last pattern sent per device wins. */
+		if (hash_map_insert(map, path, (void *)(intptr_t)rec.ibpi))
+			replayed++;
+	}
+
+	fclose(f);
+	return replayed;
+}
+
+/*
+ * Creates and maps the journal file. See journal.h for details.
+ */
+int journal_open(void)
+{
+	void *map;
+	int fd;
+
+	if (mkdir(JOURNAL_DIR, 0750) < 0 && errno != EEXIST) {
+		log_warning("journal: cannot create %s (errno=%d).",
+			    JOURNAL_DIR, errno);
+		return -1;
+	}
+
+	fd = open(JOURNAL_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+	if (fd < 0 || ftruncate(fd, JOURNAL_SIZE) < 0) {
+		log_warning("journal: cannot create %s (errno=%d).",
+			    JOURNAL_FILE, errno);
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+
+	map = mmap(NULL, JOURNAL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   fd, 0);
+	if (map == MAP_FAILED) {
+		log_warning("journal: cannot map %s (errno=%d).",
+			    JOURNAL_FILE, errno);
+		close(fd);
+		return -1;
+	}
+
+	journal_fd = fd;
+	journal_hdr = map;
+	journal_recs = (struct journal_record *)(journal_hdr + 1);
+	journal_hdr->magic = JOURNAL_MAGIC;
+	journal_hdr->version = JOURNAL_VERSION;
+	journal_hdr->count = 0;
+	journal_hdr->reserved = 0;
+	return 0;
+}
+
+/*
+ * Appends one successful LED write. See journal.h for details.
+ */
+void journal_note(const char *path, enum led_ibpi_pattern ibpi)
+{
+	struct journal_record *rec;
+	struct timespec ts;
+	size_t len;
+
+	if (!journal_hdr || journal_hdr->count >= JOURNAL_MAX_RECORDS)
+		return;
+
+	len = strnlen(path, JOURNAL_PATH_LEN + 1);
+	if (len == 0 || len > JOURNAL_PATH_LEN)
+		return;
+
+	rec = &journal_recs[journal_hdr->count];
+	clock_gettime(CLOCK_REALTIME, &ts);
+	rec->ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	rec->ibpi = ibpi;
+	rec->len = len;
+	memcpy(rec->path, path, len);
+	/*
+	 * Publish the record only after it is complete; a crash between the
+	 * stores loses the record, never replays a torn one.
+	 */
+	journal_hdr->count++;
+}
+
+/*
+ * Empties the journal. See journal.h for details.
+ */
+void journal_reset(void)
+{
+	if (journal_hdr)
+		journal_hdr->count = 0;
+}
+
+/*
+ * Unmaps and closes the journal file. See journal.h for details.
+ */
+void journal_close(void)
+{
+	if (journal_hdr) {
+		munmap(journal_hdr, JOURNAL_SIZE);
+		journal_hdr = NULL;
+		journal_recs = NULL;
+	}
+	if (journal_fd >= 0) {
+		close(journal_fd);
+		journal_fd = -1;
+	}
+}
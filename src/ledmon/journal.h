@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _JOURNAL_H_INCLUDED_
+#define _JOURNAL_H_INCLUDED_
+
+#include <led/libled.h>
+#include <lib/hashmap.h>
+
+/**
+ * Append-only journal of the LED writes sent to hardware. The snapshot
+ * (see snapshot.h) is rewritten once per pass, so a crash loses the writes
+ * of the pass in progress; the journal records every successful write the
+ * moment it is sent. On startup the journal is replayed on top of the
+ * snapshot, so the restored state is exact even when the snapshot is a
+ * pass behind. The journal lives in a fixed-size mmap'd file next to the
+ * snapshot and is reset whenever a snapshot covering its entries has been
+ * written, so appends are a memcpy and the file never grows.
+ */
+
+/**
+ * @brief Replays the journal left by a previous daemon instance.
+ *
+ * Inserts the journaled sysfs path/IBPI pairs into the given map in write
+ * order, replacing entries restored from the older snapshot. The map
+ * follows the snapshot_load() conventions. A missing, truncated or
+ * version-mismatched journal is ignored.
+ *
+ * @param[in]    map            initialized hash map to update.
+ *
+ * @return Number of replayed records if successful, otherwise -1.
+ */
+int journal_replay(struct hash_map *map);
+
+/**
+ * @brief Creates and maps the journal file for the current instance.
+ *
+ * Replaces whatever journal a previous instance left behind, so it must be
+ * called after journal_replay(). Failure is logged and not fatal, the
+ * daemon then runs with snapshot persistence only.
+ *
+ * @return 0 if successful, otherwise -1.
+ */
+int journal_open(void);
+
+/**
+ * @brief Appends one successful LED write to the journal.
+ *
+ * A record is complete before it is published, so a crash mid-append loses
+ * at most the record being written. No-op when the journal is not mapped,
+ * full, or the path does not fit a record; such writes are still covered
+ * by the next snapshot.
+ *
+ * @param[in]    path           device sysfs path.
+ * @param[in]    ibpi           IBPI pattern sent to the hardware.
+ */
+void journal_note(const char *path, enum led_ibpi_pattern ibpi);
+
+/**
+ * @brief Empties the journal.
+ *
+ * Called after a snapshot covering the journaled writes has been saved;
+ * the record slots are reused by subsequent appends.
+ */
+void journal_reset(void);
+
+/**
+ * @brief Unmaps and closes the journal file.
+ */
+void journal_close(void);
+
+#endif				/* _JOURNAL_H_INCLUDED_ */
@@ -7,13 +7,17 @@
 #include <getopt.h>
 #include <limits.h>
 #include <signal.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/param.h>
-#include <sys/select.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <syslog.h>
@@ -27,6 +31,7 @@
 #include <lib/ahci.h>
 #include <lib/block.h>
 #include <lib/cntrl.h>
+#include <lib/hashmap.h>
 
 #include <common/config_file.h>
 #include <led/libled.h>
@@ -38,10 +43,15 @@
 #include <lib/tail.h>
 #include <lib/smp.h>
 #include <lib/sysfs.h>
+#include <lib/state_shm.h>
+#include <lib/timing.h>
 #include <lib/utils.h>
 #include <lib/vmdssd.h>
 
 #include "config.h"
+#include "journal.h"
+#include "server.h"
+#include "snapshot.h"
 #include "udev.h"
 #include "pidfile.h"
 
@@ -56,6 +66,13 @@ struct ledmon_conf conf;
  */
 #define EXIT(x) ((exit)(exit_status = (x)))
 
+/**
+ * Runtime stats file in Prometheus textfile format, rewritten once per
+ * monitor cycle, see timing_stats_write().
+ */
+#define LEDMON_STATS_DIR	"/run/ledmon"
+#define LEDMON_STATS_FILE	LEDMON_STATS_DIR "/stats"
+
 static int exit_status;
 
 /**
@@ -72,6 +89,26 @@ static int ignore;
  */
 static struct list ledmon_block_list;
 
+/**
+ * @brief Index of active block devices keyed by sysfs path.
+ *
+ * The map speeds up matching of scanned devices and udev events against
+ * ledmon_block_list. It only references items owned by the list, so it must
+ * be cleared whenever the list is erased. See udev.h for details.
+ */
+struct hash_map ledmon_block_map;
+
+/**
+ * @brief IBPI states restored from the on-disk snapshot.
+ *
+ * The map is filled once at startup from the snapshot left by the previous
+ * daemon instance and consumed by the first scan: a newly discovered device
+ * whose sysfs path matches an entry resumes the recorded pattern instead of
+ * starting from the default. Entries left after the first scan are stale and
+ * the map is dropped. See snapshot.h for details.
+ */
+static struct hash_map ledmon_snapshot_map;
+
 /**
  * @brief Daemon process termination flag.
  *
@@ -80,6 +117,19 @@ static struct list ledmon_block_list;
  */
 static sig_atomic_t terminate;
 
+/**
+ * This flag indicates that a timing report was requested with SIGUSR1. The
+ * report is written to the log by the main loop, not from signal context.
+ */
+static sig_atomic_t dump_timing;
+
+/**
+ * This flag indicates that a configuration reload was requested with SIGHUP.
+ * The configuration file is re-parsed by the main loop, not from signal
+ * context.
+ */
+static sig_atomic_t reload_conf;
+
 /**
  * @brief Path to ledmon configuration file.
  *
@@ -141,8 +191,12 @@ static int possible_params_size = ARRAY_SIZE(possible_params);
  */
 static void _ledmon_fini(void)
 {
+	server_stop();
 	led_free(ctx);
 	list_erase(&ledmon_block_list);
+	hash_map_fini(&ledmon_block_map);
+	hash_map_fini(&ledmon_snapshot_map);
+	journal_close();
 	log_close(&conf);
 	pidfile_remove(progname);
 }
@@ -409,9 +463,11 @@ static ledmon_status_code_t _cmdline_parse(int argc, char *argv[])
 }
 
 /**
- * @brief SIGTERM handler function.
+ * @brief SIGTERM, SIGUSR1 and SIGHUP handler function.
  *
- * This is internal function of monitor service.
+ * This is internal function of monitor service. SIGTERM shuts the daemon
+ * down, SIGUSR1 requests a dump of the scan and flush timing counters to
+ * the log, SIGHUP requests a reload of the configuration file.
  *
  * @param[in]    signum          - the number of signal received.
  *
@@ -422,16 +478,22 @@ static void _ledmon_sig_term(int signum)
 	if (signum == SIGTERM) {
 		log_info("SIGTERM caught - terminating daemon process.");
 		terminate = 1;
+	} else if (signum == SIGUSR1) {
+		dump_timing = 1;
+	} else if (signum == SIGHUP) {
+		reload_conf = 1;
 	}
 }
 
 /**
  * @brief Configures signal handlers.
  *
- * This is internal function of monitor services. It sets to ignore SIGALRM,
- * SIGHUP and SIGPIPE signals. The function installs a handler for SIGTERM
- * signal. User must send SIGTERM to daemon process in order to shutdown the
- * daemon gently.
+ * This is internal function of monitor services. It sets to ignore SIGALRM
+ * and SIGPIPE signals. The function installs a handler for SIGTERM, SIGUSR1
+ * and SIGHUP signals. User must send SIGTERM to daemon process in order to
+ * shutdown the daemon gently. SIGUSR1 makes the daemon log a report of the
+ * accumulated scan and flush timing counters. SIGHUP makes the daemon reload
+ * its configuration file without restarting.
  *
  * @return The function does not return a value.
  */
@@ -452,59 +514,127 @@ static void _ledmon_setup_signals(void)
 	act.sa_flags = 0;
 	sigemptyset(&act.sa_mask);
 	sigaction(SIGALRM, &act, NULL);
-	sigaction(SIGHUP, &act, NULL);
 	sigaction(SIGPIPE, &act, NULL);
 	act.sa_handler = _ledmon_sig_term;
 	sigaction(SIGTERM, &act, NULL);
 	sigaction(SIGUSR1, &act, NULL);
+	sigaction(SIGHUP, &act, NULL);
 
 	sigprocmask(SIG_UNBLOCK, &sigset, NULL);
 }
 
 /**
- * @brief Puts the calling process into sleep.
+ * @brief Waits for events or for background reconciliation timer.
  *
- * This is internal function of monitor service. The function puts the calling
- * process into a sleep for the given amount of time (expressed in seconds). The
- * function will give control back to the process as soon as time elapses or
- * SIGTERM occurs.
+ * This is internal function of monitor service. The function blocks in epoll
+ * until something worth a rescan happens: a relevant udev event arrives on
+ * the udev monitor socket, md reports a state change on /proc/mdstat or on
+ * the sync_action/degraded attribute of a watched array, or the background
+ * reconciliation timer (expressed in seconds) expires. Irrelevant
+ * udev events are consumed without waking the main loop, so an idle system
+ * sleeps through the whole interval. The function gives control back to the
+ * process as soon as SIGTERM occurs, too.
  *
- * @param[in]    seconds         - the time interval given in seconds.
+ * @param[in]    seconds         - the reconciliation interval given in seconds.
  *
  * @return The function does not return a value.
  */
 static void _ledmon_wait(int seconds)
 {
-	int fd, udev_fd, max_fd, res;
-	fd_set rdfds, exfds;
-	struct timespec timeout;
+	int fd, udev_fd, srv_fd, raid_fd, epfd, tfd, nfds, i;
+	int wait_done = 0;
+	struct epoll_event ev, events[5];
+	struct itimerspec timeout;
 	sigset_t sigset;
 
 	sigprocmask(SIG_UNBLOCK, NULL, &sigset);
 	sigdelset(&sigset, SIGTERM);
-	timeout.tv_nsec = 0;
-	timeout.tv_sec = seconds;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		/* Fall back to a plain sleep, rescan will still happen. */
+		sleep(seconds);
+		return;
+	}
 
 	fd = open("/proc/mdstat", O_RDONLY);
+	if (fd >= 0) {
+		ev.events = EPOLLPRI;
+		ev.data.fd = fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+	}
+
 	udev_fd = get_udev_monitor();
-	max_fd = MAX(fd, udev_fd) + 1;
-	do {
-		FD_ZERO(&rdfds);
-		FD_ZERO(&exfds);
+	if (udev_fd >= 0) {
+		ev.events = EPOLLIN;
+		ev.data.fd = udev_fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, udev_fd, &ev);
+	}
+
+	srv_fd = get_server_socket();
+	if (srv_fd >= 0) {
+		ev.events = EPOLLIN;
+		ev.data.fd = srv_fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, srv_fd, &ev);
+	}
+
+	raid_fd = sysfs_raid_event_fd(ctx);
+	if (raid_fd >= 0) {
+		ev.events = EPOLLIN;
+		ev.data.fd = raid_fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, raid_fd, &ev);
+	}
 
-		if (fd > 0)
-			FD_SET(fd, &exfds);
-		if (udev_fd > 0)
-			FD_SET(udev_fd, &rdfds);
+	tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (tfd >= 0) {
+		memset(&timeout, 0, sizeof(timeout));
+		timeout.it_value.tv_sec = seconds;
+		timerfd_settime(tfd, 0, &timeout, NULL);
+		ev.events = EPOLLIN;
+		ev.data.fd = tfd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev);
+	}
 
-		res = pselect(max_fd, &rdfds, NULL, &exfds, &timeout, &sigset);
-		if (terminate || ((udev_fd > 0) && !FD_ISSET(udev_fd, &rdfds)) ||
-		    handle_udev_event(&ledmon_block_list, ctx) <= 0)
+	while (!wait_done && !terminate) {
+		nfds = epoll_pwait(epfd, events, ARRAY_SIZE(events), -1, &sigset);
+		if (nfds < 0)
+			/* Signal delivery or error, take the rescan path. */
 			break;
-	} while (res > 0);
+		for (i = 0; i < nfds; i++) {
+			if (events[i].data.fd == udev_fd) {
+				/*
+				 * Wake up only for events ledmon cares about,
+				 * uninteresting ones are drained here.
+				 */
+				if (handle_udev_event(&ledmon_block_list,
+						      ctx) <= 0)
+					wait_done = 1;
+			} else if (events[i].data.fd == srv_fd) {
+				/*
+				 * A ledctl request is served on the warm
+				 * context without waking up the rescan path.
+				 */
+				handle_server_request(ctx);
+			} else if (events[i].data.fd == raid_fd) {
+				/*
+				 * Rebuild started or finished, or an array
+				 * degraded. Spurious notifications are
+				 * filtered out by the handler.
+				 */
+				if (sysfs_raid_events_handle(ctx) > 0)
+					wait_done = 1;
+			} else {
+				/* Timer expired or md state changed. */
+				wait_done = 1;
+			}
+		}
+	}
 
+	if (tfd >= 0)
+		close(tfd);
 	if (fd >= 0)
 		close(fd);
+	close(epfd);
 }
 
 /**
@@ -582,7 +712,7 @@ static void _handle_fail_state(struct block_device *block,
 			if (!temp_raid_device)
 				new_level = RAID_LEVEL_UNKNOWN;
 			else
-				new_level = temp_raid_device->level;
+				new_level = raid_device_level(temp_raid_device);
 
 			if ((temp->raid_dev->level == RAID_LEVEL_10 ||
 				 temp->raid_dev->level == RAID_LEVEL_1) &&
@@ -638,12 +768,21 @@ static void _handle_fail_state(struct block_device *block,
  */
 static void _add_block(struct block_device *block)
 {
-	struct block_device *temp = NULL;
+	struct block_device *temp;
 
-	list_for_each(&ledmon_block_list, temp) {
-		if (block_compare(temp, block))
-			break;
+	/*
+	 * Fast path, look the device up by sysfs path. The linear walk below
+	 * stays as fallback for devices matched by host/phy rather than name.
+	 */
+	temp = hash_map_find(&ledmon_block_map, block->sysfs_path);
+	if (temp && !block_compare(temp, block))
 		temp = NULL;
+	if (!temp) {
+		list_for_each(&ledmon_block_list, temp) {
+			if (block_compare(temp, block))
+				break;
+			temp = NULL;
+		}
 	}
 	if (temp) {
 		enum led_ibpi_pattern ibpi = temp->ibpi;
@@ -677,27 +816,49 @@ static void _add_block(struct block_device *block)
 			log_info("CHANGE %s: from '%s' to '%s'", temp->sysfs_path, ibpi2str(ibpi),
 				 ibpi2str(temp->ibpi));
 
-		/* Check if name of the device changed.*/
-		if (strcmp(temp->sysfs_path, block->sysfs_path)) {
+		/* Check if name of the device changed. Paths are interned, so
+		 * a changed name means a changed pointer and the new one can
+		 * be shared instead of copied. */
+		if (temp->sysfs_path != block->sysfs_path) {
 			log_info("NAME CHANGED %s to %s",
 				 temp->sysfs_path, block->sysfs_path);
-			free(temp->sysfs_path);
-			temp->sysfs_path = strdup(block->sysfs_path);
-			if (!temp->sysfs_path) {
-				log_error("Memory allocation error!");
-				EXIT(1);
-			}
+			hash_map_remove(&ledmon_block_map, temp->sysfs_path);
+			temp->sysfs_path = block->sysfs_path;
+			hash_map_insert(&ledmon_block_map, temp->sysfs_path,
+					temp);
 		}
 	} else {
-		/* Device not found, it's a new one! */
-		temp = block_device_duplicate(block);
+		/*
+		 * Device not found, it's a new one! Steal the scanned object
+		 * from the library instead of duplicating the whole device
+		 * model, the library replaces it with a tombstone.
+		 */
+		temp = block_device_detach(ctx, block);
 		if (temp != NULL) {
-			log_info("NEW %s: state '%s'.", temp->sysfs_path, ibpi2str(temp->ibpi));
+			if (temp->ibpi == LED_IBPI_PATTERN_UNKNOWN)
+				temp->ibpi = LED_IBPI_PATTERN_ONESHOT_NORMAL;
+			void *saved = hash_map_remove(&ledmon_snapshot_map,
+						      temp->sysfs_path);
+
+			if (saved) {
+				/* Resume the pattern sent before restart. */
+				temp->ibpi =
+				    (enum led_ibpi_pattern)(intptr_t)saved;
+				log_info("RESTORED %s: state '%s'.",
+					 temp->sysfs_path,
+					 ibpi2str(temp->ibpi));
+			} else {
+				log_info("NEW %s: state '%s'.",
+					 temp->sysfs_path,
+					 ibpi2str(temp->ibpi));
+			}
 
 			if (!list_append(&ledmon_block_list, temp)) {
 				log_error("Memory allocation error!");
 				EXIT(1);
 			}
+			hash_map_insert(&ledmon_block_map, temp->sysfs_path,
+					temp);
 		}
 	}
 }
@@ -720,6 +881,7 @@ static void _add_block(struct block_device *block)
 static void _send_msg(struct block_device *block)
 {
 	status_t status;
+	uint64_t t;
 
 	if (!block->cntrl) {
 		log_debug("Missing cntrl for dev: %s. Not sending anything.",
@@ -740,6 +902,7 @@ static void _send_msg(struct block_device *block)
 		}
 	}
 
+	t = timing_now_ns();
 	status = block->send_message_fn(block, block->ibpi);
 	if (status == STATUS_INVALID_STATE) {
 		switch (block->ibpi) {
@@ -774,6 +937,10 @@ static void _send_msg(struct block_device *block)
 			break;
 		}
 	}
+	timing_add(ctx, TIMING_SEND_MSG, t);
+
+	if (status == STATUS_SUCCESS && block->ibpi != block->ibpi_prev)
+		journal_note(block->sysfs_path, block->ibpi);
 
 	/**
 	 * ibpi_prev is always updated regardless send_message_fn status. It works this way from
@@ -786,13 +953,6 @@ static void _send_msg(struct block_device *block)
 			  ibpi2str(block->ibpi), block->sysfs_path, status);
 }
 
-static void _flush_msg(struct block_device *block)
-{
-	if (!block->cntrl)
-		return;
-	block->flush_message_fn(block);
-}
-
 static void _revalidate_dev(struct block_device *block)
 {
 	/* Bring back controller and host to the device. */
@@ -837,6 +997,59 @@ static void _check_block_dev(struct block_device *block, int *restart)
 	}
 }
 
+/**
+ * @brief Tells whether a device needs immediate LED indication.
+ *
+ * This is internal function of monitor service. A transition to a fault path
+ * pattern (drive or array failure, predicted failure, rebuild, hot-spare)
+ * must not wait behind the bookkeeping of the healthy fleet, so such devices
+ * are sent and flushed first, see _ledmon_execute(). A device missing from
+ * the current scan counts as urgent too, _send_msg() reports it as a failed
+ * drive.
+ *
+ * @param[in]    block            Pointer to block device structure.
+ *
+ * @return 1 if the device has just transitioned to an urgent pattern,
+ *         otherwise the function returns 0.
+ */
+static int _urgent_transition(const struct block_device *block)
+{
+	if (block->timestamp != timestamp ||
+	    block->ibpi == LED_IBPI_PATTERN_REMOVED)
+		return 1;
+	if (block->ibpi == block->ibpi_prev)
+		return 0;
+	switch (block->ibpi) {
+	case LED_IBPI_PATTERN_FAILED_DRIVE:
+	case LED_IBPI_PATTERN_FAILED_ARRAY:
+	case LED_IBPI_PATTERN_PFA:
+	case LED_IBPI_PATTERN_REBUILD:
+	case LED_IBPI_PATTERN_HOTSPARE:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Checks if a device was handled by the urgent pass.
+ *
+ * @param[in]    sent             List of devices sent by the urgent pass.
+ * @param[in]    block            Pointer to block device structure.
+ *
+ * @return 1 if the device is on the list, otherwise the function returns 0.
+ */
+static int _urgent_sent(const struct list *sent,
+			const struct block_device *block)
+{
+	struct block_device *device;
+
+	list_for_each(sent, device)
+		if (device == block)
+			return 1;
+	return 0;
+}
+
 /**
  * @brief Sets a list of block devices and sends LED control messages.
  *
@@ -852,19 +1065,41 @@ static void _ledmon_execute(void)
 {
 	int restart = 0;	/* ledmon_block_list needs restart? */
 	struct block_device *device;
+	struct list urgent_list;
+
+	list_init(&urgent_list, NULL);
 
 	/* Revalidate each device in the list. Bring back controller and host */
 	list_for_each(&ledmon_block_list, device)
 		_revalidate_dev(device);
 	/* Scan all devices and compare them against saved list */
-	list_for_each(sysfs_get_block_devices(ctx), device)
+	vector_for_each(sysfs_get_block_devices(ctx), device)
 		_add_block(device);
-	/* Send message to all devices in the list if needed. */
+	/*
+	 * Fault path first. Urgent transitions are sent and pushed to the
+	 * hardware before the healthy fleet is processed, so the failure
+	 * indication latency does not grow with the device count.
+	 */
 	list_for_each(&ledmon_block_list, device)
-		_send_msg(device);
-	/* Flush unsent messages from internal buffers. */
+		if (_urgent_transition(device)) {
+			_send_msg(device);
+			/* On allocation failure the device is just sent
+			 * again with the rest, the controllers dedup. */
+			list_append(&urgent_list, device);
+		}
+	if (!list_is_empty(&urgent_list))
+		led_flush(ctx);
+	/* Send message to the remaining devices in the list if needed. */
 	list_for_each(&ledmon_block_list, device)
-		_flush_msg(device);
+		if (!_urgent_sent(&urgent_list, device))
+			_send_msg(device);
+	list_clear(&urgent_list);
+	/*
+	 * Transmit the queued messages in the background. The writes overlap
+	 * the snapshot and state publishing and the event wait, the next scan
+	 * collects stragglers before touching the device model.
+	 */
+	led_flush_async(ctx);
 	/* Check if there is any orphaned device. */
 	list_for_each(&ledmon_block_list, device)
 		_check_block_dev(device, &restart);
@@ -872,6 +1107,7 @@ static void _ledmon_execute(void)
 	if (restart) {
 		/* there is at least one detached element in the list. */
 		list_erase(&ledmon_block_list);
+		hash_map_clear(&ledmon_block_map);
 	}
 }
 
@@ -903,6 +1139,10 @@ static int load_library_prefs(void)
 	device_blink_behavior_set(ctx, conf.blink_on_migration, conf.blink_on_init,
 					conf.rebuild_blink_on_all, conf.raid_members_only);
 
+	for (enum led_cntrl_type ct = LED_CNTRL_TYPE_DELLSSD;
+	     ct <= LED_CNTRL_TYPE_AMD; ct++)
+		device_flush_rate_set(ctx, ct, conf.flush_rate[ct]);
+
 	list_for_each(&conf.cntrls_allowlist, path) {
 		lib_status = device_allow_pattern_add(ctx, path);
 		if (lib_status != LED_STATUS_SUCCESS)
@@ -917,6 +1157,127 @@ static int load_library_prefs(void)
 	return LEDMON_STATUS_SUCCESS;
 }
 
+/**
+ * @brief Reloads the daemon configuration.
+ *
+ * This is internal function of monitor service. The function is called by the
+ * main loop when SIGHUP was received. It re-parses the configuration file and
+ * applies the values which may change at runtime: scan interval, log level,
+ * blink behavior and the controller allow and exclude lists. The warm library
+ * context and the monitored device list are kept, so LEDs stay managed across
+ * the reload; only the scanned device model is dropped, because the new
+ * pattern lists and blink behavior shape what the next scan builds. On a
+ * parse error the running configuration stays untouched. Configuration file
+ * values take effect even where command line options overrode them at
+ * startup.
+ *
+ * @return The function does not return a value.
+ */
+static void _ledmon_reload_conf(void)
+{
+	struct ledmon_conf new_conf;
+	char *path = NULL;
+
+	if (ledmon_init_conf(&new_conf, LED_LOG_LEVEL_WARNING,
+			     LEDMON_DEF_LOG_FILE) != LEDMON_STATUS_SUCCESS)
+		return;
+	new_conf.blink_on_init = 1;
+	new_conf.blink_on_migration = 1;
+	new_conf.rebuild_blink_on_all = 0;
+	new_conf.raid_members_only = 0;
+	new_conf.scan_interval = LEDMON_DEF_SLEEP_INTERVAL;
+	if (ledmon_read_conf(ledmon_conf_path, &new_conf) !=
+	    LEDMON_STATUS_SUCCESS) {
+		log_warning("SIGHUP: cannot re-read configuration file, "
+			    "keeping the running configuration.");
+		ledmon_free_conf(&new_conf);
+		return;
+	}
+
+	conf.scan_interval = new_conf.scan_interval;
+	conf.log_level = new_conf.log_level;
+	conf.blink_on_init = new_conf.blink_on_init;
+	conf.blink_on_migration = new_conf.blink_on_migration;
+	conf.rebuild_blink_on_all = new_conf.rebuild_blink_on_all;
+	conf.raid_members_only = new_conf.raid_members_only;
+	memcpy(conf.flush_rate, new_conf.flush_rate, sizeof(conf.flush_rate));
+	conf.verify_slots = new_conf.verify_slots;
+
+	led_log_level_set(ctx, conf.log_level);
+	device_blink_behavior_set(ctx, conf.blink_on_migration,
+				  conf.blink_on_init, conf.rebuild_blink_on_all,
+				  conf.raid_members_only);
+	for (enum led_cntrl_type ct = LED_CNTRL_TYPE_DELLSSD;
+	     ct <= LED_CNTRL_TYPE_AMD; ct++)
+		device_flush_rate_set(ctx, ct, conf.flush_rate[ct]);
+
+	/* Replace the allow and exclude pattern lists. */
+	device_patterns_reset(ctx);
+	list_erase(&conf.cntrls_allowlist);
+	list_erase(&conf.cntrls_excludelist);
+	list_for_each(&new_conf.cntrls_allowlist, path) {
+		char *t = strdup(path);
+
+		if (!t || !list_append(&conf.cntrls_allowlist, t))
+			free(t);
+		device_allow_pattern_add(ctx, path);
+	}
+	list_for_each(&new_conf.cntrls_excludelist, path) {
+		char *t = strdup(path);
+
+		if (!t || !list_append(&conf.cntrls_excludelist, t))
+			free(t);
+		device_exclude_pattern_add(ctx, path);
+	}
+	ledmon_free_conf(&new_conf);
+
+	/*
+	 * The pattern lists and blink behavior are baked into the scanned
+	 * model, drop the retained one so the next scan rebuilds it.
+	 */
+	sysfs_reset(ctx);
+
+	ledmon_write_shared_conf(&conf);
+	log_info("SIGHUP: configuration reloaded from %s.",
+		 ledmon_conf_path ? ledmon_conf_path : LEDMON_DEF_CONF_FILE);
+}
+
+/**
+ * @brief Notifies the service manager that startup finished.
+ *
+ * Speaks the sd_notify(3) readiness protocol directly over the datagram
+ * socket named by NOTIFY_SOCKET, so ledmon can run as a Type=notify unit
+ * without linking against libsystemd. Does nothing when not started by a
+ * service manager.
+ */
+static void _sd_notify_ready(void)
+{
+	const char *path = getenv("NOTIFY_SOCKET");
+	struct sockaddr_un addr;
+	int fd;
+
+	if (!path || (path[0] != '/' && path[0] != '@'))
+		return;
+	if (strnlen(path, sizeof(addr.sun_path)) >= sizeof(addr.sun_path))
+		return;
+
+	fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	/* An abstract socket address starts with a nul byte. */
+	if (addr.sun_path[0] == '@')
+		addr.sun_path[0] = '\0';
+
+	if (sendto(fd, "READY=1", strlen("READY=1"), 0, (struct sockaddr *)&addr,
+		   offsetof(struct sockaddr_un, sun_path) + strlen(path)) < 0)
+		log_debug("%s: sendto() failed (errno=%d).", __func__, errno);
+	close(fd);
+}
+
 static void _close_parent_fds(void)
 {
 	struct list dir;
@@ -943,6 +1304,8 @@ int main(int argc, char *argv[])
 {
 	led_status_t lib_rc;
 	ledmon_status_code_t status = LEDMON_STATUS_SUCCESS;
+	uint64_t start_ns;
+	int restored, replayed;
 
 	setup_options(&longopt, &shortopt, possible_params,
 			possible_params_size);
@@ -1033,12 +1396,32 @@ int main(int argc, char *argv[])
 		log_debug("main(): pidfile_creat() failed.");
 		EXIT(EXIT_FAILURE);
 	}
+	/* Stats export is best effort, the monitor runs fine without it. */
+	if (mkdir(LEDMON_STATS_DIR, 0755) != 0 && errno != EEXIST)
+		log_debug("main(): cannot create %s (errno=%d).",
+			  LEDMON_STATS_DIR, errno);
 	_ledmon_setup_signals();
 
 	if (atexit(_ledmon_fini))
 		EXIT(LEDMON_STATUS_ONEXIT_ERROR);
 	list_init(&ledmon_block_list, (item_free_t)block_device_fini);
+	hash_map_init(&ledmon_block_map);
+	hash_map_init(&ledmon_snapshot_map);
+	restored = snapshot_load(&ledmon_snapshot_map);
+	if (restored > 0)
+		log_info("restored state of %d device(s) from snapshot.",
+			 restored);
+	/* Writes journaled after the last snapshot override its entries. */
+	replayed = journal_replay(&ledmon_snapshot_map);
+	if (replayed > 0) {
+		log_info("replayed %d journaled write(s).", replayed);
+		restored = (restored > 0 ? restored : 0) + replayed;
+	}
+	journal_open();
+	/* The control socket is optional, ledctl falls back to local scans. */
+	server_start();
 	log_info("monitor service has been started...");
+	start_ns = timing_now_ns();
 	while (terminate == 0) {
 		struct block_device *device;
 
@@ -1048,7 +1431,51 @@ int main(int argc, char *argv[])
 			EXIT(1);
 		}
 		_ledmon_execute();
+		if (start_ns) {
+			/*
+			 * Report readiness only once the LEDs reflect the
+			 * first scan; a drive that died while the node was
+			 * off is already blinking at this point. The library
+			 * probes controllers, enclosures and block devices
+			 * concurrently, so this is dominated by hardware
+			 * latency, not by ledmon.
+			 */
+			led_wait(ctx, -1);
+			log_info("initial LED state asserted after %.3f s.",
+				 (timing_now_ns() - start_ns) / 1e9);
+			_sd_notify_ready();
+			start_ns = 0;
+		}
+		if (conf.verify_slots > 0) {
+			/*
+			 * Read back a slice of the slots and repair LEDs
+			 * firmware silently dropped. Verification waits for
+			 * the in-flight flush, otherwise it would race the
+			 * writes it is checking.
+			 */
+			led_wait(ctx, -1);
+			device_verify_sample(ctx, conf.verify_slots);
+		}
+		if (restored != 0) {
+			/* Entries not matched by the first scan are stale. */
+			hash_map_fini(&ledmon_snapshot_map);
+			restored = 0;
+		}
+		if (snapshot_save(&ledmon_block_list) == 0) {
+			/* The snapshot covers every journaled write. */
+			journal_reset();
+		}
+		timing_stats_write(ctx, LEDMON_STATS_FILE);
+		state_shm_publish(ctx);
 		_ledmon_wait(conf.scan_interval);
+		if (dump_timing) {
+			dump_timing = 0;
+			timing_report(ctx);
+		}
+		if (reload_conf) {
+			reload_conf = 0;
+			_ledmon_reload_conf();
+		}
 		/* Invalidate each device in the list. Clear controller and host. */
 		list_for_each(&ledmon_block_list, device)
 			_invalidate_dev(device);
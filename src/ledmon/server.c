@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2026 Intel Corporation.
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <common/config_file.h>
+#include "led/libled.h"
+#include "libled_internal.h"
+#include "server.h"
+#include <lib/utils.h>
+
+/**
+ * Receive timeout for one client transaction. A stuck or malicious client
+ * must not wedge the monitor service.
+ */
+#define SERVER_RCV_TIMEOUT_SEC	5
+
+/**
+ * Listening socket descriptor, -1 when the server is not running.
+ */
+static int server_fd = -1;
+
+/*
+ * Starts the control socket server. See server.h for details.
+ */
+int server_start(void)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		log_error("server: socket() failed (errno=%d).", errno);
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, LEDMON_SOCKET_FILE, sizeof(addr.sun_path) - 1);
+
+	/* There is one daemon instance, a leftover file is always stale. */
+	unlink(LEDMON_SOCKET_FILE);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		log_error("server: bind(%s) failed (errno=%d).",
+			  LEDMON_SOCKET_FILE, errno);
+		close(fd);
+		return -1;
+	}
+
+	if (listen(fd, 16) < 0) {
+		log_error("server: listen() failed (errno=%d).", errno);
+		close(fd);
+		unlink(LEDMON_SOCKET_FILE);
+		return -1;
+	}
+
+	server_fd = fd;
+	log_info("server: listening on %s", LEDMON_SOCKET_FILE);
+	return server_fd;
+}
+
+/*
+ * Gets the listening socket descriptor. See server.h for details.
+ */
+int get_server_socket(void)
+{
+	return server_fd;
+}
+
+/**
+ * @brief Applies a single SET command.
+ *
+ * This is internal function of the control socket server. The function
+ * resolves the device name the same way a locally scanning ledctl would and
+ * queues the requested pattern on the warm library context.
+ *
+ * @param[in]    ctx            library context.
+ * @param[in]    args           command arguments: "<ibpi> <devnode>".
+ *
+ * @return LED_STATUS_SUCCESS if successful, otherwise a valid led_status_t.
+ */
+static led_status_t _serve_set(struct led_ctx *ctx, char *args)
+{
+	char path[PATH_MAX];
+	led_status_t status;
+	char *name;
+	int ibpi;
+
+	name = strchr(args, ' ');
+	if (!name)
+		return LED_STATUS_CMDLINE_ERROR;
+	*(name++) = '\0';
+
+	if (str_toi(&ibpi, args, NULL, 10) != 0 ||
+	    ibpi <= LED_IBPI_PATTERN_UNKNOWN || ibpi >= LED_IBPI_PATTERN_COUNT)
+		return LED_STATUS_INVALID_STATE;
+
+	status = led_device_name_lookup(ctx, name, path);
+	if (status != LED_STATUS_SUCCESS) {
+		log_warning("server: could not find %s.", name);
+		return status;
+	}
+
+	if (!led_is_management_supported(ctx, path)) {
+		log_warning("server: %s: device not supported.", name);
+		return LED_STATUS_NOT_SUPPORTED;
+	}
+
+	return led_set(ctx, path, (enum led_ibpi_pattern)ibpi);
+}
+
+/*
+ * Accepts and serves one client connection. See server.h for details.
+ */
+void handle_server_request(struct led_ctx *ctx)
+{
+	led_status_t status = LED_STATUS_SUCCESS;
+	struct timeval timeout = { .tv_sec = SERVER_RCV_TIMEOUT_SEC };
+	int committed = 0;
+	char line[PATH_MAX + BUFFER_MAX];
+	FILE *client;
+	int fd;
+
+	fd = accept4(server_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	/* Let a background flush finish before serving writes on the context. */
+	led_wait(ctx, -1);
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	client = fdopen(fd, "r+");
+	if (!client) {
+		close(fd);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), client)) {
+		led_status_t t_status = LED_STATUS_SUCCESS;
+		char *t = strchrnul(line, '\n');
+
+		*t = '\0';
+
+		if (strcmp(line, "COMMIT") == 0) {
+			committed = 1;
+			break;
+		} else if (strcmp(line, "OFFALL") == 0) {
+			off_all(ctx);
+		} else if (strncmp(line, "SET ", 4) == 0) {
+			t_status = _serve_set(ctx, line + 4);
+		} else {
+			t_status = LED_STATUS_CMDLINE_ERROR;
+		}
+		if (t_status != LED_STATUS_SUCCESS &&
+		    status == LED_STATUS_SUCCESS)
+			status = t_status;
+	}
+
+	if (committed) {
+		led_flush(ctx);
+		if (status == LED_STATUS_SUCCESS)
+			fputs("OK\n", client);
+		else
+			fprintf(client, "ERR %d\n", status);
+	}
+
+	fclose(client);
+}
+
+/*
+ * Stops the control socket server. See server.h for details.
+ */
+void server_stop(void)
+{
+	if (server_fd < 0)
+		return;
+
+	close(server_fd);
+	server_fd = -1;
+	unlink(LEDMON_SOCKET_FILE);
+}
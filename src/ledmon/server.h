@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _SERVER_H_INCLUDED_
+#define _SERVER_H_INCLUDED_
+
+#include <led/libled.h>
+
+/**
+ * Control socket of the monitor service. The daemon listens on a UNIX stream
+ * socket (LEDMON_SOCKET_FILE) so ledctl can apply LED requests against the
+ * already scanned library context instead of paying a full scan per
+ * invocation.
+ *
+ * Protocol: the client sends newline terminated commands and finishes the
+ * transaction with a COMMIT line, then the server answers with a single
+ * status line and the connection is closed.
+ *
+ *    OFFALL                 - turn off LEDs of all managed devices
+ *    SET <ibpi> <devnode>   - queue an IBPI state (numeric) for a device
+ *    COMMIT                 - apply queued states and flush controllers
+ *
+ * The answer is "OK" when every command succeeded, otherwise "ERR <status>"
+ * where status is the led_status_t of the first failed command. States set
+ * this way are subject to the same policy as any other ledctl invocation
+ * running next to the monitor service, i.e. the daemon may override them on
+ * the following rescan.
+ */
+
+/**
+ * @brief Starts the control socket server.
+ *
+ * Creates the listening socket, replacing a stale socket file if one exists.
+ *
+ * @return Listening socket descriptor if successful, otherwise -1.
+ */
+int server_start(void);
+
+/**
+ * @brief Gets the listening socket descriptor.
+ *
+ * @return File descriptor or -1 if the server is not running.
+ */
+int get_server_socket(void);
+
+/**
+ * @brief Accepts and serves one client connection.
+ *
+ * This function must be called when the listening socket reports a pending
+ * connection. The whole transaction is served synchronously, a receive
+ * timeout protects the monitor against stuck clients.
+ *
+ * @param[in]    ctx            library context to apply requests on.
+ */
+void handle_server_request(struct led_ctx *ctx);
+
+/**
+ * @brief Stops the control socket server and removes the socket file.
+ *
+ * @return The function does not return a value.
+ */
+void server_stop(void);
+
+#endif				/* _SERVER_H_INCLUDED_ */
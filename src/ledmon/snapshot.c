@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2026 Intel Corporation.
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <common/config_file.h>
+#include <lib/block.h>
+#include <led/libled.h>
+#include <lib/utils.h>
+#include "snapshot.h"
+
+extern struct ledmon_conf conf;
+
+#define SNAPSHOT_DIR		"/run/ledmon"
+#define SNAPSHOT_FILE		SNAPSHOT_DIR "/state.bin"
+#define SNAPSHOT_FILE_TMP	SNAPSHOT_FILE ".tmp"
+
+#define SNAPSHOT_MAGIC		0x4e534d4cU	/* "LMSN" */
+#define SNAPSHOT_VERSION	1U
+
+/**
+ * On disk header of the snapshot file. Records follow directly: a 16-bit
+ * path length, the sysfs path without terminator and one byte holding the
+ * IBPI pattern.
+ */
+struct snapshot_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+};
+
+/*
+ * Loads the state snapshot. See snapshot.h for details.
+ */
+int snapshot_load(struct hash_map *map)
+{
+	struct snapshot_header hdr;
+	char path[PATH_MAX];
+	int restored = 0;
+	uint32_t i;
+	FILE *f;
+
+	f = fopen(SNAPSHOT_FILE, "r");
+	if (!f)
+		return -1;
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    hdr.magic != SNAPSHOT_MAGIC || hdr.version != SNAPSHOT_VERSION) {
+		log_warning("snapshot: %s is not a valid state snapshot.",
+			    SNAPSHOT_FILE);
+		fclose(f);
+		return -1;
+	}
+
+	for (i = 0; i < hdr.count; i++) {
+		uint16_t len;
+		uint8_t ibpi;
+
+		if (fread(&len, sizeof(len), 1, f) != 1 || len >= PATH_MAX ||
+		    fread(path, len, 1, f) != 1 ||
+		    fread(&ibpi, sizeof(ibpi), 1, f) != 1) {
+			log_warning("snapshot: %s is truncated.",
+				    SNAPSHOT_FILE);
+			break;
+		}
+		path[len] = '\0';
+
+		if (ibpi <= LED_IBPI_PATTERN_UNKNOWN ||
+		    ibpi >= LED_IBPI_PATTERN_COUNT)
+			continue;
+
+		if (hash_map_insert(map, path, (void *)(intptr_t)ibpi))
+			restored++;
+	}
+
+	fclose(f);
+	return restored;
+}
+
+/*
+ * Persists the last sent IBPI states. See snapshot.h for details.
+ */
+int snapshot_save(const struct list *block_list)
+{
+	struct snapshot_header hdr;
+	struct block_device *device;
+	uint32_t count = 0;
+	FILE *f;
+
+	if (mkdir(SNAPSHOT_DIR, 0750) < 0 && errno != EEXIST)
+		return -1;
+
+	f = fopen(SNAPSHOT_FILE_TMP, "w");
+	if (!f)
+		return -1;
+
+	list_for_each(block_list, device) {
+		if (device->ibpi > LED_IBPI_PATTERN_UNKNOWN &&
+		    device->ibpi < LED_IBPI_PATTERN_COUNT)
+			count++;
+	}
+
+	hdr.magic = SNAPSHOT_MAGIC;
+	hdr.version = SNAPSHOT_VERSION;
+	hdr.count = count;
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+		goto error;
+
+	list_for_each(block_list, device) {
+		uint16_t len = strnlen(device->sysfs_path, PATH_MAX - 1);
+		uint8_t ibpi = device->ibpi;
+
+		if (device->ibpi <= LED_IBPI_PATTERN_UNKNOWN ||
+		    device->ibpi >= LED_IBPI_PATTERN_COUNT)
+			continue;
+
+		if (fwrite(&len, sizeof(len), 1, f) != 1 ||
+		    fwrite(device->sysfs_path, len, 1, f) != 1 ||
+		    fwrite(&ibpi, sizeof(ibpi), 1, f) != 1)
+			goto error;
+	}
+
+	if (fclose(f) != 0) {
+		unlink(SNAPSHOT_FILE_TMP);
+		return -1;
+	}
+
+	if (rename(SNAPSHOT_FILE_TMP, SNAPSHOT_FILE) < 0) {
+		unlink(SNAPSHOT_FILE_TMP);
+		return -1;
+	}
+	return 0;
+
+error:
+	fclose(f);
+	unlink(SNAPSHOT_FILE_TMP);
+	return -1;
+}
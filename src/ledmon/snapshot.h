@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0-only
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _SNAPSHOT_H_INCLUDED_
+#define _SNAPSHOT_H_INCLUDED_
+
+#include <lib/hashmap.h>
+#include <lib/list.h>
+
+/**
+ * Binary snapshot of the monitor device state. After every execute pass the
+ * daemon records the last sent IBPI pattern per block device sysfs path in a
+ * small versioned file (/run/ledmon/state.bin, written atomically via
+ * rename). On startup the snapshot seeds the device model, so the first scan
+ * re-asserts the patterns from before the restart instead of resetting every
+ * LED to its default and re-deriving states over several passes. Entries are
+ * validated against the first scan, paths that no longer exist in sysfs are
+ * dropped.
+ */
+
+/**
+ * @brief Loads the state snapshot left by a previous daemon instance.
+ *
+ * Fills the given map with sysfs path keys; the item is the recorded IBPI
+ * pattern stored directly in the pointer value. A missing, truncated or
+ * version-mismatched snapshot is ignored.
+ *
+ * @param[in]    map            initialized hash map to fill.
+ *
+ * @return Number of restored entries if successful, otherwise -1.
+ */
+int snapshot_load(struct hash_map *map);
+
+/**
+ * @brief Persists the last sent IBPI state of every monitored device.
+ *
+ * The snapshot is written to a temporary file first and renamed over the
+ * previous one, so a crash mid-write never leaves a torn snapshot.
+ *
+ * @param[in]    block_list     list of monitored block devices.
+ *
+ * @return 0 if successful, otherwise -1.
+ */
+int snapshot_save(const struct list *block_list);
+
+#endif				/* _SNAPSHOT_H_INCLUDED_ */
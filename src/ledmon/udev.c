@@ -1,22 +1,35 @@
 // SPDX-License-Identifier: LGPL-2.1-or-later
 // Copyright (C) 2022 Intel Corporation.
 
+#include <errno.h>
 #include <libudev.h>
 #include <limits.h>
+#include <poll.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "block.h"
 #include "led/libled.h"
 #include "status.h"
 #include "sysfs.h"
 #include "udev.h"
+#include <lib/libled_internal.h>
+#include <lib/timing.h>
 #include <lib/utils.h>
 
 extern struct ledmon_conf conf;
 
 static struct udev_monitor *udev_monitor;
 
+/*
+ * Netlink receive buffer of the udev monitor. The kernel default overruns
+ * during md assembly of hundreds of devices and every lost event went
+ * unnoticed until the next full interval scan.
+ */
+#define UDEV_MONITOR_RCVBUF	(8 * 1024 * 1024)
+
 static int _compare(const struct block_device *bd, const char *syspath, struct led_ctx *ctx)
 {
 	if (!bd || !syspath)
@@ -71,6 +84,12 @@ static int create_udev_monitor(void)
 		return -1;
 	}
 
+	/* Overflows are still detected and recovered, see handle_udev_event(). */
+	res = udev_monitor_set_receive_buffer_size(udev_monitor,
+						   UDEV_MONITOR_RCVBUF);
+	if (res < 0)
+		log_warning("Failed to enlarge udev monitor receive buffer.");
+
 	return udev_monitor_get_fd(udev_monitor);
 }
 
@@ -137,65 +156,201 @@ static void _clear_raid_dev_info(struct block_device *block, char *raid_dev)
 
 }
 
-int handle_udev_event(struct list *ledmon_block_list, struct led_ctx *ctx)
+/* Quiet-period window ending a burst of udev events, in milliseconds. */
+#define UDEV_DEBOUNCE_MS	20
+
+/* Upper bound on draining time during sustained event storms. */
+#define UDEV_DRAIN_MAX_MS	500
+
+/**
+ * One coalesced udev event. Only the final action received for a device is
+ * kept, intermediate events of a burst are dropped.
+ */
+struct coalesced_event {
+	enum udev_action action;
+	char syspath[PATH_MAX];
+};
+
+static uint64_t _now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Drains all events pending on the udev monitor.
+ *
+ * Events are coalesced per device: the first event of a device appends an
+ * entry to the list, every following one only overwrites its action, so a
+ * hotplug storm collapses to one entry per distinct device. Events without
+ * an interesting action are consumed and dropped.
+ *
+ * @param[in]    events    list of coalesced_event entries, extended in place.
+ * @param[in]    index     map of list entries keyed by sysfs path.
+ * @param[in]    overflow  set to 1 when the kernel dropped events, i.e. the
+ *                         receive buffer overran and the lists are incomplete.
+ *
+ * @return Number of events received, 0 when the monitor ran dry.
+ */
+static int _drain_udev_events(struct list *events, struct hash_map *index,
+			      int *overflow)
 {
 	struct udev_device *dev;
-	int status = -1;
+	int count = 0;
 
-	dev = udev_monitor_receive_device(udev_monitor);
-	if (dev) {
+	errno = 0;
+	while ((dev = udev_monitor_receive_device(udev_monitor)) != NULL) {
 		const char *action = udev_device_get_action(dev);
-		enum udev_action act = _get_udev_action(action);
 		const char *syspath = udev_device_get_syspath(dev);
-		struct block_device *block = NULL;
-
-		if (act == UDEV_ACTION_UNKNOWN) {
-			status = 1;
-			goto exit;
+		enum udev_action act = UDEV_ACTION_UNKNOWN;
+
+		count++;
+		if (action)
+			act = _get_udev_action(action);
+		if (act != UDEV_ACTION_UNKNOWN && syspath) {
+			struct coalesced_event *ev;
+
+			ev = hash_map_find(index, syspath);
+			if (ev) {
+				ev->action = act;
+			} else {
+				ev = calloc(1, sizeof(*ev));
+				if (ev && !list_append(events, ev)) {
+					free(ev);
+					ev = NULL;
+				}
+				if (ev) {
+					ev->action = act;
+					str_cpy(ev->syspath, syspath,
+						PATH_MAX);
+					/*
+					 * An index miss is harmless, later
+					 * events of the device are applied
+					 * in order instead of in place.
+					 */
+					hash_map_insert(index, syspath, ev);
+				}
+			}
 		}
+		udev_device_unref(dev);
+		errno = 0;
+	}
+	if (errno == ENOBUFS)
+		*overflow = 1;
+	return count;
+}
 
+/**
+ * @brief Applies one coalesced event to the monitored device list.
+ *
+ * @return 0 if the event is relevant for ledmon, otherwise 1.
+ */
+static int _apply_udev_event(struct list *ledmon_block_list,
+			     struct led_ctx *ctx, char *syspath,
+			     enum udev_action act)
+{
+	struct block_device *block;
+
+	/*
+	 * Fast path, look the device up by sysfs path. The linear walk below
+	 * stays as fallback for devices matched by host/phy rather than name.
+	 */
+	block = hash_map_find(&ledmon_block_map, syspath);
+	if (!block) {
 		list_for_each(ledmon_block_list, block) {
 			if (_compare(block, syspath, ctx))
 				break;
 			block = NULL;
 		}
+	}
 
-		if (!block) {
-			if (act == UDEV_ACTION_REMOVE && _check_raid(syspath)) {
-				/*ledmon is interested about removed arrays*/
-				char *dev_name;
-
-				dev_name = strrchr(syspath, '/') + 1;
-				log_debug("REMOVED %s", dev_name);
-				list_for_each(ledmon_block_list, block)
-					_clear_raid_dev_info(block, dev_name);
-				status = 0;
-				goto exit;
-			}
-			status = 1;
-			goto exit;
-		}
+	if (!block) {
+		if (act == UDEV_ACTION_REMOVE && _check_raid(syspath)) {
+			/*ledmon is interested about removed arrays*/
+			char *dev_name;
 
-		if (act == UDEV_ACTION_ADD) {
-			log_debug("ADDED %s", block->sysfs_path);
-			if (block->ibpi == LED_IBPI_PATTERN_FAILED_DRIVE ||
-				block->ibpi == LED_IBPI_PATTERN_REMOVED ||
-				block->ibpi == LED_IBPI_PATTERN_UNKNOWN)
-				block->ibpi = LED_IBPI_PATTERN_ADDED;
-		} else if (act == UDEV_ACTION_REMOVE) {
-			log_debug("REMOVED %s", block->sysfs_path);
-			block->ibpi = LED_IBPI_PATTERN_REMOVED;
-		} else {
-			/* not interesting event */
-			status = 1;
-			goto exit;
+			dev_name = strrchr(syspath, '/') + 1;
+			log_debug("REMOVED %s", dev_name);
+			list_for_each(ledmon_block_list, block)
+				_clear_raid_dev_info(block, dev_name);
+			return 0;
 		}
-		status = 0;
+		return 1;
+	}
+
+	if (act == UDEV_ACTION_ADD) {
+		log_debug("ADDED %s", block->sysfs_path);
+		if (block->ibpi == LED_IBPI_PATTERN_FAILED_DRIVE ||
+			block->ibpi == LED_IBPI_PATTERN_REMOVED ||
+			block->ibpi == LED_IBPI_PATTERN_UNKNOWN)
+			block->ibpi = LED_IBPI_PATTERN_ADDED;
 	} else {
+		log_debug("REMOVED %s", block->sysfs_path);
+		block->ibpi = LED_IBPI_PATTERN_REMOVED;
+	}
+	return 0;
+}
+
+int handle_udev_event(struct list *ledmon_block_list, struct led_ctx *ctx)
+{
+	uint64_t deadline = _now_ms() + UDEV_DRAIN_MAX_MS;
+	struct coalesced_event *ev;
+	struct hash_map index;
+	struct list events;
+	int status = 1;
+	int overflow = 0;
+
+	list_init(&events, free);
+	hash_map_init(&index);
+
+	if (_drain_udev_events(&events, &index, &overflow) == 0 && !overflow) {
+		hash_map_fini(&index);
 		return -1;
 	}
 
-exit:
-	udev_device_unref(dev);
+	/*
+	 * Debounce: during md array assembly events arrive in bursts of
+	 * thousands. Keep draining until the monitor stays quiet for a short
+	 * window (or the storm outlasts the drain budget), so the work below
+	 * is done once per distinct device instead of once per event.
+	 */
+	while (_now_ms() < deadline) {
+		struct pollfd pfd = {
+			.fd = udev_monitor_get_fd(udev_monitor),
+			.events = POLLIN,
+		};
+
+		if (poll(&pfd, 1, UDEV_DEBOUNCE_MS) <= 0)
+			break;
+		if (_drain_udev_events(&events, &index, &overflow) == 0)
+			break;
+	}
+
+	if (overflow) {
+		/*
+		 * The kernel dropped events, some transitions were never seen.
+		 * Reconcile the block subsystem right away instead of waiting
+		 * out the scan interval; the stale fingerprint keeps the
+		 * rescan confined to block devices.
+		 */
+		log_warning("udev receive buffer overrun, "
+			    "forcing block device rescan.");
+		device_block_rescan_force(ctx);
+		status = 0;
+	}
+
+	list_for_each(&events, ev) {
+		uint64_t t = timing_now_ns();
+
+		if (_apply_udev_event(ledmon_block_list, ctx, ev->syspath,
+				      ev->action) == 0)
+			status = 0;
+		timing_add(ctx, TIMING_UDEV_EVENT, t);
+	}
+
+	list_erase(&events);
+	hash_map_fini(&index);
 	return status;
 }
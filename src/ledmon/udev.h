@@ -4,9 +4,18 @@
 #ifndef _UDEV_H_INCLUDED_
 #define _UDEV_H_INCLUDED_
 
+#include <lib/hashmap.h>
 #include <lib/list.h>
 #include "sysfs.h"
 
+/**
+ * Index of devices from ledmon_block_list keyed by sysfs path. It is defined
+ * by the monitor service and used to avoid linear list walks when matching
+ * scanned devices and udev events. Entries reference items owned by
+ * ledmon_block_list.
+ */
+extern struct hash_map ledmon_block_map;
+
 /**
  */
 enum udev_action {
@@ -32,18 +41,20 @@ void stop_udev_monitor(void);
 int get_udev_monitor(void);
 
 /**
- * @brief Handles udev event.
+ * @brief Drains and handles pending udev events.
  *
- *        This function checks event type and if it is 'add' or remove
- *        function sets custom IBPI pattern to block device which is affected
- *        by this event.
+ *        This function drains everything pending on the udev monitor,
+ *        coalesces multiple events for the same device to the final action
+ *        and debounces bursts with a short quiet-period window. Afterwards
+ *        it sets custom IBPI patterns on the block devices affected by the
+ *        remaining 'add' and 'remove' events.
  *
  * @param[in]    ledmon_block_list    list containing block devices, it is
  *                                    used to match device from udev event.
  * @param[in]    ctx                  Library context.
  *
- * @return 0 if 'add' or 'remove' event handled successfully;
- *         1 if registered event is not 'add' or 'remove';
+ * @return 0 if at least one 'add' or 'remove' event was handled;
+ *         1 if no received event was 'add' or 'remove';
  *         -1 on libudev error.
  */
 int handle_udev_event(struct list *ledmon_block_list, struct led_ctx *ctx);
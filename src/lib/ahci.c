@@ -15,15 +15,23 @@
 
 #include "ahci.h"
 #include "config.h"
+#include "timing.h"
 #include "utils.h"
 #include "libled_private.h"
 
 /**
- * Time interval in nano seconds to wait before enclosure management message
- * is being sent to AHCI controller.
+ * Time interval in nano seconds to wait between transmit attempts to a port
+ * whose previous enclosure management message is still in flight.
  */
 #define EM_MSG_WAIT       1500000	/* 0.0015 seconds */
 
+/**
+ * Deadline for transmitting the queued messages of one controller. A port
+ * busy past this point loses its update and an error is logged; the pattern
+ * is re-sent once the monitor detects the drift.
+ */
+#define EM_FLUSH_DEADLINE 50000000	/* 0.05 seconds */
+
 /**
  * This array maps IBPI pattern to value recognized by AHCI driver. The driver
  * uses this control number to issue SGPIO signals appropriately.
@@ -44,13 +52,70 @@ static const struct ibpi2value ibpi2sgpio[] = {
 	{LED_IBPI_PATTERN_UNKNOWN, 0x00000000},
 };
 
+/**
+ * @brief Writes one enclosure management message.
+ *
+ * This is internal function of ahci module. The AHCI driver rejects the
+ * write with EBUSY while the previous transmission of the port is still in
+ * flight, the caller then retries.
+ *
+ * @return 0 if transmitted, -EBUSY when the port is busy, -1 on any other
+ *         error (already logged).
+ */
+static int _em_msg_write(struct led_ctx *ctx, const char *path, uint32_t value)
+{
+	char temp[WRITE_BUFFER_SIZE];
+
+	snprintf(temp, WRITE_BUFFER_SIZE, "%u", value);
+	if (buf_write(path, temp) == (ssize_t)strnlen(temp, WRITE_BUFFER_SIZE))
+		return 0;
+	if (errno == EBUSY || errno == EAGAIN)
+		return -EBUSY;
+	lib_log(ctx, LED_LOG_LEVEL_ERROR, "AHCI: %s write error: %d\n",
+		path, errno);
+	return -1;
+}
+
+/**
+ * @brief Queues an enclosure management message for the controller.
+ *
+ * This is internal function of ahci module. A message already queued for the
+ * same port is replaced, the change queued last wins.
+ *
+ * @return 0 if queued, 1 when the queue cannot take the message.
+ */
+static int _queue_em_msg(struct cntrl_device *cntrl, const char *path,
+			 uint32_t value)
+{
+	struct ahci_em_queue *queue = cntrl->ahci_em;
+	int i;
+
+	if (!queue) {
+		queue = calloc(1, sizeof(*queue));
+		if (!queue)
+			return 1;
+		cntrl->ahci_em = queue;
+	}
+
+	for (i = 0; i < queue->count; i++)
+		if (strcmp(queue->updates[i].path, path) == 0) {
+			queue->updates[i].value = value;
+			return 0;
+		}
+	if (queue->count >= AHCI_EM_MAX_UPDATES)
+		return 1;
+	str_cpy(queue->updates[queue->count].path, path, PATH_MAX);
+	queue->updates[queue->count].value = value;
+	queue->count++;
+	return 0;
+}
+
 /*
  * The function sends a LED control message to AHCI controller. It uses
  * SGPIO to control the LEDs. See ahci.h for details.
  */
 status_t ahci_sgpio_write(struct block_device *device, enum led_ibpi_pattern ibpi)
 {
-	char temp[WRITE_BUFFER_SIZE];
 	char path[PATH_MAX];
 	char *sysfs_path = device->cntrl_path;
 	const struct timespec waittime = {
@@ -76,20 +141,76 @@ status_t ahci_sgpio_write(struct block_device *device, enum led_ibpi_pattern ibp
 		return STATUS_INVALID_STATE;
 	}
 
-	snprintf(temp, WRITE_BUFFER_SIZE, "%u", ibpi2val->value);
-
 	snprintf(path, sizeof(path), "%s/em_message", sysfs_path);
 
-	nanosleep(&waittime, NULL);
+	/* Queue the message, ahci_flush() transmits it with the rest. */
+	if (_queue_em_msg(device->cntrl, path, ibpi2val->value) == 0)
+		return STATUS_SUCCESS;
 
-	if (buf_write(path, temp) != (ssize_t) strnlen(temp, WRITE_BUFFER_SIZE)) {
-		lib_log(device->cntrl->ctx, LED_LOG_LEVEL_ERROR,
-			"AHCI: %s write error: %d\n", path, errno);
+	/* Queue full, transmit directly with the historic fixed pacing. */
+	nanosleep(&waittime, NULL);
+	if (_em_msg_write(device->cntrl->ctx, path, ibpi2val->value) != 0)
 		return STATUS_FILE_WRITE_ERROR;
-	}
 	return STATUS_SUCCESS;
 }
 
+/*
+ * Transmits the queued enclosure management messages of one controller. See
+ * ahci.h for details.
+ */
+int ahci_flush(struct block_device *device)
+{
+	const struct timespec waittime = {
+		.tv_sec = 0,
+		.tv_nsec = EM_MSG_WAIT
+	};
+	struct ahci_em_queue *queue = device->cntrl->ahci_em;
+	struct led_ctx *ctx = device->cntrl->ctx;
+	uint64_t deadline;
+	int pending, rc = 0;
+
+	if (!queue || queue->count == 0)
+		return 0;
+	pending = queue->count;
+	queue->count = 0;
+
+	deadline = timing_now_ns() + EM_FLUSH_DEADLINE;
+	while (pending > 0) {
+		int busy = 0, i;
+
+		for (i = 0; i < pending; i++) {
+			struct ahci_em_update *up = &queue->updates[i];
+
+			switch (_em_msg_write(ctx, up->path, up->value)) {
+			case -EBUSY:
+				/*
+				 * Keep for the next sweep; busy never
+				 * overtakes i, the compaction is in place.
+				 */
+				queue->updates[busy++] = *up;
+				break;
+			case -1:
+				rc = 1;
+				break;
+			default:
+				break;
+			}
+		}
+		if (busy == 0)
+			break;
+		if (timing_now_ns() >= deadline) {
+			lib_log(ctx, LED_LOG_LEVEL_ERROR,
+				"AHCI: %d message(s) dropped, port stayed busy.\n",
+				busy);
+			rc = 1;
+			break;
+		}
+		nanosleep(&waittime, NULL);
+		pending = busy;
+	}
+	return rc;
+}
+
 #define SCSI_HOST "/scsi_host"
 /*
  * The function return path to SATA port in sysfs tree. See ahci.h for details.
@@ -4,9 +4,29 @@
 #ifndef _AHCI_H_INCLUDED_
 #define _AHCI_H_INCLUDED_
 
+#include <limits.h>
+#include <stdint.h>
+
 #include "block.h"
 #include "led/libled.h"
 
+/**
+ * Pending enclosure management messages of one AHCI controller, at most one
+ * per SATA port. Allocated lazily by the first queued message and owned by
+ * the controller device.
+ */
+#define AHCI_EM_MAX_UPDATES	32
+
+struct ahci_em_update {
+	char path[PATH_MAX];
+	uint32_t value;
+};
+
+struct ahci_em_queue {
+	struct ahci_em_update updates[AHCI_EM_MAX_UPDATES];
+	int count;
+};
+
 /**
  * @brief Gets sysfs path to SATA port.
  *
@@ -34,4 +54,19 @@ char *ahci_get_port_path(const char *path);
  */
 status_t ahci_sgpio_write(struct block_device *path, enum led_ibpi_pattern ibpi);
 
+/**
+ * @brief Transmits the queued enclosure management messages.
+ *
+ * This function writes the messages queued by ahci_sgpio_write() for the
+ * controller of the given device in one pass. A port whose previous
+ * transmission is still in flight reports busy and is retried between the
+ * writes of the other ports until a short deadline, so the common idle case
+ * pays no fixed wait at all.
+ *
+ * @param[in]      device         First block device of the flushed controller.
+ *
+ * @return 0 if every message was transmitted, 1 otherwise.
+ */
+int ahci_flush(struct block_device *device);
+
 #endif				/* _AHCI_H_INCLUDED_ */
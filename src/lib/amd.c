@@ -97,7 +97,7 @@ int amd_em_enabled(const char *path, struct led_ctx *ctx)
 	/* Default to SGPIO interface */
 	amd_interface = AMD_INTF_SGPIO;
 
-	platform = get_text_to_dest("/sys/class/dmi/id", "product_name", buf, sizeof(buf));
+	platform = get_text_to_dest(sysfs_path("/sys/class/dmi/id"), "product_name", buf, sizeof(buf));
 	if (!platform)
 		return 0;
 
@@ -146,6 +146,17 @@ status_t amd_write(struct block_device *device, enum led_ibpi_pattern ibpi)
 	}
 }
 
+int amd_flush(struct block_device *device)
+{
+	switch (amd_interface) {
+	case AMD_INTF_IPMI:
+		return _amd_ipmi_flush(device);
+	default:
+		/* SGPIO writes are applied directly by amd_write(). */
+		return 0;
+	}
+}
+
 char *amd_get_path(const char *cntrl_path, const char *sysfs_path, struct led_ctx *ctx)
 {
 	char *path;
@@ -37,6 +37,7 @@ extern enum amd_ipmi_platforms amd_ipmi_platform;
 
 int amd_em_enabled(const char *path, struct led_ctx *ctx);
 status_t amd_write(struct block_device *device, enum led_ibpi_pattern ibpi);
+int amd_flush(struct block_device *device);
 char *amd_get_path(const char *cntrl_path, const char *sysfs_path, struct led_ctx *ctx);
 
 int _find_file_path(const char *start_path, const char *filename,
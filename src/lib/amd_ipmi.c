@@ -89,7 +89,7 @@ static int _get_ipmi_nvme_port(char *path, struct led_ctx *ctx)
 
 	*f = '\0';
 
-	rc = scan_dir("/sys/bus/pci/slots", &dir);
+	rc = scan_dir(sysfs_path("/sys/bus/pci/slots"), &dir);
 	if (rc)
 		return -1;
 
@@ -279,83 +279,212 @@ static int _ipmi_platform_tail_address(struct amd_drive *drive)
 	return rc;
 }
 
-static int _set_ipmi_register(int enable, uint8_t reg, struct amd_drive *drive)
+/**
+ * One register update of a batched IPMI transaction, see
+ * _set_ipmi_registers().
+ */
+struct ipmi_reg_update {
+	uint8_t reg;
+	uint8_t enable;
+};
+
+/**
+ * @brief Updates the drive bay bit in a set of backplane registers.
+ *
+ * The current settings of all registers are fetched in one pipelined IPMI
+ * transaction and the modified values are written back in a second one, so a
+ * batch of register updates costs two round trips to the BMC instead of two
+ * per register. Registers whose drive bay bit already has the requested value
+ * are not written at all.
+ */
+static int _set_ipmi_registers(struct amd_drive *drive,
+			       const struct ipmi_reg_update *updates, size_t count)
 {
+	struct ipmi_cmd cmds[count];
+	uint8_t cmd_data[count][5];
+	uint8_t status[count];
+	size_t i, sets = 0;
 	int rc;
-	int status, data_sz;
-	uint8_t drives_status;
-	uint8_t new_drives_status;
-	uint8_t cmd_data[5];
-
-	memset(cmd_data, 0, sizeof(cmd_data));
 
 	rc = _ipmi_platform_channel(drive);
 	rc |= _ipmi_platform_tail_address(drive);
 	if (rc)
 		return -1;
 
-	cmd_data[0] = drive->channel;
-	cmd_data[1] = drive->tail_addr;
-	cmd_data[2] = 0x1;
-	cmd_data[3] = reg;
-
-	/* Find current register setting */
-	status = 0;
+	memset(cmds, 0, sizeof(cmds));
+	memset(cmd_data, 0, sizeof(cmd_data));
+	memset(status, 0, sizeof(status));
 
+	/* Find the current register settings */
 	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, "Retrieving current register status\n");
-	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_2, "channel", cmd_data[0],
-		"tail addr", cmd_data[1]);
-	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_2, "len", cmd_data[2],
-		"register", cmd_data[3]);
+	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_2, "channel", drive->channel,
+		"tail addr", drive->tail_addr);
+
+	for (i = 0; i < count; i++) {
+		cmd_data[i][0] = drive->channel;
+		cmd_data[i][1] = drive->tail_addr;
+		cmd_data[i][2] = 0x1;
+		cmd_data[i][3] = updates[i].reg;
+		cmds[i].ta = BMC_TA;
+		cmds[i].netfn = AMD_IPMI_NETFN;
+		cmds[i].cmd = AMD_IPMI_CMD;
+		cmds[i].datalen = 4;
+		cmds[i].data = cmd_data[i];
+		cmds[i].resplen = 1;
+		cmds[i].resp = &status[i];
+	}
 
-	rc = ipmicmd(drive->ctx, BMC_TA, 0x0, AMD_IPMI_NETFN, AMD_IPMI_CMD, 4, &cmd_data,
-		     1, &data_sz, &status);
-	if (rc) {
+	if (ipmicmd_many(drive->ctx, cmds, count)) {
 		lib_log(drive->ctx, LED_LOG_LEVEL_ERROR,
-			"Could not determine current register %x setting\n", reg);
-		return rc;
+			"Could not determine current register settings\n");
+		return -1;
 	}
 
-	drives_status = status;
+	/* Set the appropriate status */
+	for (i = 0; i < count; i++) {
+		uint8_t new_status;
+
+		if (updates[i].enable)
+			new_status = status[i] | drive->drive_bay;
+		else
+			new_status = status[i] & ~drive->drive_bay;
+		if (new_status == status[i])
+			continue;
+
+		lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG,
+			"Updating register status: %x -> %x\n",
+			status[i], new_status);
+		lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_2, "register",
+			updates[i].reg, "status", new_status);
+
+		memset(&cmds[sets], 0, sizeof(cmds[sets]));
+		cmd_data[sets][0] = drive->channel;
+		cmd_data[sets][1] = drive->tail_addr;
+		cmd_data[sets][2] = 0x1;
+		cmd_data[sets][3] = updates[i].reg;
+		cmd_data[sets][4] = new_status;
+		cmds[sets].ta = BMC_TA;
+		cmds[sets].netfn = AMD_IPMI_NETFN;
+		cmds[sets].cmd = AMD_IPMI_CMD;
+		cmds[sets].datalen = 5;
+		cmds[sets].data = cmd_data[sets];
+		cmds[sets].resplen = 1;
+		cmds[sets].resp = &status[sets];
+		sets++;
+	}
 
-	if (enable)
-		new_drives_status = drives_status | drive->drive_bay;
-	else
-		new_drives_status = drives_status & ~drive->drive_bay;
+	if (!sets)
+		return 0;
 
-	/* Set the appropriate status */
-	status = 0;
-	cmd_data[4] = new_drives_status;
+	if (ipmicmd_many(drive->ctx, cmds, sets)) {
+		lib_log(drive->ctx, LED_LOG_LEVEL_ERROR,
+			"Could not update registers\n");
+		return -1;
+	}
 
+	return 0;
+}
 
-	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, "Updating register status: %x -> %x\n",
-		drives_status, new_drives_status);
-	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_2, "channel", cmd_data[0],
-		"tail addr", cmd_data[1]);
-	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_2, "len", cmd_data[2],
-		"register", cmd_data[3]);
-	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_1, "status", cmd_data[4]);
+/* Control registers carrying one drive bay bit per drive, in pending table
+ * order. Register 0x3c enables SMBUS control, the remaining ones select the
+ * IBPI patterns, see ibpi2amd_ipmi.
+ */
+static const uint8_t _amd_ipmi_regs[AMD_IPMI_CTRL_REGS] = {
+	0x3c, 0x41, 0x42, 0x44, 0x45, 0x46, 0x47
+};
 
-	rc = ipmicmd(drive->ctx, BMC_TA, 0x0, AMD_IPMI_NETFN, AMD_IPMI_CMD, 5, &cmd_data,
-		     1, &data_sz, &status);
-	if (rc) {
-		lib_log(drive->ctx, LED_LOG_LEVEL_ERROR, "Could not enable register %x\n", reg);
-		return rc;
+static int _reg_slot(uint8_t reg)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(_amd_ipmi_regs); i++) {
+		if (_amd_ipmi_regs[i] == reg)
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Queues one drive bay bit change for the controller flush.
+ *
+ * The change is merged into the pending entry of the backplane chip the
+ * drive sits behind; _amd_ipmi_flush() later applies all entries. A later
+ * update of the same bit overrides an earlier queued one.
+ *
+ * @return 0 when queued, 1 when the update does not fit the pending table
+ *         and the caller must write the registers directly.
+ */
+static int _queue_ipmi_update(struct amd_drive *drive, uint8_t reg, uint8_t enable)
+{
+	struct amd_ipmi_state *state = &drive->ctx->amd_ipmi;
+	struct amd_ipmi_chip *chip = NULL;
+	int i, slot;
+
+	slot = _reg_slot(reg);
+	if (slot < 0)
+		return 1;
+
+	for (i = 0; i < state->chip_count; i++) {
+		if (state->chips[i].channel == drive->channel &&
+		    state->chips[i].tail_addr == drive->tail_addr) {
+			chip = &state->chips[i];
+			break;
+		}
+	}
+
+	if (!chip) {
+		if (state->chip_count == AMD_IPMI_MAX_CHIPS)
+			return 1;
+		chip = &state->chips[state->chip_count++];
+		memset(chip, 0, sizeof(*chip));
+		chip->channel = drive->channel;
+		chip->tail_addr = drive->tail_addr;
+	}
+
+	if (enable) {
+		chip->set[slot] |= drive->drive_bay;
+		chip->clr[slot] &= ~drive->drive_bay;
+	} else {
+		chip->clr[slot] |= drive->drive_bay;
+		chip->set[slot] &= ~drive->drive_bay;
 	}
 
 	return 0;
 }
 
-static int _enable_smbus_control(struct amd_drive *drive)
+/**
+ * @brief Queues a batch of register updates for the controller flush.
+ *
+ * Updates of drives behind the same backplane chip accumulate in the library
+ * context until led_flush() writes them out, so a flush cycle costs two BMC
+ * round trips per chip no matter how many drives changed state. Falls back
+ * to writing the registers directly when the pending table is full.
+ */
+static int _queue_ipmi_registers(struct amd_drive *drive,
+				 const struct ipmi_reg_update *updates, size_t count)
 {
-	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, "Enabling SMBUS Control\n");
-	return _set_ipmi_register(1, 0x3c, drive);
+	size_t i;
+	int rc;
+
+	rc = _ipmi_platform_channel(drive);
+	rc |= _ipmi_platform_tail_address(drive);
+	if (rc)
+		return -1;
+
+	for (i = 0; i < count; i++) {
+		if (_queue_ipmi_update(drive, updates[i].reg, updates[i].enable))
+			return _set_ipmi_registers(drive, updates, count);
+	}
+
+	return 0;
 }
 
 static status_t _change_ibpi_state(struct amd_drive *drive, enum led_ibpi_pattern ibpi, bool enable)
 {
 	const struct ibpi2value *ibpi2val = get_by_ibpi(ibpi, ibpi2amd_ipmi,
 							ARRAY_SIZE(ibpi2amd_ipmi));
+	struct ipmi_reg_update update;
 
 	if (ibpi2val->ibpi == LED_IBPI_PATTERN_UNKNOWN) {
 		lib_log(drive->ctx, LED_LOG_LEVEL_INFO,
@@ -366,22 +495,36 @@ static status_t _change_ibpi_state(struct amd_drive *drive, enum led_ibpi_patter
 	lib_log(drive->ctx, LED_LOG_LEVEL_DEBUG, "%s %s LED\n", (enable) ? "Enabling" : "Disabling",
 		ibpi2str(ibpi));
 
-	if (_set_ipmi_register(enable, ibpi2val->value, drive))
+	update.reg = ibpi2val->value;
+	update.enable = enable ? 1 : 0;
+	if (_queue_ipmi_registers(drive, &update, 1))
 		return STATUS_FILE_WRITE_ERROR;
 	return STATUS_SUCCESS;
 }
 
 static status_t _disable_all_ibpi_states(struct amd_drive *drive)
 {
-	int rc;
-
-	rc = _change_ibpi_state(drive, LED_IBPI_PATTERN_PFA, false);
-	rc |= _change_ibpi_state(drive, LED_IBPI_PATTERN_LOCATE, false);
-	rc |= _change_ibpi_state(drive, LED_IBPI_PATTERN_FAILED_DRIVE, false);
-	rc |= _change_ibpi_state(drive, LED_IBPI_PATTERN_FAILED_ARRAY, false);
-	rc |= _change_ibpi_state(drive, LED_IBPI_PATTERN_REBUILD, false);
+	const enum led_ibpi_pattern patterns[] = {
+		LED_IBPI_PATTERN_PFA,
+		LED_IBPI_PATTERN_LOCATE,
+		LED_IBPI_PATTERN_FAILED_DRIVE,
+		LED_IBPI_PATTERN_FAILED_ARRAY,
+		LED_IBPI_PATTERN_REBUILD,
+	};
+	struct ipmi_reg_update updates[ARRAY_SIZE(patterns)];
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+		const struct ibpi2value *ibpi2val =
+			get_by_ibpi(patterns[i], ibpi2amd_ipmi,
+				    ARRAY_SIZE(ibpi2amd_ipmi));
+
+		updates[i].reg = ibpi2val->value;
+		updates[i].enable = 0;
+	}
 
-	if (rc)
+	/* All pattern registers are cleared in one batched transaction. */
+	if (_queue_ipmi_registers(drive, updates, ARRAY_SIZE(updates)))
 		return STATUS_FILE_WRITE_ERROR;
 	return STATUS_SUCCESS;
 }
@@ -427,6 +570,8 @@ int _amd_ipmi_em_enabled(const char *path, struct led_ctx *ctx)
 
 status_t _amd_ipmi_write(struct block_device *device, enum led_ibpi_pattern ibpi)
 {
+	struct ipmi_reg_update updates[2];
+	const struct ibpi2value *ibpi2val;
 	struct amd_drive drive;
 
 	memset(&drive, 0, sizeof(struct amd_drive));
@@ -444,10 +589,134 @@ status_t _amd_ipmi_write(struct block_device *device, enum led_ibpi_pattern ibpi
 	if (ibpi == LED_IBPI_PATTERN_LOCATE_OFF)
 		return _change_ibpi_state(&drive, LED_IBPI_PATTERN_LOCATE, false);
 
-	if (_enable_smbus_control(&drive))
+	ibpi2val = get_by_ibpi(ibpi, ibpi2amd_ipmi, ARRAY_SIZE(ibpi2amd_ipmi));
+	if (ibpi2val->ibpi == LED_IBPI_PATTERN_UNKNOWN) {
+		lib_log(drive.ctx, LED_LOG_LEVEL_INFO,
+			"AMD_IPMI: Controller doesn't support %s pattern\n", ibpi2str(ibpi));
+		return STATUS_INVALID_STATE;
+	}
+
+	lib_log(drive.ctx, LED_LOG_LEVEL_DEBUG, "Enabling %s LED\n", ibpi2str(ibpi));
+
+	/* Enable SMBUS control and the pattern register in one transaction. */
+	updates[0].reg = 0x3c;
+	updates[0].enable = 1;
+	updates[1].reg = ibpi2val->value;
+	updates[1].enable = 1;
+	if (_queue_ipmi_registers(&drive, updates, ARRAY_SIZE(updates)))
 		return STATUS_FILE_WRITE_ERROR;
+	return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Writes the pending register updates of one backplane chip.
+ *
+ * The current settings of all touched registers are fetched in one pipelined
+ * IPMI transaction, the merged drive bay bits of every queued drive are
+ * applied and the registers whose value actually changes are written back in
+ * a second one.
+ */
+static int _flush_chip(struct led_ctx *ctx, struct amd_ipmi_chip *chip)
+{
+	struct ipmi_cmd cmds[AMD_IPMI_CTRL_REGS];
+	uint8_t cmd_data[AMD_IPMI_CTRL_REGS][5];
+	uint8_t status[AMD_IPMI_CTRL_REGS];
+	uint8_t slots[AMD_IPMI_CTRL_REGS];
+	size_t i, count = 0, sets = 0;
 
-	return _change_ibpi_state(&drive, ibpi, true);
+	memset(cmds, 0, sizeof(cmds));
+	memset(cmd_data, 0, sizeof(cmd_data));
+	memset(status, 0, sizeof(status));
+
+	lib_log(ctx, LED_LOG_LEVEL_DEBUG, "Flushing queued register updates\n");
+	lib_log(ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_2, "channel", chip->channel,
+		"tail addr", chip->tail_addr);
+
+	for (i = 0; i < AMD_IPMI_CTRL_REGS; i++) {
+		if (!(chip->set[i] | chip->clr[i]))
+			continue;
+
+		slots[count] = i;
+		cmd_data[count][0] = chip->channel;
+		cmd_data[count][1] = chip->tail_addr;
+		cmd_data[count][2] = 0x1;
+		cmd_data[count][3] = _amd_ipmi_regs[i];
+		cmds[count].ta = BMC_TA;
+		cmds[count].netfn = AMD_IPMI_NETFN;
+		cmds[count].cmd = AMD_IPMI_CMD;
+		cmds[count].datalen = 4;
+		cmds[count].data = cmd_data[count];
+		cmds[count].resplen = 1;
+		cmds[count].resp = &status[count];
+		count++;
+	}
+
+	if (!count)
+		return 0;
+
+	if (ipmicmd_many(ctx, cmds, count)) {
+		lib_log(ctx, LED_LOG_LEVEL_ERROR,
+			"Could not determine current register settings\n");
+		return 1;
+	}
+
+	for (i = 0; i < count; i++) {
+		uint8_t slot = slots[i];
+		uint8_t new_status;
+
+		new_status = (status[i] | chip->set[slot]) & ~chip->clr[slot];
+		if (new_status == status[i])
+			continue;
+
+		lib_log(ctx, LED_LOG_LEVEL_DEBUG,
+			"Updating register status: %x -> %x\n",
+			status[i], new_status);
+		lib_log(ctx, LED_LOG_LEVEL_DEBUG, REG_FMT_2, "register",
+			_amd_ipmi_regs[slot], "status", new_status);
+
+		memset(&cmds[sets], 0, sizeof(cmds[sets]));
+		cmd_data[sets][0] = chip->channel;
+		cmd_data[sets][1] = chip->tail_addr;
+		cmd_data[sets][2] = 0x1;
+		cmd_data[sets][3] = _amd_ipmi_regs[slot];
+		cmd_data[sets][4] = new_status;
+		cmds[sets].ta = BMC_TA;
+		cmds[sets].netfn = AMD_IPMI_NETFN;
+		cmds[sets].cmd = AMD_IPMI_CMD;
+		cmds[sets].datalen = 5;
+		cmds[sets].data = cmd_data[sets];
+		cmds[sets].resplen = 1;
+		cmds[sets].resp = &status[sets];
+		sets++;
+	}
+
+	if (!sets)
+		return 0;
+
+	if (ipmicmd_many(ctx, cmds, sets)) {
+		lib_log(ctx, LED_LOG_LEVEL_ERROR, "Could not update registers\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int _amd_ipmi_flush(struct block_device *device)
+{
+	struct led_ctx *ctx = device->cntrl->ctx;
+	struct amd_ipmi_state *state = &ctx->amd_ipmi;
+	int i, rc = 0;
+
+	/* The first device of the flush cycle writes out all chips, the
+	 * remaining ones find the pending table empty.
+	 */
+	for (i = 0; i < state->chip_count; i++) {
+		if (_flush_chip(ctx, &state->chips[i]))
+			rc = 1;
+	}
+	state->chip_count = 0;
+
+	return rc;
 }
 
 char *_amd_ipmi_get_path(const char *cntrl_path, const char *sysfs_path)
@@ -7,4 +7,5 @@
 
 int _amd_ipmi_em_enabled(const char *path, struct led_ctx *ctx);
 status_t _amd_ipmi_write(struct block_device *device, enum led_ibpi_pattern ibpi);
+int _amd_ipmi_flush(struct block_device *device);
 char *_amd_ipmi_get_path(const char *cntrl_path, const char *sysfs_path);
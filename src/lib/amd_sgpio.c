@@ -431,8 +431,27 @@ static void _dump_sgpio_amd(struct led_ctx *ctx, const char *type, sgpio_amd_t a
 		get_sgpio_amd_return_to_normal(&amd));
 }
 
+/**
+ * @brief Folds the requested pattern into the cached blink generator state.
+ *
+ * This is internal function of amd_sgpio module. The function applies the
+ * blink generator update the configuration register write would carry, so
+ * the cache entry can be compared against its previous content before any
+ * register is written.
+ *
+ * @param[in]      cache          Cache entry of the drive bank.
+ * @param[in]      ibpi           Requested IBPI pattern.
+ */
+static void _update_blink_gen(struct cache_entry *cache, int ibpi)
+{
+	if (cache->blink_gen_a)
+		cache->blink_gen_b = ibpi_pattern[ibpi];
+	else
+		cache->blink_gen_a = ibpi_pattern[ibpi];
+}
+
 static int _write_cfg_register(struct led_ctx *ctx, const char *em_buffer_path,
-			       struct cache_entry *cache, int ibpi)
+			       const struct cache_entry *cache)
 {
 	struct config_register cfg_reg;
 
@@ -440,11 +459,6 @@ static int _write_cfg_register(struct led_ctx *ctx, const char *em_buffer_path,
 	cfg_reg.req = _init_sgpio_req(0x40, 0x82, SGPIO_REQ_REG_TYPE_CFG,
 				      0, 2);
 
-	if (cache->blink_gen_a)
-		cache->blink_gen_b = ibpi_pattern[ibpi];
-	else
-		cache->blink_gen_a = ibpi_pattern[ibpi];
-
 	cfg_reg.cfg = _init_sgpio_cfg(1, cache->blink_gen_a,
 				      cache->blink_gen_b, 2, 1, 0, 0);
 
@@ -639,22 +653,40 @@ static int _set_ibpi(struct block_device *device, enum led_ibpi_pattern ibpi)
 	/* Save copy of cache entry */
 	memcpy(&cache_dup, cache, sizeof(cache_dup));
 
+	/* Update the shadow state first. The cache entry holds the register
+	 * values last accepted by the hardware, so when the update leaves
+	 * the entry untouched the EM buffer already carries the requested
+	 * pattern and the whole cfg+tx+amd frame sequence can be skipped.
+	 */
+	_update_blink_gen(cache, ibpi);
+	memset(&tx_reg, 0, sizeof(tx_reg));
+	_set_tx_drive_leds(&tx_reg, cache, drive.drive_bay, ibpi);
+
+	if (cache->wr_valid &&
+	    memcmp(cache, &cache_dup, sizeof(cache_dup)) == 0) {
+		lib_log(drive.ctx, LED_LOG_LEVEL_DEBUG,
+			"\tpattern already set, skipping SGPIO writes");
+		_put_cache(drive.ctx);
+		return 0;
+	}
+
 	rc = _write_amd_register(device->cntrl_path, &drive);
 	if (rc)
 		goto _set_ibpi_error;
 
-	rc = _write_cfg_register(device->cntrl->ctx, device->cntrl_path, cache, ibpi);
+	rc = _write_cfg_register(device->cntrl->ctx, device->cntrl_path, cache);
 	if (rc)
 		goto _set_ibpi_error;
 
-	memset(&tx_reg, 0, sizeof(tx_reg));
-	_set_tx_drive_leds(&tx_reg, cache, drive.drive_bay, ibpi);
 	rc = _write_tx_register(device->cntrl->ctx, device->cntrl_path, &tx_reg);
 
 _set_ibpi_error:
 	if (rc) {
-		/* Restore saved cache entry */
+		/* Restore saved cache entry, force a rewrite next time */
 		memcpy(cache, &cache_dup, sizeof(*cache));
+		cache->wr_valid = 0;
+	} else {
+		cache->wr_valid = 1;
 	}
 
 	_put_cache(device->cntrl->ctx);
@@ -679,11 +711,15 @@ static int _amd_sgpio_init_one(const char *path, struct amd_drive *drive,
 	if (rc)
 		return rc;
 
-	rc = _write_cfg_register(drive->ctx, path, cache, LED_IBPI_PATTERN_NONE);
+	_update_blink_gen(cache, LED_IBPI_PATTERN_NONE);
+	rc = _write_cfg_register(drive->ctx, path, cache);
 	if (rc)
 		return rc;
 
-	return _write_tx_register(drive->ctx, path, &tx_reg);
+	rc = _write_tx_register(drive->ctx, path, &tx_reg);
+	if (rc == 0)
+		cache->wr_valid = 1;
+	return rc;
 }
 
 static int _amd_sgpio_init(const char *path, struct led_ctx *ctx)
@@ -721,8 +757,9 @@ static int _amd_sgpio_init(const char *path, struct led_ctx *ctx)
 		lib_log(ctx, LED_LOG_LEVEL_ERROR,
 			"SGPIO register init failed for bank %d, %s", drive.initiator, em_path);
 
-		/* Restore saved cache entry */
+		/* Restore saved cache entry, force a rewrite next time */
 		memcpy(cache, &cache_dup, sizeof(*cache));
+		cache->wr_valid = 0;
 
 		goto _init_amd_sgpio_err;
 	}
@@ -760,8 +797,9 @@ static int _amd_sgpio_init(const char *path, struct led_ctx *ctx)
 			"SGPIO register init failed for bank %d, %s",
 			drive.initiator, em_path);
 
-		/* Restore saved cache entry */
+		/* Restore saved cache entry, force a rewrite next time */
 		memcpy(cache, &cache_dup, sizeof(*cache));
+		cache->wr_valid = 0;
 	}
 
 _init_amd_sgpio_err:
@@ -778,7 +816,7 @@ int _amd_sgpio_em_enabled(const char *path, struct led_ctx *ctx)
 	char buf[BUF_SZ_SM];
 
 	/* Check that libahci module was loaded with ahci_em_messages=1 */
-	p = get_text_to_dest("/sys/module/libahci/parameters", "ahci_em_messages",
+	p = get_text_to_dest(sysfs_path("/sys/module/libahci/parameters"), "ahci_em_messages",
 			     buf, sizeof(buf));
 	if (!p || (p && *p == 'N')) {
 		lib_log(ctx, LED_LOG_LEVEL_INFO,
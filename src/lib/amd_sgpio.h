@@ -19,11 +19,19 @@ struct drive_leds {
 	drive_led_t	activity;
 } __attribute__ ((__packed__));
 
+/**
+ * Shadow of the last LED state written to one bank of 4 drives. The entry
+ * mirrors the register values the hardware accepted: when an update leaves
+ * the entry unchanged and wr_valid is set, the whole cfg+tx+amd frame
+ * sequence is skipped. wr_valid is cleared on write errors, forcing a full
+ * rewrite on the next call.
+ */
 struct cache_entry {
 	struct drive_leds leds[4];
 	uint8_t blink_gen_a;
 	uint8_t blink_gen_b;
-	uint16_t reserved;
+	uint8_t wr_valid;
+	uint8_t reserved;
 } __attribute__ ((__packed__));
 
 int _amd_sgpio_em_enabled(const char *path, struct led_ctx *ctx);
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#include <string.h>
+
+#if _HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif
+
+#include "arena.h"
+
+/**
+ * Default chunk payload size. Large enough to hold hundreds of list nodes
+ * or a couple of slot properties per chunk.
+ */
+#define ARENA_CHUNK_SIZE	(64 * 1024)
+
+/**
+ * Every allocation is rounded up to this alignment, which is sufficient for
+ * any standard object type.
+ */
+#define ARENA_ALIGN		16
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	struct arena_chunk *chunk;
+	void *p;
+
+	size = (size + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1);
+
+	/* Chunks are reused after arena_reset(), look for free room first. */
+	for (chunk = arena->chunks; chunk; chunk = chunk->next)
+		if (chunk->size - chunk->used >= size)
+			break;
+
+	if (!chunk) {
+		size_t chunk_size = ARENA_CHUNK_SIZE;
+
+		if (chunk_size < size)
+			chunk_size = size;
+		chunk = malloc(sizeof(*chunk) + chunk_size);
+		if (!chunk)
+			return NULL;
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+
+	p = chunk->data + chunk->used;
+	chunk->used += size;
+	memset(p, 0, size);
+	return p;
+}
+
+char *arena_strdup(struct arena *arena, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *p = arena_alloc(arena, len);
+
+	if (p)
+		memcpy(p, str, len);
+	return p;
+}
+
+void arena_reset(struct arena *arena)
+{
+	struct arena_chunk *chunk;
+
+	for (chunk = arena->chunks; chunk; chunk = chunk->next)
+		chunk->used = 0;
+}
+
+void arena_fini(struct arena *arena)
+{
+	struct arena_chunk *chunk = arena->chunks;
+
+	while (chunk) {
+		struct arena_chunk *next = chunk->next;
+
+		free(chunk);
+		chunk = next;
+	}
+	arena->chunks = NULL;
+}
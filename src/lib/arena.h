@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _ARENA_H_INCLUDED_
+#define _ARENA_H_INCLUDED_
+
+#include <stdlib.h>
+
+/**
+ * Single arena chunk. Chunks are chained, allocation bumps a cursor inside
+ * the newest chunk.
+ */
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	size_t used;
+	unsigned char data[];
+};
+
+/**
+ * Bump allocator for objects sharing one lifetime. All allocations are
+ * released in a single arena_reset() call instead of individual free()
+ * calls. The library uses arenas for scan-lifetime objects owned by
+ * struct led_ctx, so a rescan is a pointer reset rather than thousands of
+ * malloc/free round trips. Objects drawn from an arena must never be passed
+ * to free().
+ */
+struct arena {
+	struct arena_chunk *chunks;
+};
+
+/**
+ * @brief Initializes an arena object.
+ *
+ * Initializes an arena object to reflect an empty state. Chunk storage is
+ * allocated lazily on first allocation.
+ *
+ * @param[in]      arena          pointer to an arena object.
+ */
+static inline void arena_init(struct arena *arena)
+{
+	arena->chunks = NULL;
+}
+
+/**
+ * @brief Allocates zeroed memory from the arena.
+ *
+ * The returned block is aligned suitably for any object type and zero
+ * filled. It stays valid until arena_reset() or arena_fini() is called.
+ *
+ * @param[in]      arena          pointer to an arena object.
+ * @param[in]      size           number of bytes to allocate.
+ *
+ * @return Pointer to memory block if successful, otherwise NULL pointer.
+ */
+void *arena_alloc(struct arena *arena, size_t size);
+
+/**
+ * @brief Duplicates a string into the arena.
+ *
+ * @param[in]      arena          pointer to an arena object.
+ * @param[in]      str            null-terminated string to copy.
+ *
+ * @return Pointer to the copy if successful, otherwise NULL pointer.
+ */
+char *arena_strdup(struct arena *arena, const char *str);
+
+/**
+ * @brief Releases all allocations at once, keeping chunk storage.
+ *
+ * This function rewinds all chunks so their memory can be reused by
+ * subsequent allocations without going back to the system allocator.
+ *
+ * @param[in]      arena          pointer to an arena object.
+ */
+void arena_reset(struct arena *arena);
+
+/**
+ * @brief Releases all memory held by the arena.
+ *
+ * The arena is left in initialized, empty state.
+ *
+ * @param[in]      arena          pointer to an arena object.
+ */
+void arena_fini(struct arena *arena);
+
+#endif				/* _ARENA_H_INCLUDED_ */
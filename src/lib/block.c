@@ -111,6 +111,14 @@ static void _set_flush_message_fn(struct block_device *device)
 			device->flush_message_fn = scsi_smp_write_buffer;
 		else
 			device->flush_message_fn = scsi_ses_flush;
+	} else if (device->cntrl->cntrl_type == LED_CNTRL_TYPE_NPEM) {
+		device->flush_message_fn = npem_flush;
+	} else if (device->cntrl->cntrl_type == LED_CNTRL_TYPE_AMD) {
+		device->flush_message_fn = amd_flush;
+	} else if (device->cntrl->cntrl_type == LED_CNTRL_TYPE_DELLSSD) {
+		device->flush_message_fn = dellssd_flush;
+	} else if (device->cntrl->cntrl_type == LED_CNTRL_TYPE_AHCI) {
+		device->flush_message_fn = ahci_flush;
 	} else {
 		device->flush_message_fn = do_not_flush;
 	}
@@ -169,14 +177,14 @@ static int is_host_id_supported(const struct block_device *bd)
  * This is the internal function of 'block device' module. The function gets
  * a pointer to controller structure the device is connected to.
  *
- * @param[in]      cntrl_list     pointer to list of supported controllers.
+ * @param[in]      cntrl_list     pointer to vector of supported controllers.
  * @param[in]      path           path to block device in sysfs tree.
  *
  * @return Pointer to controller structure if successful, otherwise the function
  *         returns NULL pointer. The NULL pointer means that block devices is
  *         connected to unsupported storage controller.
  */
-struct cntrl_device *block_get_controller(const struct list *cntrl_list, char *path)
+struct cntrl_device *block_get_controller(const struct vector *cntrl_list, char *path)
 {
 	struct cntrl_device *cntrl;
 	struct cntrl_device *non_npem_cntrl = NULL;
@@ -184,7 +192,7 @@ struct cntrl_device *block_get_controller(const struct list *cntrl_list, char *p
 	if (!cntrl_list || !path)
 		return non_npem_cntrl;
 
-	list_for_each(cntrl_list, cntrl) {
+	vector_for_each(cntrl_list, cntrl) {
 		if (cntrl) {
 			if (strncmp(cntrl->sysfs_path, path,
 				strnlen(cntrl->sysfs_path, PATH_MAX)) == 0) {
@@ -255,7 +263,7 @@ struct block_device *get_block_device_from_sysfs_path(struct led_ctx *ctx, char
 {
 	struct block_device *device;
 
-	list_for_each(sysfs_get_block_devices(ctx), device) {
+	vector_for_each(sysfs_get_block_devices(ctx), device) {
 			char *start_loc;
 			if ((start_loc = strstr(device->sysfs_path, sub_path))) {
 				char following = start_loc[strnlen(sub_path, PATH_MAX)];
@@ -272,7 +280,7 @@ struct block_device *get_block_device_from_sysfs_path(struct led_ctx *ctx, char
 /*
  * Allocates a new block device structure. See block.h for details.
  */
-struct block_device *block_device_init(const struct list *cntrl_list, const char *path)
+struct block_device *block_device_init(const struct vector *cntrl_list, const char *path)
 {
 	struct cntrl_device *cntrl;
 	char link[PATH_MAX];
@@ -308,10 +316,14 @@ struct block_device *block_device_init(const struct list *cntrl_list, const char
 
 	hosts = cntrl->hosts;
 	device->cntrl = cntrl;
-	device->sysfs_path = strdup(link);
+	device->sysfs_path = str_pool_intern(&cntrl->ctx->path_pool, link);
 	if (!device->sysfs_path)
 		goto error;
-	device->cntrl_path = host;
+	device->cntrl_path = str_pool_intern(&cntrl->ctx->path_pool, host);
+	free(host);
+	host = NULL;
+	if (!device->cntrl_path)
+		goto error;
 	block_set_devnode(device);
 	device->ibpi = LED_IBPI_PATTERN_UNKNOWN;
 	device->ibpi_prev = LED_IBPI_PATTERN_NONE;
@@ -328,6 +340,9 @@ struct block_device *block_device_init(const struct list *cntrl_list, const char
 	while (hosts) {
 		if (hosts->host_id == host_id) {
 			device->host = hosts;
+			/* Remember the bsg node, flushes write through it. */
+			if (!hosts->bsg_path)
+				hosts->bsg_path = device->cntrl_path;
 			break;
 		}
 		hosts = hosts->next;
@@ -345,10 +360,8 @@ struct block_device *block_device_init(const struct list *cntrl_list, const char
 	return device;
 error:
 	free(host);
-	if (device) {
-		free(device->sysfs_path);
-		free(device);
-	}
+	/* Interned paths are owned by the pool, only the device is freed. */
+	free(device);
 	return NULL;
 }
 
@@ -358,12 +371,7 @@ error:
 void block_device_fini(struct block_device *device)
 {
 	if (device) {
-		if (device->sysfs_path)
-			free(device->sysfs_path);
-
-		if (device->cntrl_path)
-			free(device->cntrl_path);
-
+		/* sysfs_path and cntrl_path are interned, the pool owns them. */
 		if (device->raid_dev)
 			raid_device_fini(device->raid_dev);
 
@@ -381,15 +389,9 @@ struct block_device *block_device_duplicate(struct block_device *block)
 	if (block) {
 		result = calloc(1, sizeof(*result));
 		if (result) {
-			result->sysfs_path = strdup(block->sysfs_path);
-			result->cntrl_path = strdup(block->cntrl_path);
-
-			if (!result->sysfs_path || !result->cntrl_path) {
-				free(result->sysfs_path);
-				free(result->cntrl_path);
-				free(result);
-				return NULL;
-			}
+			/* Both paths are interned, sharing them is free. */
+			result->sysfs_path = block->sysfs_path;
+			result->cntrl_path = block->cntrl_path;
 
 			if (block->ibpi != LED_IBPI_PATTERN_UNKNOWN)
 				result->ibpi = block->ibpi;
@@ -412,6 +414,44 @@ struct block_device *block_device_duplicate(struct block_device *block)
 	return result;
 }
 
+/*
+ * Transfers ownership of a scanned block device to the caller. See block.h
+ * for details.
+ */
+struct block_device *block_device_detach(struct led_ctx *ctx, struct block_device *block)
+{
+	struct vector *blocks;
+	struct block_device *tombstone;
+	size_t i;
+
+	if (!ctx || !block)
+		return NULL;
+
+	blocks = &ctx->sys.sysfs_block_list;
+	for (i = 0; i < blocks->count; i++)
+		if (blocks->items[i] == block)
+			break;
+	if (i == blocks->count)
+		return NULL;
+
+	tombstone = malloc(sizeof(*tombstone));
+	if (!tombstone)
+		return NULL;
+
+	/*
+	 * The tombstone takes the stolen device's place in the scanned model.
+	 * It shares the interned paths and the controller references, only
+	 * the RAID state moves out with the stolen structure.
+	 */
+	*tombstone = *block;
+	tombstone->raid_dev = NULL;
+	blocks->items[i] = tombstone;
+	if (tombstone->devnode[0])
+		hash_map_insert(&ctx->sys.devnode_map, tombstone->devnode,
+				tombstone);
+	return block;
+}
+
 int block_compare(const struct block_device *bd_old,
 		  const struct block_device *bd_new)
 {
@@ -459,8 +499,9 @@ int block_compare(const struct block_device *bd_old,
 		break;
 
 	case LED_CNTRL_TYPE_VMD:
-		/* compare names and address of the drive */
-		i = (strcmp(bd_old->sysfs_path, bd_new->sysfs_path) == 0);
+		/* Compare names and address of the drive. Paths are interned,
+		 * pointer equality implies string equality. */
+		i = (bd_old->sysfs_path == bd_new->sysfs_path);
 		if (!i) {
 			struct pci_slot *old_slot, *new_slot;
 
@@ -473,13 +514,13 @@ int block_compare(const struct block_device *bd_old,
 
 	case LED_CNTRL_TYPE_NPEM:
 		/* check controller to determine slot. */
-		i = (strcmp(bd_old->cntrl_path, bd_new->cntrl_path) == 0);
+		i = (bd_old->cntrl_path == bd_new->cntrl_path);
 		break;
 
 	case LED_CNTRL_TYPE_DELLSSD:
 	default:
-		/* Just compare names */
-		i = (strcmp(bd_old->sysfs_path, bd_new->sysfs_path) == 0);
+		/* Just compare interned names */
+		i = (bd_old->sysfs_path == bd_new->sysfs_path);
 		break;
 	}
 	return i;
@@ -27,7 +27,8 @@ struct block_device {
  * Real path in sysfs tree. This means i.e. if /sys/block/sda is symbolic link
  * then the link will be read and path stored in sysfs_path field. This path
  * may not exist in sysfs if connection to physical drive is lost. This filed
- * cannot have NULL pointer assigned.
+ * cannot have NULL pointer assigned. The string is interned in the context
+ * path pool and must not be modified or freed.
  */
 	char *sysfs_path;
 
@@ -60,7 +61,8 @@ struct block_device {
  * This path is always accessible even if the connection to physical device
  * is lost. In case of AHCI controller it points to SATA phy. In case of SAS
  * this path points to SES entry associated with the slot in an enclosure.
- * This field cannot have NULL pointer assign.
+ * This field cannot have NULL pointer assign. The string is interned in the
+ * context path pool and must not be modified or freed.
  */
 	char *cntrl_path;
 
@@ -109,6 +111,13 @@ struct block_device {
  * struct.
  */
 	struct raid_device *raid_dev;
+
+/**
+ * Generation of the last scan which saw the device in sysfs, see
+ * sysfs_rescan(). Devices missed for a number of generations are reaped
+ * from the device model.
+ */
+	unsigned int gen;
 };
 
 /**
@@ -119,14 +128,14 @@ struct block_device {
  * actions only if the block device is connected to the one of supported storage
  * controllers and the controller has enclosure management services enabled.
  *
- * @param[in]      cntrl_list     pointer to a list of supported controller
+ * @param[in]      cntrl_list     pointer to a vector of supported controller
  *                                devices.
  * @param[in]      sysfs_path     a path to block device in sysfs.
  *
  * @return Pointer to block device structure if successful, otherwise the function
  *         returns the NULL pointer.
  */
-struct block_device *block_device_init(const struct list *cntrl_list, const char *path);
+struct block_device *block_device_init(const struct vector *cntrl_list, const char *path);
 
 /**
  * @brief Releases a block device structure.
@@ -154,20 +163,40 @@ void block_device_fini(struct block_device *device);
  */
 struct block_device *block_device_duplicate(struct block_device *device);
 
+/**
+ * @brief Transfers ownership of a scanned block device to the caller.
+ *
+ * The function removes the given device from the scanned device model of the
+ * library context and replaces it with a shallow tombstone copy, so the model
+ * stays complete for subsequent scans and lookups. The caller becomes the
+ * owner of the original structure, including its RAID device state, and must
+ * release it with block_device_fini(). Unlike block_device_duplicate() no
+ * RAID state is copied, which makes the handoff allocation free apart from
+ * the tombstone itself.
+ *
+ * @param[in]      ctx            library context owning the scanned model.
+ * @param[in]      block          scanned device to take ownership of.
+ *
+ * @return Pointer to the detached block device structure if successful,
+ *         otherwise the function returns the NULL pointer and the device
+ *         stays owned by the library.
+ */
+struct block_device *block_device_detach(struct led_ctx *ctx, struct block_device *block);
+
 /**
  * @brief Determines a storage controller.
  *
  * This is the internal function of 'block device' module. The function gets
  * a pointer to controller structure the device is connected to.
  *
- * @param[in]      cntrl_list     pointer to list of supported controllers.
+ * @param[in]      cntrl_list     pointer to vector of supported controllers.
  * @param[in]      path           path to block device in sysfs tree.
  *
  * @return Pointer to controller structure if successful, otherwise the function
  *         returns NULL pointer. The NULL pointer means that block devices is
  *         connected to unsupported storage controller.
  */
-struct cntrl_device *block_get_controller(const struct list *cntrl_list, char *path);
+struct cntrl_device *block_get_controller(const struct vector *cntrl_list, char *path);
 
 /**
  * The global timestamp variable. It is updated every time the sysfs is scanning
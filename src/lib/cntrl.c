@@ -2,11 +2,13 @@
 // Copyright (C) 2022 Intel Corporation.
 
 #include <dirent.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #if _HAVE_DMALLOC_H
 #include <dmalloc.h>
@@ -118,15 +120,44 @@ static int _is_amd_cntrl(const char *path)
 
 extern int get_dell_server_type(struct led_ctx *ctx);
 
+/**
+ * @brief Translates a hexadecimal attribute content, p may be NULL.
+ */
+static uint64_t _attr_to_uint64(const char *p)
+{
+	uint64_t t;
+
+	if (!p)
+		return 0;
+	errno = 0;
+	t = strtoull(p, NULL, 16);
+	return errno ? 0 : t;
+}
+
 static int _is_dellssd_cntrl(const char *path, struct led_ctx *ctx)
 {
+	char vdr_buf[BUF_SZ_NUM], dev_buf[BUF_SZ_NUM];
+	char cls_buf[BUF_SZ_NUM], svdr_buf[BUF_SZ_NUM];
+	struct sysfs_attr attrs[] = {
+		{.name = "vendor", .buf = vdr_buf, .buf_size = sizeof(vdr_buf)},
+		{.name = "device", .buf = dev_buf, .buf_size = sizeof(dev_buf)},
+		{.name = "class", .buf = cls_buf, .buf_size = sizeof(cls_buf)},
+		{.name = "subsystem_vendor", .buf = svdr_buf, .buf_size = sizeof(svdr_buf)},
+	};
 	uint64_t vdr, dev, svdr, cls;
 	int gen = 0;
-
-	vdr = get_uint64(path, 0, "vendor");
-	dev = get_uint64(path, 0, "device");
-	cls = get_uint64(path, 0, "class");
-	svdr = get_uint64(path, 0, "subsystem_vendor");
+	int dirfd;
+
+	/* All identification attributes sit in one directory, batch them. */
+	dirfd = sysfs_open_dir(path);
+	sysfs_read_attrs(dirfd, attrs, ARRAY_SIZE(attrs));
+	if (dirfd >= 0)
+		close(dirfd);
+
+	vdr = _attr_to_uint64(attrs[0].value);
+	dev = _attr_to_uint64(attrs[1].value);
+	cls = _attr_to_uint64(attrs[2].value);
+	svdr = _attr_to_uint64(attrs[3].value);
 	if (cls == 0x10802)
 		gen = get_dell_server_type(ctx);
 
@@ -223,6 +254,8 @@ struct _host_type *alloc_host(int id, struct _host_type *next)
 		memset(host->bitstream, 0, sizeof(host->bitstream));
 		host->flush = 0;
 		host->ports = 0;
+		host->smp_fd = -1;
+		host->bsg_path = NULL;
 		host->next = next;
 	}
 	return host;
@@ -233,6 +266,8 @@ void free_hosts(struct _host_type *h)
 	struct _host_type *t;
 	while (h) {
 		t = h->next;
+		if (h->smp_fd >= 0)
+			close(h->smp_fd);
 		free(h->ibpi_state_buffer);
 		free(h);
 		h = t;
@@ -340,7 +375,7 @@ static unsigned int _ahci_em_messages(const char *path)
 	}
 
 	/* check if the directory /sys/module/libahci/holders exists */
-	dh = opendir("/sys/module/libahci/holders");
+	dh = opendir(sysfs_path("/sys/module/libahci/holders"));
 	if (dh) {
 		/* name contain controller name (ie. ahci),*/
 		/* so check if libahci holds this driver   */
@@ -357,42 +392,52 @@ static unsigned int _ahci_em_messages(const char *path)
 	}
 }
 
+/*
+ * Checks a controller path against the configured allow and exclude lists.
+ * See cntrl.h for details.
+ */
+int cntrl_path_allowed(struct led_ctx *ctx, const char *path)
+{
+	if (!list_is_empty(&ctx->config.allowlist)) {
+		if (!hash_map_find(&ctx->config.allow_map, path)) {
+			lib_log(ctx, LED_LOG_LEVEL_DEBUG,
+				"%s not found on ALLOWLIST, ignoring", path);
+			return 0;
+		}
+	} else if (!list_is_empty(&ctx->config.excludelist)) {
+		if (hash_map_find(&ctx->config.exclude_map, path)) {
+			lib_log(ctx, LED_LOG_LEVEL_DEBUG,
+				"%s found on EXCLUDELIST, ignoring", path);
+			return 0;
+		}
+	}
+	return 1;
+}
+
 /*
  * Allocates memory for a new controller device structure. See cntrl.h for
  * details.
  */
 struct cntrl_device *cntrl_device_init(const char *path, struct led_ctx *ctx)
 {
-	unsigned int em_enabled;
+	unsigned int em_enabled = 0;
 	enum led_cntrl_type type;
 	struct cntrl_device *device = NULL;
-
-	type = _get_type(path, ctx);
-	if (type != LED_CNTRL_TYPE_UNKNOWN) {
-		if (!list_is_empty(&ctx->config.allowlist)) {
-			char *cntrl = NULL;
-
-			list_for_each(&ctx->config.allowlist, cntrl) {
-				if (strcmp(cntrl, path) == 0)
-					break;
-				cntrl = NULL;
-			}
-			if (!cntrl) {
-				lib_log(ctx, LED_LOG_LEVEL_DEBUG,
-					"%s not found on ALLOWLIST, ignoring", path);
-				return NULL;
-			}
-		} else if (!list_is_empty(&ctx->config.excludelist)) {
-			char *cntrl;
-
-			list_for_each(&ctx->config.excludelist, cntrl) {
-				if (strcmp(cntrl, path) == 0) {
-					lib_log(ctx, LED_LOG_LEVEL_DEBUG,
-						"%s found on EXCLUDELIST, ignoring", path);
-					return NULL;
-				}
-			}
-		}
+	uintptr_t cached;
+
+	/*
+	 * Classifying a controller costs several readlink and directory
+	 * walks, yet hardware does not change type while the system is up.
+	 * Both results are remembered per path, encoded inline in the item
+	 * pointer with a low set bit so a cached entry is never NULL. The
+	 * cache is dropped when the PCI device or enclosure set changes.
+	 */
+	cached = (uintptr_t)hash_map_find(&ctx->cntrl_probe_cache, path);
+	if (cached) {
+		type = (enum led_cntrl_type)(cached >> 2);
+		em_enabled = (cached >> 1) & 1;
+	} else {
+		type = _get_type(path, ctx);
 		switch (type) {
 		case LED_CNTRL_TYPE_DELLSSD:
 		case LED_CNTRL_TYPE_SCSI:
@@ -401,39 +446,43 @@ struct cntrl_device *cntrl_device_init(const char *path, struct led_ctx *ctx)
 			em_enabled = 1;
 			break;
 		case LED_CNTRL_TYPE_AHCI:
-			em_enabled = _ahci_em_messages(path);
+			em_enabled = _ahci_em_messages(path) ? 1 : 0;
 			break;
 		case LED_CNTRL_TYPE_AMD:
-			em_enabled = amd_em_enabled(path, ctx);
+			em_enabled = amd_em_enabled(path, ctx) ? 1 : 0;
 			break;
 		default:
-			em_enabled = 0;
+			break;
 		}
-		if (em_enabled) {
-			device = calloc(1, sizeof(struct cntrl_device));
-			if (device) {
-				if (type == LED_CNTRL_TYPE_SCSI) {
-					device->isci_present = _is_isci_cntrl(path);
-					device->hosts = _cntrl_get_hosts(path);
-				} else {
-					device->isci_present = 0;
-					device->hosts = NULL;
-				}
-				if (type == LED_CNTRL_TYPE_VMD) {
-					char *domain = vmdssd_get_domain(path);
-
-					if (domain != NULL)
-						snprintf(device->domain, PATH_MAX,
-							 "%s", domain);
-				}
-				device->cntrl_type = type;
-				strncpy(device->sysfs_path, path, PATH_MAX - 1);
-				device->ctx = ctx;
-			}
-		} else {
+		if (type != LED_CNTRL_TYPE_UNKNOWN && !em_enabled)
 			lib_log(ctx, LED_LOG_LEVEL_ERROR,
 				"controller discovery: %s - enclosure management not supported.",
 				path);
+		hash_map_insert(&ctx->cntrl_probe_cache, path,
+				(void *)(((uintptr_t)type << 2) |
+					 ((uintptr_t)em_enabled << 1) | 1));
+	}
+
+	if (type != LED_CNTRL_TYPE_UNKNOWN && em_enabled) {
+		device = calloc(1, sizeof(struct cntrl_device));
+		if (device) {
+			if (type == LED_CNTRL_TYPE_SCSI) {
+				device->isci_present = _is_isci_cntrl(path);
+				device->hosts = _cntrl_get_hosts(path);
+			} else {
+				device->isci_present = 0;
+				device->hosts = NULL;
+			}
+			if (type == LED_CNTRL_TYPE_VMD) {
+				char *domain = vmdssd_get_domain(path);
+
+				if (domain != NULL)
+					snprintf(device->domain, PATH_MAX,
+						 "%s", domain);
+			}
+			device->cntrl_type = type;
+			strncpy(device->sysfs_path, path, PATH_MAX - 1);
+			device->ctx = ctx;
 		}
 	}
 	return device;
@@ -447,6 +496,7 @@ void cntrl_device_fini(struct cntrl_device *device)
 {
 	if (device) {
 		free_hosts(device->hosts);
+		free(device->ahci_em);
 		free(device);
 	}
 }
@@ -9,6 +9,8 @@
 
 #include <limits.h>
 
+struct ahci_em_queue;
+
 /**
  * @brief Storage controller device structure.
  *
@@ -56,12 +58,39 @@ struct cntrl_device {
 		 * number of total phy ports
 		 */
 		int ports;
+		/**
+		 * cached descriptor of the host bsg node, opened on first
+		 * GPIO write and kept across flushes, -1 when closed. It is
+		 * reopened only when a write through it fails.
+		 */
+		int smp_fd;
+		/**
+		 * path to the host bsg node. The string is interned in the
+		 * context path pool and must not be modified or freed.
+		 */
+		const char *bsg_path;
 		/**
 		 * pointer to next structure
 		 */
 		struct _host_type *next;
 	} *hosts;
 
+	/**
+	 * Token bucket pacing LED writes of this controller, see
+	 * _flush_bucket_take() in libled.c. flush_tokens holds the writes
+	 * still allowed in the current window, flush_refill_ns the time of
+	 * the last refill. Both stay zero while no rate is configured.
+	 */
+	unsigned int flush_tokens;
+	uint64_t flush_refill_ns;
+
+	/**
+	 * Enclosure management messages queued for this AHCI controller,
+	 * transmitted by ahci_flush(). Allocated lazily by the first queued
+	 * message, NULL for other controller types.
+	 */
+	struct ahci_em_queue *ahci_em;
+
 	struct led_ctx *ctx;
 };
 
@@ -81,6 +110,21 @@ struct cntrl_device {
  */
 struct cntrl_device *cntrl_device_init(const char *path, struct led_ctx *ctx);
 
+/**
+ * @brief Checks a controller path against the allow and exclude lists.
+ *
+ * Matching uses the hash sets compiled from the configured pattern lists, so
+ * the cost depends only on the path length, not on the number of patterns.
+ * Intended to be called before cntrl_device_init(), so filtered controllers
+ * are never probed at all.
+ *
+ * @param[in]      ctx            library context.
+ * @param[in]      path           canonical path to storage controller in sysfs tree.
+ *
+ * @return 1 if the controller may be probed, 0 if it is filtered out.
+ */
+int cntrl_path_allowed(struct led_ctx *ctx, const char *path);
+
 /**
  * @brief Releases a controller device structure.
  *
@@ -219,6 +219,184 @@ static status_t ipmi_setled(struct led_ctx *ctx, int b, int d, int f, int state)
 	return STATUS_SUCCESS;
 }
 
+static uint8_t _getdrvmap_subcmd(int gen)
+{
+	switch (gen) {
+	case DELL_12G_MONOLITHIC:
+	case DELL_12G_MODULAR:
+		return DELL_OEM_STORAGE_GETDRVMAP_12G;
+	case DELL_13G_MONOLITHIC:
+	case DELL_13G_MODULAR:
+		return DELL_OEM_STORAGE_GETDRVMAP_13G;
+	default:
+		return DELL_OEM_STORAGE_GETDRVMAP_14G;
+	}
+}
+
+static uint8_t _setdrvstatus_subcmd(int gen)
+{
+	switch (gen) {
+	case DELL_12G_MONOLITHIC:
+	case DELL_12G_MODULAR:
+		return DELL_OEM_STORAGE_SETDRVSTATUS_12G;
+	case DELL_13G_MONOLITHIC:
+	case DELL_13G_MODULAR:
+		return DELL_OEM_STORAGE_SETDRVSTATUS_13G;
+	default:
+		return DELL_OEM_STORAGE_SETDRVSTATUS_14G;
+	}
+}
+
+/**
+ * @brief Queues a drive state change for the controller flush.
+ *
+ * A drive already queued has its state replaced, so only the last change
+ * before the flush is written.
+ *
+ * @return 0 when queued, 1 when the pending table is full and the caller
+ *         must issue the commands directly.
+ */
+static int _queue_setled(struct led_ctx *ctx, unsigned int b, unsigned int d,
+			 unsigned int f, int state)
+{
+	struct dellssd_state *pending = &ctx->dellssd;
+	int i;
+
+	for (i = 0; i < pending->count; i++) {
+		struct dellssd_update *up = &pending->updates[i];
+
+		if (up->bus == b && up->dev == d && up->fun == f) {
+			up->state = state;
+			return 0;
+		}
+	}
+
+	if (pending->count == DELLSSD_MAX_UPDATES)
+		return 1;
+
+	pending->updates[pending->count].bus = b;
+	pending->updates[pending->count].dev = d;
+	pending->updates[pending->count].fun = f;
+	pending->updates[pending->count].state = state;
+	pending->count++;
+
+	return 0;
+}
+
+/**
+ * @brief Writes out all queued backplane LED changes.
+ *
+ * The bay/slot mapping of every queued drive is fetched in one pipelined
+ * IPMI transaction over the persistent BMC descriptor and the drive states
+ * are written back-to-back in a second one, so a burst of changes costs two
+ * round trips to the BMC instead of two serialized commands per drive.
+ * Called once per flush through the first Dell block device, the remaining
+ * ones find the pending table empty.
+ */
+int dellssd_flush(struct block_device *device)
+{
+	struct led_ctx *ctx = device->cntrl->ctx;
+	struct dellssd_state *pending = &ctx->dellssd;
+	struct ipmi_cmd cmds[DELLSSD_MAX_UPDATES];
+	uint8_t data[DELLSSD_MAX_UPDATES][20];
+	uint8_t rdata[DELLSSD_MAX_UPDATES][20];
+	int i, count, gen, sets = 0, rc = 0;
+
+	count = pending->count;
+	pending->count = 0;
+	if (!count)
+		return 0;
+
+	/* Check if this is a supported Dell server */
+	gen = get_dell_server_type(ctx);
+	if (!gen)
+		return 1;
+
+	memset(cmds, 0, sizeof(cmds));
+	memset(data, 0, sizeof(data));
+	memset(rdata, 0, sizeof(rdata));
+
+	/* Get mapping of BDF to bay:slot for all queued drives */
+	for (i = 0; i < count; i++) {
+		struct dellssd_update *up = &pending->updates[i];
+
+		data[i][0] = 0x01;			/* get         */
+		data[i][1] = _getdrvmap_subcmd(gen);
+		data[i][2] = 0x06;			/* length lsb  */
+		data[i][3] = 0x00;			/* length msb  */
+		data[i][4] = 0x00;			/* offset lsb  */
+		data[i][5] = 0x00;			/* offset msb  */
+		data[i][6] = up->bus;			/* bus         */
+		data[i][7] = (((up->dev & 0x1F) << 3) | (up->fun & 0x7));
+		cmds[i].ta = BMC_TA;
+		cmds[i].netfn = DELL_OEM_NETFN;
+		cmds[i].cmd = DELL_OEM_STORAGE_CMD;
+		cmds[i].datalen = 8;
+		cmds[i].data = data[i];
+		cmds[i].resplen = 20;
+		cmds[i].resp = rdata[i];
+	}
+
+	if (ipmicmd_many(ctx, cmds, count)) {
+		lib_log(ctx, LED_LOG_LEVEL_ERROR,
+			"Unable to determine bay/slot mapping for queued drives\n");
+		return 1;
+	}
+
+	/* Set Bay:Slot to Mask for all drives back-to-back */
+	for (i = 0; i < count; i++) {
+		struct dellssd_update *up = &pending->updates[i];
+		uint8_t bay = 0xFF, slot = 0xFF;
+
+		if (!cmds[i].rc && cmds[i].rlen > 8) {
+			bay = rdata[i][7];
+			slot = rdata[i][8];
+		}
+		if (bay == 0xFF || slot == 0xFF) {
+			lib_log(ctx, LED_LOG_LEVEL_ERROR,
+				"Unable to determine bay/slot for device %.2x:%.2x.%x\n",
+				(unsigned int)up->bus, (unsigned int)up->dev,
+				(unsigned int)up->fun);
+			rc = 1;
+			continue;
+		}
+
+		memset(&cmds[sets], 0, sizeof(cmds[sets]));
+		memset(data[sets], 0, sizeof(data[sets]));
+		data[sets][0] = 0x00;			/* set              */
+		data[sets][1] = _setdrvstatus_subcmd(gen);
+		data[sets][2] = 0x0e;			/* length lsb       */
+		data[sets][3] = 0x00;			/* length msb       */
+		data[sets][4] = 0x00;			/* offset lsb       */
+		data[sets][5] = 0x00;			/* offset msb       */
+		data[sets][6] = 0x0e;			/* length lsb       */
+		data[sets][7] = 0x00;			/* length msb       */
+		data[sets][8] = bay;			/* bayid            */
+		data[sets][9] = slot;			/* slotid           */
+		data[sets][10] = up->state & 0xff;	/* state LSB        */
+		data[sets][11] = up->state >> 8;	/* state MSB        */
+		cmds[sets].ta = BMC_TA;
+		cmds[sets].netfn = DELL_OEM_NETFN;
+		cmds[sets].cmd = DELL_OEM_STORAGE_CMD;
+		cmds[sets].datalen = 20;
+		cmds[sets].data = data[sets];
+		cmds[sets].resplen = 20;
+		cmds[sets].resp = rdata[sets];
+		sets++;
+	}
+
+	if (!sets)
+		return rc;
+
+	if (ipmicmd_many(ctx, cmds, sets)) {
+		lib_log(ctx, LED_LOG_LEVEL_ERROR,
+			"Unable to issue SetDriveState for queued drives\n");
+		return 1;
+	}
+
+	return rc;
+}
+
 char *dellssd_get_path(const char *cntrl_path)
 {
 	return strdup(cntrl_path);
@@ -252,5 +430,8 @@ status_t dellssd_write(struct block_device *device, enum led_ibpi_pattern ibpi)
 	if (t == NULL || sscanf(t + 1, "%*x:%x:%x.%x", &bus, &dev, &fun) != 3)
 		return STATUS_DATA_ERROR;
 
-	return ipmi_setled(device->cntrl->ctx, bus, dev, fun, ibpi2val->value);
+	/* Queue the change, dellssd_flush() writes it out with the rest. */
+	if (_queue_setled(device->cntrl->ctx, bus, dev, fun, ibpi2val->value))
+		return ipmi_setled(device->cntrl->ctx, bus, dev, fun, ibpi2val->value);
+	return STATUS_SUCCESS;
 }
@@ -7,5 +7,6 @@
 #include "sysfs.h"
 
 status_t dellssd_write(struct block_device *device, enum led_ibpi_pattern ibpi);
+int dellssd_flush(struct block_device *device);
 char *dellssd_get_path(const char *cntrl_path);
 int get_dell_server_type(struct led_ctx *ctx);
@@ -119,27 +119,40 @@ static struct block_device *enclosure_get_block_device(struct enclosure_device *
 }
 
 /*
- * Re-loads the ses hardware state for this enclosure, to allow refreshing the
- * state after the hardware has be written.
+ * Rebuilds slot information from already loaded pages and propagates slot
+ * state to associated block devices.
  */
-int enclosure_reload(struct enclosure_device * enclosure)
+int enclosure_reload_finish(struct enclosure_device *enclosure)
 {
-	int fd, ret;
+	int ret;
 
-	fd = enclosure_open(enclosure);
-	if (fd == -1) {
-		return 1;
+	/*
+	 * The slot-to-SAS-address mapping is static between topology changes,
+	 * rebuild it only when the cached mapping misses or is stale. Only
+	 * this rebuild needs the large additional element status page, so it
+	 * is fetched here on demand; flush-only reloads re-read just the LED
+	 * statuses from page 2.
+	 */
+	if (!enclosure->slots ||
+	    enclosure->slots_gen != enclosure->ctx->ses_cfg_gen) {
+		int fd = enclosure_open(enclosure);
+
+		if (fd == -1)
+			return 1;
+		ret = ses_load_page10(fd, &enclosure->ses_pages,
+				      enclosure->ctx);
+		if (ret)
+			return ret;
+		ret = ses_get_slots(&enclosure->ses_pages, &enclosure->slots,
+				    &enclosure->slots_count);
+		if (ret)
+			return ret;
+		enclosure->slots_gen = enclosure->ctx->ses_cfg_gen;
+	} else {
+		ses_refresh_slots(&enclosure->ses_pages, enclosure->slots,
+				  enclosure->slots_count);
 	}
 
-	ret = ses_load_pages(fd, &enclosure->ses_pages, enclosure->ctx);
-	close(fd);
-	if (ret != 0)
-		return ret;
-
-	ret = ses_get_slots(&enclosure->ses_pages, &enclosure->slots, &enclosure->slots_count);
-	if (ret)
-		return ret;
-
 	/* If there is an associated block device with a slot, we need to update the block ibpi */
 	for (int i = 0; i < enclosure->slots_count; i++) {
 		struct block_device *bd = enclosure_get_block_device(enclosure, i);
@@ -154,32 +167,62 @@ int enclosure_reload(struct enclosure_device * enclosure)
 }
 
 /*
- * Allocates memory for enclosure device structure and initializes fields of
- * the structure.
+ * Re-loads the ses hardware state for this enclosure, to allow refreshing the
+ * state after the hardware has be written.
  */
-struct enclosure_device *enclosure_device_init(const char *path, struct led_ctx *ctx)
+int enclosure_reload(struct enclosure_device * enclosure)
+{
+	int fd, ret;
+
+	fd = enclosure_open(enclosure);
+	if (fd == -1) {
+		return 1;
+	}
+
+	ret = ses_load_pages(fd, &enclosure->ses_pages, enclosure->ctx);
+	if (ret != 0) {
+		enclosure_close(enclosure);
+		return ret;
+	}
+
+	return enclosure_reload_finish(enclosure);
+}
+
+/*
+ * Allocates an enclosure device structure and resolves its sysfs and sg
+ * paths. No SES traffic is issued; pages must be loaded afterwards, either
+ * with enclosure_reload() or in a batch with ses_load_pages_batch().
+ */
+struct enclosure_device *enclosure_device_open(const char *path, struct led_ctx *ctx)
 {
 	char temp[PATH_MAX] = "\0";
 	struct enclosure_device *enclosure;
-	int ret;
 
 	if (!realpath(path, temp))
 		return NULL;
 
 	enclosure = calloc(1, sizeof(struct enclosure_device));
-	if (enclosure == NULL) {
-		ret = 1;
-		goto out;
-	}
+	if (enclosure == NULL)
+		return NULL;
 
 	memccpy(enclosure->sysfs_path, temp, '\0', PATH_MAX - 1);
 	enclosure->sas_address = _get_sas_address(temp);
 	enclosure->dev_path = _get_dev_sg(temp);
+	enclosure->fd = -1;
 	enclosure->ctx = ctx;
 
-	ret = enclosure_reload(enclosure);
-out:
-	if (ret) {
+	return enclosure;
+}
+
+/*
+ * Allocates memory for enclosure device structure and initializes fields of
+ * the structure.
+ */
+struct enclosure_device *enclosure_device_init(const char *path, struct led_ctx *ctx)
+{
+	struct enclosure_device *enclosure = enclosure_device_open(path, ctx);
+
+	if (enclosure && enclosure_reload(enclosure)) {
 		lib_log(ctx, LED_LOG_LEVEL_WARNING,
 			"failed to initialize enclosure_device %s\n", path);
 		enclosure_device_fini(enclosure);
@@ -195,20 +238,27 @@ out:
 void enclosure_device_fini(struct enclosure_device *enclosure)
 {
 	if (enclosure) {
+		enclosure_close(enclosure);
 		free(enclosure->slots);
 		free(enclosure->dev_path);
 		free(enclosure);
 	}
 }
 
-int enclosure_open(const struct enclosure_device *enclosure)
+int enclosure_open(struct enclosure_device *enclosure)
 {
-	int fd = -1;
+	if (enclosure->fd < 0 && enclosure->dev_path)
+		enclosure->fd = open(enclosure->dev_path, O_RDWR);
 
-	if (enclosure->dev_path)
-		fd = open(enclosure->dev_path, O_RDWR);
+	return enclosure->fd;
+}
 
-	return fd;
+void enclosure_close(struct enclosure_device *enclosure)
+{
+	if (enclosure->fd >= 0) {
+		close(enclosure->fd);
+		enclosure->fd = -1;
+	}
 }
 
 enum led_ibpi_pattern enclosure_get_state(struct slot_property *sp)
@@ -237,7 +287,7 @@ struct slot_property *enclosure_slot_property_init(struct enclosure_device *encl
 	struct slot_property *result = NULL;
 	struct ses_slot *slot_ptr = find_enclosure_slot_by_index(encl, slot_idx);
 
-	result = calloc(1, sizeof(struct slot_property));
+	result = arena_alloc(&encl->ctx->scan_arena, sizeof(struct slot_property));
 	if (result == NULL)
 		return NULL;
 
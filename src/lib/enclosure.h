@@ -37,9 +37,26 @@ struct enclosure_device {
 
 	struct ses_pages ses_pages;
 
+  /**
+   * Slot to SAS address mapping built from the configuration pages. It is
+   * retained across scans and rebuilt only when the pages were re-fetched,
+   * see slots_gen.
+   */
 	struct ses_slot *slots;
 	int slots_count;
 
+  /**
+   * Generation of SES configuration pages the slots array was built from,
+   * compared against ses_cfg_gen of the context.
+   */
+	unsigned int slots_gen;
+
+  /**
+   * Persistent file descriptor to the enclosure's sg device. Opened on
+   * first use by enclosure_open() and kept for the enclosure lifetime.
+   */
+	int fd;
+
 	struct led_ctx *ctx;
 };
 
@@ -61,6 +78,21 @@ struct enclosure_device {
  */
 struct enclosure_device *enclosure_device_init(const char *path, struct led_ctx *ctx);
 
+/**
+ * @brief Allocates an enclosure device structure without touching the device.
+ *
+ * Same as enclosure_device_init(), but no SES command is issued. Pages of the
+ * returned structure must be loaded separately, either with
+ * enclosure_reload() or batched with ses_load_pages_batch() to probe many
+ * enclosures concurrently.
+ *
+ * @param[in]      path           Path to an enclosure device in sysfs tree.
+ * @param[in]      ctx            The library context.
+ *
+ * @return Pointer to enclosure device structure if successful, otherwise NULL.
+ */
+struct enclosure_device *enclosure_device_open(const char *path, struct led_ctx *ctx);
+
 /**
  * @brief Releases an enclosure device structure.
  *
@@ -72,7 +104,17 @@ struct enclosure_device *enclosure_device_init(const char *path, struct led_ctx
  */
 void enclosure_device_fini(struct enclosure_device *enclosure);
 
-int enclosure_open(const struct enclosure_device *enclosure);
+/**
+ * @brief Returns the persistent fd of the enclosure's sg device, opening it
+ *        on first use. Returns -1 when the device cannot be opened.
+ */
+int enclosure_open(struct enclosure_device *enclosure);
+
+/**
+ * @brief Closes the persistent fd of the enclosure's sg device, the next
+ *        enclosure_open() call reopens it. Used to recover from IO errors.
+ */
+void enclosure_close(struct enclosure_device *enclosure);
 
 /**
  * @brief Gets slot information.
@@ -117,4 +159,17 @@ struct slot_property *enclosure_slot_property_init(struct enclosure_device *encl
  */
 int enclosure_reload(struct enclosure_device *enclosure);
 
+/**
+ * @brief Finishes a reload once the pages have been loaded.
+ *
+ * Rebuilds slot information from the pages already present in the structure
+ * and propagates slot state to associated block devices. Used after a batched
+ * page load, enclosure_reload() calls it internally.
+ *
+ * @param[in]        enclosure       Enclosure to finish reloading.
+ *
+ * @return int  0 on success, else error
+ */
+int enclosure_reload_finish(struct enclosure_device *enclosure);
+
 #endif				/* _ENCLOSURE_H_INCLUDED_ */
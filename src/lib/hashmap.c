@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#include <stdint.h>
+#include <string.h>
+
+#if _HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif
+
+#include "hashmap.h"
+
+/**
+ * Initial number of buckets allocated on first insert. The map doubles the
+ * bucket count whenever the load factor exceeds one.
+ */
+#define HASH_MAP_MIN_BUCKETS	64
+
+/**
+ * @brief Computes FNV-1a hash of a string key.
+ *
+ * This is internal function of hashmap module.
+ */
+static uint64_t _hash_key(const char *key)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	while (*key) {
+		h ^= (unsigned char)*key++;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/**
+ * @brief Grows bucket storage and rehashes all entries.
+ *
+ * This is internal function of hashmap module. On memory allocation failure
+ * the map is left untouched, chains just get longer.
+ */
+static void _rehash(struct hash_map *map, size_t bucket_count)
+{
+	struct hash_map_entry **buckets;
+	size_t i;
+
+	buckets = calloc(bucket_count, sizeof(*buckets));
+	if (!buckets)
+		return;
+
+	for (i = 0; i < map->bucket_count; i++) {
+		struct hash_map_entry *entry = map->buckets[i];
+
+		while (entry) {
+			struct hash_map_entry *next = entry->next;
+			size_t b = _hash_key(entry->key) % bucket_count;
+
+			entry->next = buckets[b];
+			buckets[b] = entry;
+			entry = next;
+		}
+	}
+	free(map->buckets);
+	map->buckets = buckets;
+	map->bucket_count = bucket_count;
+}
+
+void hash_map_clear(struct hash_map *map)
+{
+	size_t i;
+
+	for (i = 0; i < map->bucket_count; i++) {
+		struct hash_map_entry *entry = map->buckets[i];
+
+		while (entry) {
+			struct hash_map_entry *next = entry->next;
+
+			free(entry);
+			entry = next;
+		}
+		map->buckets[i] = NULL;
+	}
+	map->entry_count = 0;
+}
+
+void hash_map_fini(struct hash_map *map)
+{
+	hash_map_clear(map);
+	free(map->buckets);
+	map->buckets = NULL;
+	map->bucket_count = 0;
+}
+
+/**
+ * @brief Finds an entry and its bucket for the given key.
+ *
+ * This is internal function of hashmap module.
+ */
+static struct hash_map_entry **_find_slot(const struct hash_map *map, const char *key)
+{
+	struct hash_map_entry **slot;
+
+	if (!map->bucket_count)
+		return NULL;
+
+	slot = &map->buckets[_hash_key(key) % map->bucket_count];
+	while (*slot) {
+		if (strcmp((*slot)->key, key) == 0)
+			break;
+		slot = &(*slot)->next;
+	}
+	return slot;
+}
+
+bool hash_map_insert(struct hash_map *map, const char *key, void *item)
+{
+	struct hash_map_entry **slot, *entry;
+	size_t key_len;
+
+	if (!map->buckets) {
+		_rehash(map, HASH_MAP_MIN_BUCKETS);
+		if (!map->buckets)
+			return false;
+	}
+
+	slot = _find_slot(map, key);
+	if (*slot) {
+		(*slot)->item = item;
+		return true;
+	}
+
+	key_len = strlen(key);
+	entry = malloc(sizeof(*entry) + key_len + 1);
+	if (!entry)
+		return false;
+
+	entry->next = NULL;
+	entry->item = item;
+	memcpy(entry->key, key, key_len + 1);
+	*slot = entry;
+	map->entry_count++;
+
+	if (map->entry_count > map->bucket_count)
+		_rehash(map, map->bucket_count * 2);
+	return true;
+}
+
+void *hash_map_find(const struct hash_map *map, const char *key)
+{
+	struct hash_map_entry **slot = _find_slot(map, key);
+
+	return (slot && *slot) ? (*slot)->item : NULL;
+}
+
+void *hash_map_remove(struct hash_map *map, const char *key)
+{
+	struct hash_map_entry **slot = _find_slot(map, key);
+	struct hash_map_entry *entry;
+	void *item;
+
+	if (!slot || !*slot)
+		return NULL;
+
+	entry = *slot;
+	item = entry->item;
+	*slot = entry->next;
+	free(entry);
+	map->entry_count--;
+	return item;
+}
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _HASHMAP_H_INCLUDED_
+#define _HASHMAP_H_INCLUDED_
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * Single hash map entry. Entries with colliding hashes are chained. The key
+ * is stored inline, the item is owned by the caller.
+ */
+struct hash_map_entry {
+	struct hash_map_entry *next;
+	void *item;
+	char key[];
+};
+
+/**
+ * String-keyed hash map. It complements struct list where O(1) lookup by
+ * sysfs path or device node is required. The map never owns the items, it
+ * only indexes objects kept on a list, so clearing the map does not free
+ * the indexed objects.
+ */
+struct hash_map {
+	struct hash_map_entry **buckets;
+	size_t bucket_count;
+	size_t entry_count;
+};
+
+/**
+ * @brief Initializes a hash map object.
+ *
+ * Initializes a hash map object to reflect an empty state. Bucket storage is
+ * allocated lazily on first insert.
+ *
+ * @param[in]      map            pointer to a hash map object.
+ */
+static inline void hash_map_init(struct hash_map *map)
+{
+	map->buckets = NULL;
+	map->bucket_count = 0;
+	map->entry_count = 0;
+}
+
+/**
+ * @brief Removes all entries from a hash map.
+ *
+ * This function frees all entries kept in the map. It does not free indexed
+ * items nor the bucket storage, so the map can be repopulated cheaply.
+ *
+ * @param[in]      map            pointer to a hash map object.
+ */
+void hash_map_clear(struct hash_map *map);
+
+/**
+ * @brief Releases memory allocated for a hash map.
+ *
+ * This function frees all entries and the bucket storage. It does not free
+ * the indexed items. The map is left in initialized, empty state.
+ *
+ * @param[in]      map            pointer to a hash map object.
+ */
+void hash_map_fini(struct hash_map *map);
+
+/**
+ * @brief Inserts an item into the hash map.
+ *
+ * If the key is already present, the stored item is replaced.
+ *
+ * @param[in]      map            pointer to a hash map object.
+ * @param[in]      key            null-terminated key, copied into the entry.
+ * @param[in]      item           item to index, must outlive the entry.
+ *
+ * @return true on success, else false on memory allocation failure.
+ */
+bool hash_map_insert(struct hash_map *map, const char *key, void *item);
+
+/**
+ * @brief Looks an item up by key.
+ *
+ * @param[in]      map            pointer to a hash map object.
+ * @param[in]      key            null-terminated key.
+ *
+ * @return Indexed item if the key is present, otherwise NULL.
+ */
+void *hash_map_find(const struct hash_map *map, const char *key);
+
+/**
+ * @brief Removes an entry by key.
+ *
+ * @param[in]      map            pointer to a hash map object.
+ * @param[in]      key            null-terminated key.
+ *
+ * @return Item stored under the key if present, otherwise NULL.
+ */
+void *hash_map_remove(struct hash_map *map, const char *key);
+
+#endif				/* _HASHMAP_H_INCLUDED_ */
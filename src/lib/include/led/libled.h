@@ -12,6 +12,8 @@ extern "C" {
 
 #include <linux/limits.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #define LED_SYM_PUBLIC __attribute__((visibility("default")))
 
@@ -57,7 +59,8 @@ typedef enum  {
 	LED_STATUS_CMDLINE_ERROR = 35,
 	LED_STATUS_NOT_A_PRIVILEGED_USER = 36,
 	LED_STATUS_LOG_FILE_ERROR = 40,
-	LED_STATUS_UNDEFINED = 41
+	LED_STATUS_UNDEFINED = 41,
+	LED_STATUS_BUSY = 42
 } led_status_t;
 
 /**
@@ -243,6 +246,21 @@ enum led_ibpi_pattern {
  */
 led_status_t LED_SYM_PUBLIC led_new(struct led_ctx **ctx);
 
+/**
+ * @brief Attaches a read-only library context to the state published by a
+ * running ledmon.
+ *
+ * The slot model - slot id, device node, IBPI state, controller type - is
+ * read from a shared-memory segment the monitor refreshes every cycle, so
+ * slot enumeration and state queries cost no hardware scan. led_scan() on
+ * such a context re-reads the published state; setting LED states is
+ * refused. Fails when no monitor is publishing.
+ *
+ * @param[in]	ctx	Library context to initialize
+ * @return led_status_t LED_STATUS_SUCCESS on success, else error reason.
+ */
+led_status_t LED_SYM_PUBLIC led_ctx_open_readonly(struct led_ctx **ctx);
+
 /**
  * @brief Free the library context
  *
@@ -281,6 +299,32 @@ void LED_SYM_PUBLIC led_log_level_set(struct led_ctx *ctx, enum led_log_level_en
  */
 led_status_t LED_SYM_PUBLIC led_scan(struct led_ctx *ctx);
 
+/**
+ * Bit of a controller type in the mask accepted by led_scan_filtered().
+ */
+#define LED_SCAN_MASK(cntrl_type)	(1u << (cntrl_type))
+
+/**
+ * Mask covering every controller family, led_scan(ctx) is equivalent to
+ * led_scan_filtered(ctx, LED_SCAN_MASK_ALL).
+ */
+#define LED_SCAN_MASK_ALL		0xffffffffu
+
+/**
+ * @brief Scoped variant of led_scan() restricted to selected controller
+ * families.
+ *
+ * Only controllers whose type bit is set in the mask are discovered, probing
+ * of the skipped families - e.g. the enclosure walk and SES traffic when
+ * LED_CNTRL_TYPE_SCSI is filtered out - is avoided entirely. Changing the
+ * mask between calls forces a full rebuild of the device model.
+ *
+ * @param[in]	ctx			Library context
+ * @param[in]	cntrl_type_mask		Bitwise or of LED_SCAN_MASK() values
+ * @return led_status_t LED_STATUS_SUCCESS on success, else error reason.
+ */
+led_status_t LED_SYM_PUBLIC led_scan_filtered(struct led_ctx *ctx, uint32_t cntrl_type_mask);
+
 /**
  * @brief Used to lookup a block device node to name used by library.  This function should be
  * called with its output being used as input for functions: led_is_management_supported, led_set.
@@ -322,11 +366,72 @@ led_status_t LED_SYM_PUBLIC led_set(struct led_ctx *ctx, const char *path,
 /**
  * @brief Flush the changes to hardware, this function is required after calling 1 or more calls
  * to led_set for the changes to take effect.  This function is not needed when using the slot API.
+ * Controllers are flushed concurrently, the call returns when all of them are done.
  *
  * @param[in]	ctx	Library context
  */
 void LED_SYM_PUBLIC led_flush(struct led_ctx *ctx);
 
+/**
+ * @brief Flush the changes to hardware without blocking the caller.
+ *
+ * Asynchronous variant of led_flush(). The controllers are flushed by a
+ * background thread, the call returns as soon as the thread is started.
+ * Collect the completion with led_wait(). led_set() itself only queues
+ * messages, so the led_set()/led_flush_async() pair forms an asynchronous
+ * submission path. Functions which rebuild the device model, led_scan() in
+ * particular, wait for the in-flight flush on entry.
+ *
+ * @param[in]	ctx	Library context
+ * @return led_status_t LED_STATUS_SUCCESS on success, else error reason.
+ */
+led_status_t LED_SYM_PUBLIC led_flush_async(struct led_ctx *ctx);
+
+/**
+ * @brief Wait for the completion of an asynchronous flush.
+ *
+ * @param[in]	ctx		Library context
+ * @param[in]	timeout_ms	Upper bound on the wait in milliseconds, a
+ *				negative value waits until the flush is done.
+ *
+ * @return led_status_t LED_STATUS_SUCCESS when no flush is in flight anymore,
+ *         LED_STATUS_BUSY when the timeout expired first.
+ */
+led_status_t LED_SYM_PUBLIC led_wait(struct led_ctx *ctx, int timeout_ms);
+
+/**
+ * @brief Single device request of led_set_many()
+ */
+struct led_request {
+	/** Device path, this is the result of led_device_name_lookup */
+	const char *device_path;
+	/** Requested ibpi value */
+	enum led_ibpi_pattern ibpi;
+	/** Per-request result, filled in by led_set_many() */
+	led_status_t status;
+};
+
+/**
+ * @brief Set the ibpi pattern for many devices and flush once
+ *
+ * All requests are validated before any LED is touched; if a device in the
+ * batch is not supported the function fails without changing hardware state.
+ * Otherwise every pattern is applied and the accumulated messages are flushed
+ * with a single led_flush(), so changes sharing a controller or enclosure are
+ * coalesced into one transmission instead of one per device. The status field
+ * of each request is filled individually.
+ *
+ * @param[in]	ctx	Library context
+ * @param[in]	reqs	Array of requests
+ * @param[in]	count	Number of elements in the array
+ * @return led_status_t LED_STATUS_SUCCESS if all requests succeeded, else the
+ *		status of the first failed request.
+ *
+ * Note: No additional led_flush() call is needed
+ */
+led_status_t LED_SYM_PUBLIC led_set_many(struct led_ctx *ctx, struct led_request *reqs,
+					 size_t count);
+
 /**
  * @brief Checks to see if the specified controller type supports slots
  *
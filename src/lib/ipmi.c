@@ -6,6 +6,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,9 @@
 #include "utils.h"
 #include "ipmi.h"
 
+/* Upper bound on waiting for one response of a transaction, in seconds. */
+#define IPMI_RESPONSE_TIMEOUT	5
+
 static int ipmi_open(void)
 {
 	int fd;
@@ -43,78 +47,161 @@ static int ipmi_open(void)
 	return -1;
 }
 
-int ipmicmd(struct led_ctx *ctx, int ta, int lun, int netfn, int cmd, int datalen, void *data,
-	    int resplen, int *rlen, void *resp)
+/**
+ * @brief Returns the persistent BMC fd of the context, opening it on first
+ *        use. Must be called with the ipmi lock held.
+ */
+static int _ipmi_fd_get(struct led_ctx *ctx)
 {
-	struct ipmi_system_interface_addr saddr = {0};
-	struct ipmi_ipmb_addr iaddr = {0};
-	struct ipmi_addr raddr = {0};
-	struct ipmi_req req = {0};
-	struct ipmi_recv rcv = {0};
-	fd_set rfd;
-	int fd, rc;
-	uint8_t tresp[resplen + 1];
-
-	fd = ipmi_open();
-	if (fd < 0)
-		return -1;
+	if (ctx->ipmi_fd < 0)
+		ctx->ipmi_fd = ipmi_open();
+	return ctx->ipmi_fd;
+}
 
-	memset(tresp, 0, sizeof(tresp));
-
-	if (ta == BMC_TA) {
-		saddr.addr_type = IPMI_SYSTEM_INTERFACE_ADDR_TYPE;
-		saddr.channel = IPMI_BMC_CHANNEL;
-		saddr.lun = 0;
-		req.addr = (void *)&saddr;
-		req.addr_len = sizeof(saddr);
-	} else {
-		iaddr.addr_type = IPMI_IPMB_ADDR_TYPE;
-		iaddr.channel = 0;
-		iaddr.slave_addr = ta;
-		iaddr.lun = lun;
-		req.addr = (void *)&iaddr;
-		req.addr_len = sizeof(iaddr);
+/**
+ * @brief Drops the persistent BMC fd, the next command reopens it. Closing
+ *        also discards responses still queued in the kernel, which resyncs
+ *        the message stream after a lost reply.
+ */
+static void _ipmi_fd_drop(struct led_ctx *ctx)
+{
+	if (ctx->ipmi_fd >= 0) {
+		close(ctx->ipmi_fd);
+		ctx->ipmi_fd = -1;
 	}
+}
 
-	/* Issue command */
-	req.msgid = ++ctx->ipmi_msgid;
-	req.msg.netfn = netfn;
-	req.msg.cmd = cmd;
-	req.msg.data_len = datalen;
-	req.msg.data = data;
-	rc = ioctl(fd, IPMICTL_SEND_COMMAND, (void *)&req);
-	if (rc != 0) {
-		perror("send");
-		goto end;
+void ipmi_fini(struct led_ctx *ctx)
+{
+	_ipmi_fd_drop(ctx);
+}
+
+/*
+ * Issues a batch of commands as one pipelined transaction. See ipmi.h for
+ * details.
+ */
+int ipmicmd_many(struct led_ctx *ctx, struct ipmi_cmd *cmds, size_t count)
+{
+	size_t i, pending = 0;
+	int ret = 0;
+
+	pthread_mutex_lock(&ctx->ipmi_lock);
+	if (_ipmi_fd_get(ctx) < 0) {
+		pthread_mutex_unlock(&ctx->ipmi_lock);
+		for (i = 0; i < count; i++)
+			cmds[i].rc = -1;
+		return -1;
 	}
 
-	/* Wait for Response */
-	FD_ZERO(&rfd);
-	FD_SET(fd, &rfd);
-	rc = select(fd + 1, &rfd, NULL, NULL, NULL);
-	if (rc < 0) {
-		perror("select");
-		goto end;
+	/* Send every request before waiting for the first response. */
+	for (i = 0; i < count; i++) {
+		struct ipmi_system_interface_addr saddr = {0};
+		struct ipmi_ipmb_addr iaddr = {0};
+		struct ipmi_req req = {0};
+		struct ipmi_cmd *c = &cmds[i];
+
+		if (c->ta == BMC_TA) {
+			saddr.addr_type = IPMI_SYSTEM_INTERFACE_ADDR_TYPE;
+			saddr.channel = IPMI_BMC_CHANNEL;
+			saddr.lun = 0;
+			req.addr = (void *)&saddr;
+			req.addr_len = sizeof(saddr);
+		} else {
+			iaddr.addr_type = IPMI_IPMB_ADDR_TYPE;
+			iaddr.channel = 0;
+			iaddr.slave_addr = c->ta;
+			iaddr.lun = c->lun;
+			req.addr = (void *)&iaddr;
+			req.addr_len = sizeof(iaddr);
+		}
+		c->msgid = ++ctx->ipmi_msgid;
+		c->rc = -1;
+		c->rlen = 0;
+		req.msgid = c->msgid;
+		req.msg.netfn = c->netfn;
+		req.msg.cmd = c->cmd;
+		req.msg.data_len = c->datalen;
+		req.msg.data = c->data;
+		if (ioctl(ctx->ipmi_fd, IPMICTL_SEND_COMMAND, (void *)&req) != 0)
+			perror("send");
+		else
+			pending++;
 	}
 
-	/* Get response */
-	rcv.msg.data = tresp;
-	rcv.msg.data_len = resplen + 1;
-	rcv.addr = (void *)&raddr;
-	rcv.addr_len = sizeof(raddr);
-	rc = ioctl(fd, IPMICTL_RECEIVE_MSG_TRUNC, (void *)&rcv);
-	if (rc != 0 && errno == EMSGSIZE)
-		lib_log(ctx, LED_LOG_LEVEL_INFO, "too short..\n");
-	if (rc != 0 && errno != EMSGSIZE) {
-		lib_log(ctx, LED_LOG_LEVEL_INFO, "%s\n", strerror(errno));
-		goto end;
+	/* Collect the responses, they may arrive in any order. */
+	while (pending) {
+		struct ipmi_addr raddr = {0};
+		struct ipmi_recv rcv = {0};
+		struct timeval tv = { .tv_sec = IPMI_RESPONSE_TIMEOUT };
+		uint8_t rbuf[IPMI_MAX_MSG_LENGTH];
+		fd_set rfd;
+		int rc;
+
+		FD_ZERO(&rfd);
+		FD_SET(ctx->ipmi_fd, &rfd);
+		rc = select(ctx->ipmi_fd + 1, &rfd, NULL, NULL, &tv);
+		if (rc <= 0) {
+			if (rc < 0)
+				perror("select");
+			/* Lost response, drop the fd to resync the stream. */
+			_ipmi_fd_drop(ctx);
+			break;
+		}
+
+		rcv.msg.data = rbuf;
+		rcv.msg.data_len = sizeof(rbuf);
+		rcv.addr = (void *)&raddr;
+		rcv.addr_len = sizeof(raddr);
+		rc = ioctl(ctx->ipmi_fd, IPMICTL_RECEIVE_MSG_TRUNC, (void *)&rcv);
+		if (rc != 0) {
+			lib_log(ctx, LED_LOG_LEVEL_INFO, "%s\n", strerror(errno));
+			_ipmi_fd_drop(ctx);
+			break;
+		}
+
+		for (i = 0; i < count; i++)
+			if (cmds[i].rc && cmds[i].msgid == rcv.msgid)
+				break;
+		if (i == count)
+			/* Stale response of an earlier, timed out command. */
+			continue;
+		pending--;
+
+		if (rcv.msg.data_len < 1)
+			continue;
+		if (rbuf[0])
+			lib_log(ctx, LED_LOG_LEVEL_DEBUG, "IPMI Error: %.2x\n", rbuf[0]);
+		cmds[i].rlen = rcv.msg.data_len - 1;
+		if (cmds[i].rlen > cmds[i].resplen) {
+			lib_log(ctx, LED_LOG_LEVEL_INFO, "too short..\n");
+			cmds[i].rlen = cmds[i].resplen;
+		}
+		memcpy(cmds[i].resp, rbuf + 1, cmds[i].rlen);
+		cmds[i].rc = 0;
 	}
-	if (rcv.msg.data[0])
-		lib_log(ctx, LED_LOG_LEVEL_DEBUG, "IPMI Error: %.2x\n", rcv.msg.data[0]);
-	rc = 0;
-	*rlen = rcv.msg.data_len - 1;
-	memcpy(resp, rcv.msg.data + 1, *rlen);
-end:
-	close(fd);
+	pthread_mutex_unlock(&ctx->ipmi_lock);
+
+	for (i = 0; i < count; i++)
+		if (cmds[i].rc)
+			ret = -1;
+	return ret;
+}
+
+int ipmicmd(struct led_ctx *ctx, int ta, int lun, int netfn, int cmd, int datalen, void *data,
+	    int resplen, int *rlen, void *resp)
+{
+	struct ipmi_cmd c = {
+		.ta = ta,
+		.lun = lun,
+		.netfn = netfn,
+		.cmd = cmd,
+		.datalen = datalen,
+		.data = data,
+		.resplen = resplen,
+		.resp = resp,
+	};
+	int rc = ipmicmd_many(ctx, &c, 1);
+
+	*rlen = c.rlen;
 	return rc;
 }
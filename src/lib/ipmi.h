@@ -2,9 +2,67 @@
 
 /* Generic IPMI Interface */
 
+#ifndef _IPMI_H_INCLUDED_
+#define _IPMI_H_INCLUDED_
+
+#include <stddef.h>
+
 #include "led/libled.h"
 
 #define BMC_TA 0x20
 
+/**
+ * One command of a pipelined IPMI transaction, see ipmicmd_many(). The caller
+ * fills the request fields, the response fields are filled when the matching
+ * reply arrives.
+ */
+struct ipmi_cmd {
+	/* request */
+	int ta;
+	int lun;
+	int netfn;
+	int cmd;
+	int datalen;
+	void *data;
+	int resplen;
+	void *resp;
+	/* response */
+	int rlen;
+	int rc;
+	/* internal, used to match the reply */
+	long msgid;
+};
+
+/**
+ * @brief Issues a single IPMI command and waits for its response.
+ *
+ * The command goes through the persistent BMC file descriptor of the library
+ * context, which is opened on first use.
+ *
+ * @return 0 if successful, otherwise -1.
+ */
 int ipmicmd(struct led_ctx *ctx, int sa, int lun, int netfn, int cmd, int datalen, void *data,
 	    int resplen, int *rlen, void *resp);
+
+/**
+ * @brief Issues a batch of IPMI commands as one pipelined transaction.
+ *
+ * All requests are sent before the first response is awaited, so a batch of
+ * independent commands costs roughly one round trip to the BMC instead of one
+ * per command. Responses are matched to commands by message id; the rc and
+ * rlen fields of each command are filled individually.
+ *
+ * @param[in]	ctx	Library context.
+ * @param[in]	cmds	Array of commands to issue.
+ * @param[in]	count	Number of elements in the array.
+ *
+ * @return 0 if every command succeeded, otherwise -1.
+ */
+int ipmicmd_many(struct led_ctx *ctx, struct ipmi_cmd *cmds, size_t count);
+
+/**
+ * @brief Closes the persistent BMC file descriptor of the library context.
+ */
+void ipmi_fini(struct led_ctx *ctx);
+
+#endif				/* _IPMI_H_INCLUDED_ */
@@ -7,14 +7,18 @@
 
 #include <errno.h>
 #include <linux/limits.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdarg.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "enclosure.h"
+#include "ipmi.h"
 #include "libled_private.h"
+#include "state_shm.h"
 #include "list.h"
 #include "npem.h"
 #include "sysfs.h"
@@ -31,11 +35,28 @@ led_status_t led_new(struct led_ctx **ctx)
 	if (!t_ctx)
 		return LED_STATUS_OUT_OF_MEMORY;
 
+	arena_init(&t_ctx->scan_arena);
+	arena_init(&t_ctx->raid_arena);
+	str_pool_init(&t_ctx->path_pool);
+	hash_map_init(&t_ctx->ibpi_cache);
+	hash_map_init(&t_ctx->name_cache);
+	hash_map_init(&t_ctx->cntrl_probe_cache);
+	npem_cache_init(t_ctx);
 	sysfs_init(t_ctx);
 
 	list_init(&t_ctx->config.allowlist, free);
 	list_init(&t_ctx->config.excludelist, free);
-
+	hash_map_init(&t_ctx->config.allow_map);
+	hash_map_init(&t_ctx->config.exclude_map);
+
+	t_ctx->ses_cfg_gen = 1;
+	t_ctx->scan_mask = LED_SCAN_MASK_ALL;
+	t_ctx->shm.fd = -1;
+	t_ctx->ipmi_fd = -1;
+	pthread_mutex_init(&t_ctx->ipmi_lock, NULL);
+	pthread_mutex_init(&t_ctx->ibpi_cache_lock, NULL);
+	pthread_mutex_init(&t_ctx->flush_async.lock, NULL);
+	pthread_cond_init(&t_ctx->flush_async.done_cond, NULL);
 	t_ctx->log_fd = -1;
 	t_ctx->log_lvl = LED_LOG_LEVEL_ERROR;
 
@@ -43,15 +64,66 @@ led_status_t led_new(struct led_ctx **ctx)
 	return LED_STATUS_SUCCESS;
 }
 
+led_status_t led_ctx_open_readonly(struct led_ctx **ctx)
+{
+	struct led_ctx *t_ctx;
+	led_status_t status;
+
+	status = led_new(&t_ctx);
+	if (status != LED_STATUS_SUCCESS)
+		return status;
+
+	t_ctx->readonly = 1;
+	status = state_shm_load(t_ctx);
+	if (status != LED_STATUS_SUCCESS) {
+		led_free(t_ctx);
+		return status;
+	}
+
+	*ctx = t_ctx;
+	return LED_STATUS_SUCCESS;
+}
+
 led_status_t led_free(struct led_ctx *ctx)
 {
 	if (!ctx)
 		return LED_STATUS_NULL_POINTER;
 
+	led_wait(ctx, -1);
 	amd_sgpio_cache_free(ctx);
 
 	sysfs_reset(ctx);
-
+	vector_fini(&ctx->sys.sysfs_block_list);
+	vector_fini(&ctx->sys.cntrl_list);
+	vector_fini(&ctx->sys.slots_list);
+	npem_cache_fini(ctx);
+	hash_map_fini(&ctx->sys.devnode_map);
+	hash_map_fini(&ctx->sys.block_path_map);
+	hash_map_fini(&ctx->sys.pci_slot_map);
+	hash_map_fini(&ctx->sys.sas_addr_map);
+	hash_map_fini(&ctx->sys.slot_id_map);
+	hash_map_fini(&ctx->sys.slot_devnode_map);
+	hash_map_fini(&ctx->sys.tail_block_map);
+	hash_map_fini(&ctx->sys.raid_watch_map);
+	if (ctx->sys.raid_wd_epoll >= 0)
+		close(ctx->sys.raid_wd_epoll);
+	if (ctx->sys.pci_ino_fd >= 0)
+		close(ctx->sys.pci_ino_fd);
+	hash_map_fini(&ctx->ibpi_cache);
+	hash_map_fini(&ctx->name_cache);
+	hash_map_fini(&ctx->cntrl_probe_cache);
+	arena_fini(&ctx->scan_arena);
+	arena_fini(&ctx->raid_arena);
+	str_pool_fini(&ctx->path_pool);
+	ipmi_fini(ctx);
+	state_shm_fini(ctx);
+	pthread_mutex_destroy(&ctx->ipmi_lock);
+	pthread_mutex_destroy(&ctx->ibpi_cache_lock);
+	pthread_mutex_destroy(&ctx->flush_async.lock);
+	pthread_cond_destroy(&ctx->flush_async.done_cond);
+
+	hash_map_fini(&ctx->config.allow_map);
+	hash_map_fini(&ctx->config.exclude_map);
 	list_erase(&ctx->config.allowlist);
 	list_erase(&ctx->config.excludelist);
 
@@ -70,35 +142,91 @@ void led_log_level_set(struct led_ctx *ctx, enum led_log_level_enum level)
 }
 
 led_status_t led_scan(struct led_ctx *ctx)
+{
+	return led_scan_filtered(ctx, LED_SCAN_MASK_ALL);
+}
+
+led_status_t led_scan_filtered(struct led_ctx *ctx, uint32_t cntrl_type_mask)
 {
 	if (!ctx)
 		return LED_STATUS_NULL_POINTER;
 
 	ctx->deferred_error = LED_STATUS_SUCCESS;
 
-	sysfs_reset(ctx);
-	sysfs_scan(ctx);
+	/* The scan may tear the device model down under in-flight writes. */
+	led_wait(ctx, -1);
+
+	if (ctx->readonly)
+		return state_shm_load(ctx);
+
+	if (ctx->scan_mask != cntrl_type_mask) {
+		/* The retained model was built under a different filter. */
+		sysfs_reset(ctx);
+		ctx->scan_mask = cntrl_type_mask;
+	}
+
+	sysfs_rescan(ctx);
 
 	return ctx->deferred_error;
 }
 
+/* Upper bound on cached name lookups, see the name_cache context member. */
+#define NAME_CACHE_MAX	256
+
+/**
+ * @brief Remembers a resolved device name in the lookup cache.
+ *
+ * The canonical path is interned in the path pool of the context, so cache
+ * entries carry no memory of their own. The cache is emptied wholesale when
+ * it hits its cap, repeated lookups of a working set below the cap never
+ * miss.
+ */
+static void _name_cache_note(struct led_ctx *ctx, const char *name,
+			     const char *canonical)
+{
+	char *interned;
+
+	if (ctx->name_cache.entry_count >= NAME_CACHE_MAX)
+		hash_map_clear(&ctx->name_cache);
+	interned = str_pool_intern(&ctx->path_pool, canonical);
+	if (interned)
+		hash_map_insert(&ctx->name_cache, name, interned);
+}
+
 led_status_t led_device_name_lookup(struct led_ctx *ctx, const char *name, char *result)
 {
 	struct block_device *device;
 	char temp[PATH_MAX];
+	const char *cached;
+
+	cached = hash_map_find(&ctx->name_cache, name);
+	if (cached) {
+		str_cpy(result, cached, PATH_MAX);
+		return LED_STATUS_SUCCESS;
+	}
 
 	if (!realpath(name, temp))
 		return LED_STATUS_INVALID_PATH;
 
-	if (is_subpath(temp, SYSTEM_DEV_DIR, strlen(SYSTEM_DEV_DIR)))
-		list_for_each(sysfs_get_block_devices(ctx), device)
+	if (is_subpath(temp, SYSTEM_DEV_DIR, strlen(SYSTEM_DEV_DIR))) {
+		device = hash_map_find(&ctx->sys.devnode_map, temp);
+		if (device) {
+			str_cpy(result, device->sysfs_path, PATH_MAX);
+			_name_cache_note(ctx, name, result);
+			return LED_STATUS_SUCCESS;
+		}
+		/* Paranoia, the index should cover all known device nodes. */
+		vector_for_each(sysfs_get_block_devices(ctx), device)
 			if (device->devnode[0] && strncmp(device->devnode, temp, PATH_MAX) == 0) {
 				str_cpy(result, device->sysfs_path, PATH_MAX);
+				_name_cache_note(ctx, name, result);
 				return LED_STATUS_SUCCESS;
 			}
+	}
 
 	/* Backward compatibility, trust that it is valid sysfs path */
 	str_cpy(result, temp, PATH_MAX);
+	_name_cache_note(ctx, name, result);
 	return LED_STATUS_SUCCESS;
 }
 
@@ -106,33 +234,448 @@ enum led_cntrl_type led_is_management_supported(struct led_ctx *ctx, const char
 {
 	struct block_device *block;
 
-	list_for_each(&ctx->sys.sysfs_block_list, block) {
+	vector_for_each(&ctx->sys.sysfs_block_list, block) {
 		if (strcmp(block->sysfs_path, path) == 0)
 			return block->cntrl->cntrl_type;
 	}
 	return LED_CNTRL_TYPE_UNKNOWN;
 }
 
-led_status_t led_set(struct led_ctx *ctx, const char *path, enum led_ibpi_pattern ibpi)
+/**
+ * @brief Checks whether the pattern is already committed for the given key.
+ *
+ * The key is a device sysfs path or a slot id, see the ibpi_cache member of
+ * the library context.
+ */
+static bool _ibpi_cache_hit(struct led_ctx *ctx, const char *key,
+			    enum led_ibpi_pattern ibpi)
+{
+	bool hit;
+
+	if (ctx->ibpi_cache_force)
+		return false;
+	pthread_mutex_lock(&ctx->ibpi_cache_lock);
+	hit = hash_map_find(&ctx->ibpi_cache, key) ==
+	      (void *)(uintptr_t)(ibpi + 1);
+	pthread_mutex_unlock(&ctx->ibpi_cache_lock);
+	return hit;
+}
+
+static void _ibpi_cache_note(struct led_ctx *ctx, const char *key,
+			     enum led_ibpi_pattern ibpi)
+{
+	pthread_mutex_lock(&ctx->ibpi_cache_lock);
+	hash_map_insert(&ctx->ibpi_cache, key, (void *)(uintptr_t)(ibpi + 1));
+	pthread_mutex_unlock(&ctx->ibpi_cache_lock);
+}
+
+static struct block_device *_block_find(struct led_ctx *ctx, const char *path)
 {
 	struct block_device *device;
 
-	list_for_each(sysfs_get_block_devices(ctx), device) {
-		if (strcmp(device->sysfs_path, path) == 0) {
-			device->send_message_fn(device, ibpi);
-			return LED_STATUS_SUCCESS;
+	vector_for_each(sysfs_get_block_devices(ctx), device) {
+		if (strcmp(device->sysfs_path, path) == 0)
+			return device;
+	}
+	return NULL;
+}
+
+led_status_t led_set(struct led_ctx *ctx, const char *path, enum led_ibpi_pattern ibpi)
+{
+	struct block_device *device = _block_find(ctx, path);
+
+	if (!device)
+		return LED_STATUS_NOT_SUPPORTED;
+
+	if (_ibpi_cache_hit(ctx, device->sysfs_path, ibpi))
+		return LED_STATUS_SUCCESS;
+
+	if (device->send_message_fn(device, ibpi) == STATUS_SUCCESS)
+		_ibpi_cache_note(ctx, device->sysfs_path, ibpi);
+	return LED_STATUS_SUCCESS;
+}
+
+led_status_t led_set_many(struct led_ctx *ctx, struct led_request *reqs, size_t count)
+{
+	struct block_device **devices;
+	led_status_t status = LED_STATUS_SUCCESS;
+	size_t i;
+
+	if (!ctx || (!reqs && count > 0))
+		return LED_STATUS_NULL_POINTER;
+	if (count == 0)
+		return LED_STATUS_SUCCESS;
+
+	devices = calloc(count, sizeof(*devices));
+	if (!devices)
+		return LED_STATUS_OUT_OF_MEMORY;
+
+	/* Validate the whole batch up front, no LED is touched on failure. */
+	for (i = 0; i < count; i++) {
+		devices[i] = _block_find(ctx, reqs[i].device_path);
+		if (devices[i]) {
+			reqs[i].status = LED_STATUS_SUCCESS;
+		} else {
+			reqs[i].status = LED_STATUS_NOT_SUPPORTED;
+			status = LED_STATUS_NOT_SUPPORTED;
 		}
 	}
-	return LED_STATUS_NOT_SUPPORTED;
+	if (status != LED_STATUS_SUCCESS) {
+		free(devices);
+		return status;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (_ibpi_cache_hit(ctx, devices[i]->sysfs_path, reqs[i].ibpi))
+			continue;
+		if (devices[i]->send_message_fn(devices[i], reqs[i].ibpi) !=
+		    STATUS_SUCCESS)
+			reqs[i].status = LED_STATUS_DATA_ERROR;
+		else
+			_ibpi_cache_note(ctx, devices[i]->sysfs_path,
+					 reqs[i].ibpi);
+	}
+
+	/*
+	 * A single flush for the whole batch. Messages accumulated above are
+	 * coalesced by the flush layer into one transmission per controller
+	 * or enclosure.
+	 */
+	led_flush(ctx);
+	free(devices);
+
+	for (i = 0; i < count; i++)
+		if (reqs[i].status != LED_STATUS_SUCCESS)
+			return reqs[i].status;
+	return LED_STATUS_SUCCESS;
 }
 
-void led_flush(struct led_ctx *ctx)
+/**
+ * @brief Maps a committed pattern onto the state it reads back as.
+ *
+ * The one-shot and off patterns clear state rather than set it, hardware
+ * reports them as NORMAL afterwards.
+ */
+static enum led_ibpi_pattern _verify_expected(enum led_ibpi_pattern ibpi)
+{
+	switch (ibpi) {
+	case LED_IBPI_PATTERN_ONESHOT_NORMAL:
+	case LED_IBPI_PATTERN_LOCATE_OFF:
+		return LED_IBPI_PATTERN_NORMAL;
+	default:
+		return ibpi;
+	}
+}
+
+int device_verify_sample(struct led_ctx *ctx, int budget)
+{
+	const struct vector *slots;
+	int checked, fixed = 0;
+
+	if (!ctx || budget <= 0 || ctx->readonly)
+		return 0;
+
+	slots = sysfs_get_slots(ctx);
+	if (!slots->count)
+		return 0;
+	if ((size_t)budget > slots->count)
+		budget = slots->count;
+
+	for (checked = 0; checked < budget; checked++) {
+		struct slot_property *slot =
+			slots->items[ctx->verify_cursor++ % slots->count];
+		enum led_ibpi_pattern want, actual;
+		void *cached;
+
+		/*
+		 * Committed state is cached under the device path by
+		 * led_set() and under the slot id by led_slot_set(). A slot
+		 * found under neither was never written, there is nothing
+		 * to verify against.
+		 */
+		cached = slot->bl_device ?
+			 hash_map_find(&ctx->ibpi_cache,
+				       slot->bl_device->sysfs_path) : NULL;
+		if (!cached)
+			cached = hash_map_find(&ctx->ibpi_cache, slot->slot_id);
+		if (!cached)
+			continue;
+
+		want = (enum led_ibpi_pattern)((uintptr_t)cached - 1);
+		actual = slot->c->get_state_fn(slot);
+		if (actual == LED_IBPI_PATTERN_UNKNOWN ||
+		    actual == _verify_expected(want))
+			continue;
+
+		lib_log(ctx, LED_LOG_LEVEL_WARNING,
+			"slot %s reads back %s instead of %s, re-asserting\n",
+			slot->slot_id, ibpi2str(actual),
+			ibpi2str(_verify_expected(want)));
+		slot->c->set_slot_fn(slot, want);
+		fixed++;
+	}
+
+	return fixed;
+}
+
+/* Upper bound on concurrent per-controller flush threads. */
+#define FLUSH_MAX_JOBS	16
+
+/**
+ * One per-controller flush unit of led_flush(). Controllers touch disjoint
+ * hardware, so their flushes can run concurrently.
+ */
+struct flush_job {
+	struct led_ctx *ctx;
+	struct cntrl_device *cntrl;
+	pthread_t thread;
+};
+
+/**
+ * @brief Maps a controller type onto its flush latency phase.
+ */
+static enum timing_phase _flush_phase(enum led_cntrl_type cntrl_type)
+{
+	switch (cntrl_type) {
+	case LED_CNTRL_TYPE_DELLSSD:
+		return TIMING_FLUSH_DELLSSD;
+	case LED_CNTRL_TYPE_VMD:
+		return TIMING_FLUSH_VMD;
+	case LED_CNTRL_TYPE_SCSI:
+		return TIMING_FLUSH_SCSI;
+	case LED_CNTRL_TYPE_AHCI:
+		return TIMING_FLUSH_AHCI;
+	case LED_CNTRL_TYPE_NPEM:
+		return TIMING_FLUSH_NPEM;
+	case LED_CNTRL_TYPE_AMD:
+		return TIMING_FLUSH_AMD;
+	default:
+		return TIMING_FLUSH_MSG;
+	}
+}
+
+/**
+ * @brief Takes one write token of the controller, sleeping when exhausted.
+ *
+ * Token bucket holding one second worth of writes at the rate configured
+ * for the controller type. A full bucket lets the first burst after an
+ * idle period out unthrottled, so the first-fault indication is never
+ * delayed; sustained bursts are paced down to the configured rate. Runs
+ * inside the per-controller flush job, sleeping here stalls only the one
+ * controller. No-op while the type is unthrottled (the default).
+ */
+static void _flush_bucket_take(struct led_ctx *ctx, struct cntrl_device *cntrl)
+{
+	int rate = ctx->config.flush_rate[cntrl->cntrl_type];
+	uint64_t now;
+
+	if (rate <= 0)
+		return;
+
+	now = timing_now_ns();
+	if (!cntrl->flush_refill_ns) {
+		/* First throttled write, start with a full bucket. */
+		cntrl->flush_refill_ns = now;
+		cntrl->flush_tokens = rate;
+	}
+
+	for (;;) {
+		uint64_t elapsed = now - cntrl->flush_refill_ns;
+		uint64_t refill = elapsed * rate / 1000000000ULL;
+
+		if (refill) {
+			if (cntrl->flush_tokens + refill > (unsigned int)rate) {
+				cntrl->flush_tokens = rate;
+				cntrl->flush_refill_ns = now;
+			} else {
+				cntrl->flush_tokens += refill;
+				cntrl->flush_refill_ns +=
+					refill * 1000000000ULL / rate;
+			}
+		}
+		if (cntrl->flush_tokens) {
+			cntrl->flush_tokens--;
+			return;
+		}
+
+		/* Wait out the remainder until the next token. */
+		uint64_t wait = 1000000000ULL / rate -
+				(now - cntrl->flush_refill_ns);
+		struct timespec ts = {
+			.tv_sec = wait / 1000000000ULL,
+			.tv_nsec = wait % 1000000000ULL,
+		};
+
+		nanosleep(&ts, NULL);
+		now = timing_now_ns();
+	}
+}
+
+/**
+ * @brief Flushes pending messages of all devices of one controller.
+ *
+ * All devices of a single controller are flushed by one job, the
+ * per-controller flush paths coalesce state and are not reentrant. One
+ * write token is charged per device flush; types whose flush issues one
+ * command per device (SMP, NPEM) are paced exactly, the coalesced paths
+ * (SES, AMD, Dell) issue a bounded number of commands per flush and are
+ * best left unthrottled.
+ */
+static void _flush_cntrl(struct led_ctx *ctx, struct cntrl_device *cntrl)
 {
 	struct block_device *device;
+	uint64_t t = timing_now_ns();
+
+	vector_for_each(sysfs_get_block_devices(ctx), device)
+		if (device->cntrl == cntrl) {
+			_flush_bucket_take(ctx, cntrl);
+			device->flush_message_fn(device);
+		}
+	timing_add(ctx, _flush_phase(cntrl->cntrl_type), t);
+}
+
+static void *_flush_thread(void *arg)
+{
+	struct flush_job *job = arg;
+
+	_flush_cntrl(job->ctx, job->cntrl);
+	return NULL;
+}
 
-	list_for_each(sysfs_get_block_devices(ctx), device) {
-		device->flush_message_fn(device);
+/**
+ * @brief Runs a batch of per-controller flush jobs concurrently.
+ *
+ * A single job is run inline. Jobs whose thread cannot be started fall back
+ * to running inline as well, total flush time is then the maximum over the
+ * controllers instead of the sum.
+ */
+static void _flush_run_jobs(struct flush_job *jobs, size_t count)
+{
+	size_t started, i;
+
+	if (count == 1) {
+		_flush_cntrl(jobs[0].ctx, jobs[0].cntrl);
+		return;
+	}
+
+	for (started = 0; started < count; started++)
+		if (pthread_create(&jobs[started].thread, NULL, _flush_thread,
+				   &jobs[started]) != 0)
+			break;
+	for (i = started; i < count; i++)
+		_flush_cntrl(jobs[i].ctx, jobs[i].cntrl);
+	for (i = 0; i < started; i++)
+		pthread_join(jobs[i].thread, NULL);
+}
+
+/**
+ * @brief Flushes pending messages of all controllers, blocking the caller.
+ *
+ * With more controllers than job slots the batches run one after another.
+ * The starting controller rotates between flushes, so a persistently slow
+ * controller shares a batch with different neighbours each cycle instead
+ * of starving always the same ones.
+ */
+static void _flush_all(struct led_ctx *ctx)
+{
+	struct flush_job jobs[FLUSH_MAX_JOBS];
+	const struct vector *cntrls = sysfs_get_cntrl_devices(ctx);
+	size_t count = 0, i;
+
+	for (i = 0; i < cntrls->count; i++) {
+		jobs[count].ctx = ctx;
+		jobs[count].cntrl =
+			cntrls->items[(i + ctx->flush_rr) % cntrls->count];
+		count++;
+		if (count == FLUSH_MAX_JOBS) {
+			_flush_run_jobs(jobs, count);
+			count = 0;
+		}
+	}
+	if (count)
+		_flush_run_jobs(jobs, count);
+	ctx->flush_rr++;
+}
+
+static void *_flush_async_thread(void *arg)
+{
+	struct led_ctx *ctx = arg;
+
+	_flush_all(ctx);
+	pthread_mutex_lock(&ctx->flush_async.lock);
+	ctx->flush_async.in_flight = 0;
+	pthread_cond_broadcast(&ctx->flush_async.done_cond);
+	pthread_mutex_unlock(&ctx->flush_async.lock);
+	return NULL;
+}
+
+led_status_t led_wait(struct led_ctx *ctx, int timeout_ms)
+{
+	if (!ctx)
+		return LED_STATUS_NULL_POINTER;
+	if (!ctx->flush_async.running)
+		return LED_STATUS_SUCCESS;
+
+	if (timeout_ms >= 0) {
+		struct timespec ts;
+		int busy;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += timeout_ms / 1000;
+		ts.tv_nsec += (timeout_ms % 1000) * 1000000L;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		pthread_mutex_lock(&ctx->flush_async.lock);
+		while (ctx->flush_async.in_flight)
+			if (pthread_cond_timedwait(&ctx->flush_async.done_cond,
+						   &ctx->flush_async.lock,
+						   &ts) == ETIMEDOUT)
+				break;
+		busy = ctx->flush_async.in_flight;
+		pthread_mutex_unlock(&ctx->flush_async.lock);
+		if (busy)
+			return LED_STATUS_BUSY;
 	}
+	pthread_join(ctx->flush_async.thread, NULL);
+	ctx->flush_async.running = 0;
+	return LED_STATUS_SUCCESS;
+}
+
+led_status_t led_flush_async(struct led_ctx *ctx)
+{
+	if (!ctx)
+		return LED_STATUS_NULL_POINTER;
+
+	/* A read-only context has nothing to write to the hardware. */
+	if (ctx->readonly)
+		return LED_STATUS_SUCCESS;
+
+	/* The per-controller flush paths are not reentrant. */
+	led_wait(ctx, -1);
+
+	ctx->flush_async.in_flight = 1;
+	if (pthread_create(&ctx->flush_async.thread, NULL,
+			   _flush_async_thread, ctx) != 0) {
+		/* Fall back to flushing synchronously. */
+		ctx->flush_async.in_flight = 0;
+		_flush_all(ctx);
+		return LED_STATUS_SUCCESS;
+	}
+	ctx->flush_async.running = 1;
+	return LED_STATUS_SUCCESS;
+}
+
+void led_flush(struct led_ctx *ctx)
+{
+	led_wait(ctx, -1);
+
+	/* A read-only context has nothing to write to the hardware. */
+	if (ctx->readonly)
+		return;
+
+	_flush_all(ctx);
 }
 
 static struct led_slot_list_entry *init_slot(struct slot_property *slot)
@@ -180,7 +723,7 @@ led_status_t led_slots_get(struct led_ctx *ctx, struct led_slot_list **slots)
 
 	list_init(&rc->slot_list, free);
 
-	list_for_each(sysfs_get_slots(ctx), slot) {
+	vector_for_each(sysfs_get_slots(ctx), slot) {
 		struct led_slot_list_entry *entry = init_slot(slot);
 
 		if (!entry)
@@ -222,7 +765,17 @@ struct led_slot_list_entry *led_slot_find_by_device_name(struct led_ctx *ctx,
 led_status_t led_slot_set(struct led_ctx *ctx, struct led_slot_list_entry *se,
 				enum led_ibpi_pattern state)
 {
-	return set_slot_pattern(se->slot, state);
+	status_t rc;
+
+	if (_ibpi_cache_hit(ctx, se->slot->slot_id, state))
+		return LED_STATUS_SUCCESS;
+
+	rc = set_slot_pattern(se->slot, state);
+	if (rc == STATUS_SUCCESS)
+		_ibpi_cache_note(ctx, se->slot->slot_id, state);
+	/* The write changed the hardware, re-fetch on the next state read. */
+	se->state_valid = 0;
+	return rc;
 }
 
 bool led_controller_slot_support(enum led_cntrl_type cntrl)
@@ -269,7 +822,16 @@ enum led_cntrl_type led_slot_cntrl(struct led_slot_list_entry *se)
 
 enum led_ibpi_pattern led_slot_state(struct led_slot_list_entry *se)
 {
-	return get_slot_pattern(se->slot);
+	/*
+	 * Backends read the hardware (PCI config space, enclosure status
+	 * page), so the state is fetched on first access only and kept for
+	 * the entry's lifetime.
+	 */
+	if (!se->state_valid) {
+		se->state = get_slot_pattern(se->slot);
+		se->state_valid = 1;
+	}
+	return se->state;
 }
 
 void led_slot_list_free(struct led_slot_list *sl)
@@ -348,7 +910,7 @@ led_status_t led_cntrls_get(struct led_ctx *ctx, struct led_cntrl_list **cntrls)
 
 	list_init(&rc->cntrl_list, free);
 
-	list_for_each(sysfs_get_cntrl_devices(ctx), ctrl_dev) {
+	vector_for_each(sysfs_get_cntrl_devices(ctx), ctrl_dev) {
 		status = get_cntrl(ctrl_dev, rc);
 		if (status != LED_STATUS_SUCCESS)
 			return status;
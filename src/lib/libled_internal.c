@@ -10,7 +10,8 @@
 #include "libled_private.h"
 #include "utils.h"
 
-static led_status_t list_add(struct led_ctx *ctx, struct list *l, const char *path)
+static led_status_t list_add(struct led_ctx *ctx, struct list *l, struct hash_map *map,
+			     const char *path)
 {
 	char *t = NULL;
 
@@ -22,17 +23,30 @@ static led_status_t list_add(struct led_ctx *ctx, struct list *l, const char *pa
 		free(t);
 		return LED_STATUS_OUT_OF_MEMORY;
 	}
+	/* Compiled form for constant time matching, references the list-owned string. */
+	hash_map_insert(map, t, t);
 	return LED_STATUS_SUCCESS;
 }
 
 led_status_t device_allow_pattern_add(struct led_ctx *ctx, const char *path)
 {
-	return list_add(ctx, &ctx->config.allowlist, path);
+	return list_add(ctx, &ctx->config.allowlist, &ctx->config.allow_map, path);
 }
 
 led_status_t device_exclude_pattern_add(struct led_ctx *ctx, const char *path)
 {
-	return list_add(ctx, &ctx->config.excludelist, path);
+	return list_add(ctx, &ctx->config.excludelist, &ctx->config.exclude_map, path);
+}
+
+void device_patterns_reset(struct led_ctx *ctx)
+{
+	if (!ctx)
+		return;
+
+	hash_map_clear(&ctx->config.allow_map);
+	hash_map_clear(&ctx->config.exclude_map);
+	list_erase(&ctx->config.allowlist);
+	list_erase(&ctx->config.excludelist);
 }
 
 void lib_log(struct led_ctx *ctx, enum led_log_level_enum loglevel, const char *buf, ...)
@@ -51,10 +65,32 @@ void off_all(struct led_ctx *ctx)
 {
 	struct block_device *device;
 
-	list_for_each(sysfs_get_block_devices(ctx), device) {
+	vector_for_each(sysfs_get_block_devices(ctx), device) {
 		device->send_message_fn(device, LED_IBPI_PATTERN_LOCATE_OFF);
 		device->flush_message_fn(device);
 	}
+	/* Hardware no longer matches the last committed patterns. */
+	hash_map_clear(&ctx->ibpi_cache);
+}
+
+void device_ibpi_cache_force(struct led_ctx *ctx, int force)
+{
+	if (!ctx)
+		return;
+
+	ctx->ibpi_cache_force = force;
+}
+
+led_status_t device_flush_rate_set(struct led_ctx *ctx,
+				   enum led_cntrl_type cntrl_type, int rate)
+{
+	if (!ctx)
+		return LED_STATUS_NULL_POINTER;
+	if (cntrl_type > LED_CNTRL_TYPE_AMD || rate < 0)
+		return LED_STATUS_INVALID_CONTROLLER;
+
+	ctx->config.flush_rate[cntrl_type] = rate;
+	return LED_STATUS_SUCCESS;
 }
 
 led_status_t device_blink_behavior_set(struct led_ctx *ctx, int migration,
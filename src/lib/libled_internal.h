@@ -60,6 +60,80 @@ led_status_t device_allow_pattern_add(struct led_ctx *ctx, const char *path);
  */
 led_status_t device_exclude_pattern_add(struct led_ctx *ctx, const char *path);
 
+/**
+ * @brief Removes all allow and exclude patterns from the library context.
+ *
+ * Used together with device_allow_pattern_add() and
+ * device_exclude_pattern_add() to replace the pattern lists at runtime, e.g.
+ * when a daemon reloads its configuration.
+ *
+ * @param[in]	ctx	Library context.
+ */
+void device_patterns_reset(struct led_ctx *ctx);
+
+/**
+ * @brief Controls the last-committed IBPI pattern cache of the context.
+ *
+ * The library remembers the pattern last committed to hardware per device
+ * and per slot, turning idempotent led_set()/led_slot_set() calls into
+ * no-ops. With force enabled cached patterns are ignored and hardware is
+ * rewritten, which recovers LEDs after their state changed behind the
+ * library's back (expander reset, enclosure power cycle).
+ *
+ * @param[in]	ctx	Library context.
+ * @param[in]	force	Nonzero to bypass the cache, 0 to re-enable it.
+ */
+void device_ibpi_cache_force(struct led_ctx *ctx, int force);
+
+/**
+ * @brief Verifies a sample of slots against the committed LED state.
+ *
+ * Reads back the hardware state of up to budget slots, continuing the
+ * rotation where the previous call stopped, and compares each against the
+ * pattern last committed through the library. A mismatch - firmware that
+ * silently dropped a LED - is logged and the pattern re-asserted. Checking
+ * a few slots per monitor cycle covers the whole fleet within minutes at a
+ * tiny fixed per-cycle I/O cost. Slots never written through this context
+ * are skipped.
+ *
+ * @param[in]	ctx	Library context.
+ * @param[in]	budget	Maximum number of slots to read back.
+ *
+ * @return Number of slots that had drifted and were re-asserted.
+ */
+int device_verify_sample(struct led_ctx *ctx, int budget);
+
+/**
+ * @brief Limits the LED write rate of one controller type.
+ *
+ * Writes issued by the flush jobs are paced with a token bucket per
+ * controller holding one second worth of writes, so short bursts go out
+ * immediately and sustained storms are smoothed to the configured rate.
+ * Configured per controller type from the FLUSH_RATE_<type> keys of
+ * ledmon.conf.
+ *
+ * @param[in]	ctx		Library context.
+ * @param[in]	cntrl_type	Controller type the limit applies to.
+ * @param[in]	rate		Maximum writes per second, 0 to unthrottle.
+ *
+ * @return led_status_t LED_STATUS_SUCCESS on success, else error reason.
+ */
+led_status_t device_flush_rate_set(struct led_ctx *ctx,
+				   enum led_cntrl_type cntrl_type, int rate);
+
+/**
+ * @brief Forces the next scan to reconcile the block device list.
+ *
+ * The scan normally skips the block subsystem when its sysfs directory
+ * fingerprint is unchanged. After lost events (e.g. a udev queue overrun)
+ * the fingerprint can no longer be trusted; this marks it stale so the next
+ * led_scan() re-reads the block devices while the rest of the device model
+ * is still reused.
+ *
+ * @param[in]	ctx	Library context.
+ */
+void device_block_rescan_force(struct led_ctx *ctx);
+
 /**
  * @brief Log to the library context fd with the specified log level and message
  *
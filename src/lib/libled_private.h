@@ -9,13 +9,17 @@
 #define _LIB_LED_PRIVATE_INCLUDED_
 
 #include "led/libled.h"
+#include "arena.h"
 #include "sysfs.h"
 #include "list.h"
 #include "amd_sgpio.h"
 #include "slot.h"
+#include "strpool.h"
+#include "timing.h"
 #include "libled_internal.h"
 
 #include <linux/limits.h>
+#include <pthread.h>
 
 /**
  * @brief Embedded structure within the library context used for amd state and caching.
@@ -25,6 +29,101 @@ struct amd_sgpio_state {
 	struct cache_entry *cache;
 };
 
+/* Control registers per MG9098 chip tracked by the pending table and the
+ * number of chips the table can hold, see amd_ipmi.c.
+ */
+#define AMD_IPMI_CTRL_REGS	7
+#define AMD_IPMI_MAX_CHIPS	4
+
+/**
+ * @brief Pending register updates for one MG9098 backplane chip, identified
+ * by its IPMI channel and tail address. Each control register carries one
+ * bit per drive bay; set and clr hold the bits to turn on and off per
+ * register, merged over all drives queued since the last flush.
+ */
+struct amd_ipmi_chip {
+	uint8_t channel;
+	uint8_t tail_addr;
+	uint8_t set[AMD_IPMI_CTRL_REGS];
+	uint8_t clr[AMD_IPMI_CTRL_REGS];
+};
+
+/**
+ * @brief Embedded structure within the library context collecting AMD IPMI
+ * LED changes queued by the send path, see amd_ipmi.c. Drives sharing a
+ * backplane chip land in the same amd_ipmi_chip entry, so the flush writes
+ * each touched register once no matter how many drives changed state.
+ */
+struct amd_ipmi_state {
+	struct amd_ipmi_chip chips[AMD_IPMI_MAX_CHIPS];
+	int chip_count;
+};
+
+/* Capacity of the dellssd pending table, see dellssd.c. */
+#define DELLSSD_MAX_UPDATES	32
+
+/**
+ * @brief One queued Dell backplane LED change: the PCI address of the drive
+ * and the drive status mask to apply.
+ */
+struct dellssd_update {
+	uint8_t bus;
+	uint8_t dev;
+	uint8_t fun;
+	uint16_t state;
+};
+
+/**
+ * @brief Embedded structure within the library context collecting Dell
+ * backplane LED changes queued by the send path, see dellssd.c. The flush
+ * resolves the bay/slot mapping of all queued drives in one pipelined IPMI
+ * transaction and writes the drive states back-to-back in a second one.
+ */
+struct dellssd_state {
+	struct dellssd_update updates[DELLSSD_MAX_UPDATES];
+	int count;
+};
+
+struct pci_access;
+
+/**
+ * @brief Embedded structure within the library context holding libpci state
+ * cached between NPEM register accesses, see npem.c. The pci_access handle is
+ * created lazily on first use and the map resolves controller sysfs paths to
+ * pci devices with their NPEM capability offset. Dropped by sysfs_reset(),
+ * i.e. on every PCI topology change.
+ */
+struct npem_state {
+	struct pci_access *pacc;
+	struct list devs;
+	struct hash_map dev_map;
+};
+
+/**
+ * @brief Embedded structure within the library context holding the state of
+ * the background flush started by led_flush_async(), see libled.c. The
+ * worker thread runs the per-controller flush jobs, in_flight goes to zero
+ * under the lock when the last write completed.
+ */
+struct flush_async_state {
+	pthread_t thread;
+	int running;		/* thread started and not joined yet */
+	pthread_mutex_t lock;
+	pthread_cond_t done_cond;
+	int in_flight;		/* controller jobs still writing */
+};
+
+/**
+ * @brief Embedded structure within the library context holding the publisher
+ * side of the shared-memory state export, see state_shm.c. The mapping is
+ * created on first publish and grown when the slot model outgrows the file.
+ */
+struct state_shm_pub {
+	int fd;
+	void *map;
+	size_t size;
+};
+
 /**
  * @brief Configuration options for the library.  Mainly used by ledmon.
  */
@@ -36,6 +135,25 @@ struct configuration {
 
 	struct list allowlist;
 	struct list excludelist;
+
+	/**
+	 * Compiled form of the pattern lists above: hash sets keyed by the
+	 * pattern, values referencing the list-owned strings. Controllers are
+	 * matched by exact path, so a set lookup costs O(path length) no
+	 * matter how many patterns are configured. Kept in sync by
+	 * device_*_pattern_add() and device_patterns_reset().
+	 */
+	struct hash_map allow_map;
+	struct hash_map exclude_map;
+
+	/**
+	 * Upper bound on LED write commands per second, indexed by
+	 * controller type, 0 leaves the type unthrottled. Enforced with a
+	 * token bucket per controller by the flush jobs, see
+	 * _flush_bucket_take() in libled.c. Set through
+	 * device_flush_rate_set().
+	 */
+	int flush_rate[LED_CNTRL_TYPE_AMD + 1];
 };
 
 /**
@@ -44,6 +162,15 @@ struct configuration {
 struct led_slot_list_entry {
 	struct slot_property *slot;
 	char device_name[PATH_MAX];
+
+	/**
+	 * LED state of the slot, fetched from the hardware backend on the
+	 * first led_slot_state() call and reused for the entry's lifetime,
+	 * so listing slots touches only the hardware the caller looks at.
+	 * Invalidated by led_slot_set().
+	 */
+	enum led_ibpi_pattern state;
+	int state_valid;
 };
 
 /**
@@ -78,12 +205,131 @@ struct led_cntrl_list {
  */
 struct led_ctx {
 	struct sysfs sys;
+
+	/**
+	 * Arena for scan-lifetime objects retained while sysfs topology is
+	 * unchanged: list nodes of the device model and slot properties.
+	 * Reset as a whole by sysfs_reset() instead of per-object free().
+	 */
+	struct arena scan_arena;
+
+	/**
+	 * Arena for RAID state objects rebuilt on every rescan: tail devices
+	 * and nodes of the volume/container/tail lists. Reset by
+	 * sysfs_rescan() even when the rest of the model is retained.
+	 */
+	struct arena raid_arena;
+
+	/**
+	 * Interning pool for the sysfs paths referenced by the device model.
+	 * Identical paths share one immutable allocation, so duplicating a
+	 * device is a pointer copy and path equality on the compare hot path
+	 * reduces to a pointer comparison. Entries live as long as the context
+	 * because duplicated block devices keep referencing them across
+	 * rescans.
+	 */
+	struct str_pool path_pool;
+
+	/**
+	 * Accumulated wall time of scan phases and controller write paths,
+	 * see timing.h. Dumped to the log and reset by timing_report(),
+	 * which ledmon triggers on SIGUSR1.
+	 */
+	struct phase_time timing[TIMING_PHASE_COUNT];
+
+	/**
+	 * Last IBPI pattern committed to hardware, keyed by device sysfs
+	 * path for led_set() and by slot id for the slot API. Idempotent
+	 * re-assertions of the cached pattern are turned into no-ops, see
+	 * device_ibpi_cache_force() for the recovery escape hatch. Values
+	 * carry a +1 bias so LED_IBPI_PATTERN_UNKNOWN (0) is distinguishable
+	 * from a missing key.
+	 */
+	struct hash_map ibpi_cache;
+
+	/**
+	 * Serializes access to ibpi_cache, so callers may set LEDs of
+	 * different controllers from concurrent threads (e.g. ledctl batch
+	 * partitions). The controller backends themselves touch disjoint
+	 * hardware per type; the shared BMC path is guarded by ipmi_lock.
+	 */
+	pthread_mutex_t ibpi_cache_lock;
+
+	/**
+	 * Canonical path cache of led_device_name_lookup(), keyed by the
+	 * user-supplied name. Values are interned in path_pool, so the map
+	 * holds no owned memory. Cleared by sysfs_reset(), i.e. whenever
+	 * devices may have disappeared or been renumbered, and emptied
+	 * wholesale when it grows past its cap.
+	 */
+	struct hash_map name_cache;
+
+	/**
+	 * Controller classification cache of cntrl_device_init(), keyed by
+	 * the controller sysfs path. The resolved controller type and the
+	 * enclosure management capability are encoded inline in the item
+	 * pointer, so the map owns no memory. Hardware does not change type
+	 * while the system is up; the cache is dropped only when the PCI
+	 * device or enclosure set changes, see sysfs_rescan().
+	 */
+	struct hash_map cntrl_probe_cache;
+
+	/**
+	 * When set, cached patterns are ignored and hardware is rewritten.
+	 * Used to recover LEDs after hardware state changed behind the
+	 * library's back.
+	 */
+	int ibpi_cache_force;
+
+	/**
+	 * Current generation of SES configuration pages. Bumped whenever the
+	 * device model is torn down, so cached enclosure pages 1 and 10 are
+	 * re-fetched after a topology change, see ses_load_pages().
+	 */
+	unsigned int ses_cfg_gen;
+
 	int log_fd;
 	enum led_log_level_enum log_lvl;
 	led_status_t deferred_error;
 	int dellssd_hw_gen;	/* cached value for dellssd hardware generation */
 	long ipmi_msgid;	/* incrementing message id */
+	int ipmi_fd;		/* persistent fd to the local BMC, -1 when closed */
+	pthread_mutex_t ipmi_lock;	/* serializes IPMI transactions */
+	/**
+	 * Non-zero for contexts created by led_ctx_open_readonly(). The slot
+	 * model of such a context is rebuilt from the shared-memory state
+	 * published by ledmon, scans touch neither sysfs nor hardware and
+	 * setting LED states is refused.
+	 */
+	int readonly;
+
+	/**
+	 * Controller families covered by the scan, a bitwise or of
+	 * LED_SCAN_MASK() values. Set by led_scan_filtered(), consulted by
+	 * the sysfs module to skip probing of filtered families.
+	 */
+	uint32_t scan_mask;
+
+	/**
+	 * Rotation cursor of the sampled read-back verification, the index
+	 * of the next slot to check, see device_verify_sample().
+	 */
+	unsigned int verify_cursor;
+
+	/**
+	 * Rotation offset of the per-controller flush jobs. Advanced by
+	 * every flush so with more controllers than job slots each batch
+	 * starts with a different controller; a persistently slow one then
+	 * delays different neighbours each cycle instead of always the same.
+	 */
+	unsigned int flush_rr;
+
+	struct flush_async_state flush_async;
+	struct state_shm_pub shm;
 	struct amd_sgpio_state amd_sgpio;
+	struct amd_ipmi_state amd_ipmi;
+	struct dellssd_state dellssd;
+	struct npem_state npem;
 	struct configuration config;
 
 	struct led_cntrl_list cl;
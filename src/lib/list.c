@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <stdbool.h>
 
+#include "arena.h"
 #include "list.h"
 #include "libled_private.h"
 #include "utils.h"
@@ -15,7 +16,8 @@ void __list_erase(struct list *list, item_free_t free_fn)
 	list_for_each_node(list, node) {
 		if (free_fn)
 			free_fn(node->item);
-		free(node);
+		if (!list->arena)
+			free(node);
 	}
 	list->head = list->tail = NULL;
 }
@@ -46,7 +48,10 @@ bool list_insert(struct list *list, void *item, struct node *after)
 	struct node **x;
 
 	assert(item != NULL);
-	new = malloc(sizeof(struct node));
+	if (list->arena)
+		new = arena_alloc(list->arena, sizeof(struct node));
+	else
+		new = malloc(sizeof(struct node));
 	if (!new) {
 		return false;
 	}
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 
 struct led_ctx;
+struct arena;
 
 struct node {
 	struct node *next, *prev;
@@ -20,6 +21,11 @@ typedef void (*item_free_t)(void *);
 struct list {
 	struct node *head, *tail;
 	item_free_t item_free;
+	/**
+	 * If set, list nodes are drawn from this arena instead of the heap
+	 * and are released by the arena owner, see list_init_arena().
+	 */
+	struct arena *arena;
 };
 
 #define __list_for_each_node(__list, __node, __start_fn, __iter_fn) \
@@ -57,12 +63,33 @@ static inline void list_init(struct list *list, item_free_t item_free_fn)
 {
 	list->head = NULL;
 	list->tail = NULL;
+	list->arena = NULL;
 	if (item_free_fn)
 		list->item_free = item_free_fn;
 	else
 		list->item_free = free;
 }
 
+/**
+ * @brief Initializes a list object with arena-backed nodes.
+ *
+ * Same as list_init(), but list nodes are allocated from the given arena
+ * instead of the heap. Erasing or deleting elements still runs the item free
+ * callback, only node memory is left to the arena owner. The arena must not
+ * be reset while the list holds elements.
+ *
+ * @param[in]      list           pointer to a list object.
+ * @param[in]      item_free_fn   custom callback for deallocating list items.
+ *                                If NULL, free() will be used.
+ * @param[in]      arena          arena the list nodes are drawn from.
+ */
+static inline void list_init_arena(struct list *list, item_free_t item_free_fn,
+				   struct arena *arena)
+{
+	list_init(list, item_free_fn);
+	list->arena = arena;
+}
+
 /**
  * @brief Clears a list and frees the items it contains.
  *
@@ -117,8 +144,11 @@ static inline void list_remove(struct node *node)
 static inline void list_delete(struct node *node)
 {
 	void __list_remove(struct node *node, item_free_t free_fn);
-	__list_remove(node, node->list->item_free);
-	free(node);
+	struct list *list = node->list;
+
+	__list_remove(node, list->item_free);
+	if (!list->arena)
+		free(node);
 }
 
 /**
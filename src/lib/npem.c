@@ -7,6 +7,7 @@
 #include <pci/pci.h>
 #include <time.h>
 #include <stdbool.h>
+#include <unistd.h>
 
 #include "config.h"
 #include "libled_private.h"
@@ -95,30 +96,149 @@ static struct pci_cap *get_npem_cap(struct pci_dev *pdev)
 	return pci_find_cap(pdev, PCI_EXT_CAP_ID_NPEM, PCI_CAP_EXTENDED);
 }
 
-static u32 read_npem_register(struct pci_dev *pdev, int reg)
+/**
+ * @brief Cached pci device with its NPEM capability offset resolved.
+ */
+struct npem_dev {
+	struct pci_dev *pdev;
+	struct pci_cap *pcap;
+
+	/**
+	 * Deferred command state. issue_ns is the monotonic time the last
+	 * control write was issued, zero once its completion was observed.
+	 * While a command is outstanding a new control value is parked in
+	 * pending_cap and issued by npem_flush() instead of busy-waiting
+	 * for the completion bit.
+	 */
+	uint64_t issue_ns;
+	u32 pending_cap;
+	int pending;
+};
+
+/*
+ * Software must wait for an NPEM command to complete before issuing the next
+ * NPEM command. However, if this bit is not set within 1 second limit on
+ * command execution, software is permitted to repeat the NPEM command or
+ * issue the next NPEM command. PCIe r4.0 sec 7.9.20.4
+ */
+#define NPEM_CMD_TIMEOUT_NS	1000000000ULL
+
+/* Completion poll granularity while waiting for an outstanding command. */
+#define NPEM_POLL_INTERVAL_US	1000
+
+static void _npem_dev_free(void *item)
 {
-	u32 val = 0;
-	struct pci_cap *pcap = get_npem_cap(pdev);
+	struct npem_dev *dev = item;
 
-	if (!pcap)
-		return val;
+	pci_free_dev(dev->pdev);
+	free(dev);
+}
+
+void npem_cache_init(struct led_ctx *ctx)
+{
+	ctx->npem.pacc = NULL;
+	list_init(&ctx->npem.devs, _npem_dev_free);
+	hash_map_init(&ctx->npem.dev_map);
+}
 
-	return pci_read_long(pdev, pcap->addr + reg);
+void npem_cache_reset(struct led_ctx *ctx)
+{
+	hash_map_clear(&ctx->npem.dev_map);
+	list_erase(&ctx->npem.devs);
+	if (ctx->npem.pacc) {
+		pci_cleanup(ctx->npem.pacc);
+		ctx->npem.pacc = NULL;
+	}
 }
 
-static int write_npem_register(struct pci_dev *pdev, int reg, u32 val)
+void npem_cache_fini(struct led_ctx *ctx)
+{
+	npem_cache_reset(ctx);
+	hash_map_fini(&ctx->npem.dev_map);
+}
+
+/**
+ * @brief Returns the persistent pci access handle of the context.
+ *
+ * This is internal function of npem module. Initializing a pci_access
+ * re-reads the whole PCI bus, so one handle is kept in the library context
+ * and created lazily on first use.
+ */
+static struct pci_access *_npem_pacc_get(struct led_ctx *ctx, const char *path)
+{
+	if (!ctx->npem.pacc) {
+		ctx->npem.pacc = get_pci_access();
+		if (!ctx->npem.pacc)
+			lib_log(ctx, LED_LOG_LEVEL_ERROR,
+				"NPEM: Unable to initialize pci access for %s\n", path);
+	}
+	return ctx->npem.pacc;
+}
+
+/**
+ * @brief Returns the cached pci device of an NPEM controller.
+ *
+ * This is internal function of npem module. The pci device and its NPEM
+ * capability offset are resolved once per controller and kept in the library
+ * context, so register accesses do not re-walk the capability list. The
+ * cache lives until the next PCI topology change, see npem_cache_reset().
+ */
+static struct npem_dev *_npem_dev_get(struct led_ctx *ctx, const char *path)
 {
-	struct pci_cap *pcap = get_npem_cap(pdev);
+	struct npem_dev *dev = hash_map_find(&ctx->npem.dev_map, path);
+	struct pci_access *pacc;
+	struct pci_dev *pdev;
+
+	if (dev)
+		return dev;
+
+	pacc = _npem_pacc_get(ctx, path);
+	if (!pacc)
+		return NULL;
+
+	pdev = get_pci_dev(pacc, path);
+	if (!pdev) {
+		lib_log(ctx, LED_LOG_LEVEL_ERROR,
+			"NPEM: Unable to get pci device for %s\n", path);
+		return NULL;
+	}
+
+	dev = calloc(1, sizeof(*dev));
+	if (!dev) {
+		pci_free_dev(pdev);
+		return NULL;
+	}
+	dev->pdev = pdev;
+	dev->pcap = get_npem_cap(pdev);
+
+	if (!list_append(&ctx->npem.devs, dev)) {
+		_npem_dev_free(dev);
+		return NULL;
+	}
+	hash_map_insert(&ctx->npem.dev_map, path, dev);
+
+	return dev;
+}
+
+static u32 read_npem_register(struct npem_dev *dev, int reg)
+{
+	if (!dev->pcap)
+		return 0;
+
+	return pci_read_long(dev->pdev, dev->pcap->addr + reg);
+}
 
-	if (!pcap)
+static int write_npem_register(struct npem_dev *dev, int reg, u32 val)
+{
+	if (!dev->pcap)
 		return val;
 
-	return pci_write_long(pdev, pcap->addr + reg, val);
+	return pci_write_long(dev->pdev, dev->pcap->addr + reg, val);
 }
 
-static bool is_mask_set(struct pci_dev *pdev, int reg,  u32 mask)
+static bool is_mask_set(struct npem_dev *dev, int reg,  u32 mask)
 {
-	u32 reg_val = read_npem_register(pdev, reg);
+	u32 reg_val = read_npem_register(dev, reg);
 
 	if (reg_val & mask)
 		return true;
@@ -127,54 +247,67 @@ static bool is_mask_set(struct pci_dev *pdev, int reg,  u32 mask)
 
 int is_npem_capable(const char *path, struct led_ctx *ctx)
 {
-	u8 val;
-	struct pci_access *pacc = get_pci_access();
+	u8 val = 0;
+	struct pci_access *pacc = _npem_pacc_get(ctx, path);
 	struct pci_dev *pdev;
+	struct pci_cap *pcap;
 
-	if (!pacc) {
-		lib_log(ctx, LED_LOG_LEVEL_ERROR,
-			"NPEM: Unable to initialize pci access for %s\n", path);
+	if (!pacc)
 		return 0;
-	}
 
 	pdev = get_pci_dev(pacc, path);
 
-	if (!pdev) {
-		pci_cleanup(pacc);
+	if (!pdev)
 		return 0;
-	}
 
-	val = read_npem_register(pdev, PCI_NPEM_CAP_REG);
+	pcap = get_npem_cap(pdev);
+	if (pcap)
+		val = pci_read_long(pdev, pcap->addr + PCI_NPEM_CAP_REG);
 
 	pci_free_dev(pdev);
-	pci_cleanup(pacc);
 	return (val & PCI_NPEM_CAP);
 }
 
-static void npem_wait_command(struct pci_dev *pdev)
+/**
+ * @brief Checks whether the controller is ready for the next command.
+ *
+ * This is internal function of npem module. A command is considered done
+ * when the Command Completed bit is set or when the 1 second limit the
+ * specification puts on command execution expired, see NPEM_CMD_TIMEOUT_NS.
+ * A command of unknown age, e.g. issued before the library started, gets
+ * its clock started on first sight instead of being waited for.
+ *
+ * @return true if a new command may be issued.
+ */
+static bool _npem_cmd_done(struct npem_dev *dev)
 {
-/*
- * Software must wait for an NPEM command to complete before issuing
- * the next NPEM command. However, if this bit is not set within
- * 1 second limit on command execution, software is permitted to repeat
- * the NPEM command or issue the next NPEM command.
- * PCIe r4.0 sec 7.9.20.4
+	if (is_mask_set(dev, PCI_NPEM_STATUS_REG, PCI_NPEM_STATUS_CC)) {
+		dev->issue_ns = 0;
+		return true;
+	}
+	if (!dev->issue_ns) {
+		dev->issue_ns = timing_now_ns();
+		return false;
+	}
+	if (timing_now_ns() - dev->issue_ns >= NPEM_CMD_TIMEOUT_NS) {
+		dev->issue_ns = 0;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Issues an NPEM control write and starts its completion clock.
  *
- * Poll the status register until the Command Completed bit becomes set
- * or timeout is reached.
+ * This is internal function of npem module.
  */
-	time_t start, end;
-
-	/* Check status_cc first to avoid system call if not needed */
-	if (is_mask_set(pdev, PCI_NPEM_STATUS_REG, PCI_NPEM_STATUS_CC))
-		return;
-
-	start = time(NULL);
-	do {
-		if (is_mask_set(pdev, PCI_NPEM_STATUS_REG, PCI_NPEM_STATUS_CC))
-			return;
-		end = time(NULL);
-	} while (difftime(end, start) < 1);
+static void _npem_issue(struct npem_dev *dev, u32 cap)
+{
+	u32 reg = read_npem_register(dev, PCI_NPEM_CTRL_REG);
+	u32 val = (reg & PCI_NPEM_RESERVED) | PCI_NPEM_CAP | cap;
+
+	write_npem_register(dev, PCI_NPEM_CTRL_REG, val);
+	dev->issue_ns = timing_now_ns();
 }
 
 char *npem_get_path(const char *cntrl_path)
@@ -185,44 +318,25 @@ char *npem_get_path(const char *cntrl_path)
 enum led_ibpi_pattern npem_get_state(struct slot_property *slot)
 {
 	u32 reg;
-	struct pci_dev *pdev = NULL;
 	const struct ibpi2value *ibpi2val;
 	const char *path = slot->slot_spec.cntrl->sysfs_path;
-	struct pci_access *pacc = get_pci_access();
 	struct led_ctx *ctx = slot->slot_spec.cntrl->ctx;
+	struct npem_dev *dev = _npem_dev_get(ctx, path);
 
-	if (!pacc) {
-		lib_log(ctx, LED_LOG_LEVEL_ERROR,
-			"NPEM: Unable to initialize pci access for %s\n", path);
+	if (!dev)
 		return LED_IBPI_PATTERN_UNKNOWN;
-	}
-
-	pdev = get_pci_dev(pacc, path);
 
-	if (!pdev) {
-		lib_log(ctx, LED_LOG_LEVEL_ERROR, "NPEM: Unable to get pci device for %s\n", path);
-		pci_cleanup(pacc);
-		return LED_IBPI_PATTERN_UNKNOWN;
-	}
-
-	reg = read_npem_register(pdev, PCI_NPEM_CTRL_REG);
+	reg = read_npem_register(dev, PCI_NPEM_CTRL_REG);
 	ibpi2val =  get_by_bits(reg, ibpi_to_npem_capability,
 				ARRAY_SIZE(ibpi_to_npem_capability));
 
-	pci_free_dev(pdev);
-	pci_cleanup(pacc);
-
 	return ibpi2val->ibpi;
 }
 
 status_t npem_set_slot(struct led_ctx *ctx, const char *sysfs_path, enum led_ibpi_pattern state)
 {
-	struct pci_dev *pdev = NULL;
-	struct pci_access *pacc = get_pci_access();
+	struct npem_dev *dev;
 	const struct ibpi2value *ibpi2val;
-
-	u32 val;
-	u32 reg;
 	u32 cap;
 
 	ibpi2val = get_by_ibpi(state, ibpi_to_npem_capability,
@@ -235,39 +349,51 @@ status_t npem_set_slot(struct led_ctx *ctx, const char *sysfs_path, enum led_ibp
 	}
 	cap = (u32)ibpi2val->value;
 
-	if (!pacc) {
-		lib_log(ctx, LED_LOG_LEVEL_ERROR,
-			"NPEM: Unable to initialize pci access for %s\n", sysfs_path);
+	dev = _npem_dev_get(ctx, sysfs_path);
+	if (!dev)
 		return STATUS_NULL_POINTER;
-	}
 
-	pdev = get_pci_dev(pacc, sysfs_path);
-	if (!pdev) {
-		lib_log(ctx, LED_LOG_LEVEL_ERROR,
-			"NPEM: Unable to get pci device for %s\n", sysfs_path);
-		pci_cleanup(pacc);
-		return STATUS_NULL_POINTER;
-	}
-
-	if (!is_mask_set(pdev, PCI_NPEM_CAP_REG, cap)) {
+	if (!is_mask_set(dev, PCI_NPEM_CAP_REG, cap)) {
 		lib_log(ctx, LED_LOG_LEVEL_INFO,
 			"NPEM: Controller %s doesn't support %s pattern\n", sysfs_path,
 			ibpi2str(state));
-		pci_free_dev(pdev);
-		pci_cleanup(pacc);
 		return STATUS_INVALID_STATE;
 	}
-	npem_wait_command(pdev);
+	if (_npem_cmd_done(dev)) {
+		_npem_issue(dev, cap);
+		dev->pending = 0;
+	} else {
+		/*
+		 * The previous command still runs, the write is picked up by
+		 * npem_flush() instead of busy-waiting here. A newer value
+		 * simply replaces an already parked one.
+		 */
+		dev->pending_cap = cap;
+		dev->pending = 1;
+	}
 
-	reg = read_npem_register(pdev, PCI_NPEM_CTRL_REG);
-	val = (reg & PCI_NPEM_RESERVED);
-	val = (val | PCI_NPEM_CAP | cap);
+	return STATUS_SUCCESS;
+}
 
-	write_npem_register(pdev, PCI_NPEM_CTRL_REG, val);
+int npem_flush(struct block_device *device)
+{
+	struct led_ctx *ctx = device->cntrl->ctx;
+	struct npem_dev *dev;
 
-	pci_free_dev(pdev);
-	pci_cleanup(pacc);
-	return STATUS_SUCCESS;
+	dev = hash_map_find(&ctx->npem.dev_map, device->cntrl->sysfs_path);
+	if (!dev || !dev->pending)
+		return 0;
+
+	/*
+	 * The parked command must be issued before returning, a one-shot
+	 * caller never flushes again. The wait is bounded by the command
+	 * timeout, see _npem_cmd_done().
+	 */
+	while (!_npem_cmd_done(dev))
+		usleep(NPEM_POLL_INTERVAL_US);
+	_npem_issue(dev, dev->pending_cap);
+	dev->pending = 0;
+	return 0;
 }
 
 status_t npem_write(struct block_device *device, enum led_ibpi_pattern ibpi)
@@ -289,7 +415,8 @@ const struct slot_property_common npem_slot_common = {
 
 struct slot_property *npem_slot_property_init(struct cntrl_device *npem_cntrl)
 {
-	struct slot_property *result = calloc(1, sizeof(struct slot_property));
+	struct slot_property *result =
+		arena_alloc(&npem_cntrl->ctx->scan_arena, sizeof(struct slot_property));
 	if (result == NULL)
 		return NULL;
 
@@ -303,5 +430,28 @@ struct slot_property *npem_slot_property_init(struct cntrl_device *npem_cntrl)
 
 status_t npem_set_state(struct slot_property *slot, enum led_ibpi_pattern state)
 {
-	return npem_set_slot(slot->slot_spec.cntrl->ctx, slot->slot_spec.cntrl->sysfs_path, state);
+	struct led_ctx *ctx = slot->slot_spec.cntrl->ctx;
+	const char *path = slot->slot_spec.cntrl->sysfs_path;
+	struct npem_dev *dev;
+	status_t status;
+
+	status = npem_set_slot(ctx, path, state);
+	if (status != STATUS_SUCCESS)
+		return status;
+
+	/*
+	 * The slot API has no flush call which would pick a parked command
+	 * up, so make sure the write is issued before returning. Bounded by
+	 * the command timeout, see _npem_cmd_done().
+	 */
+	dev = hash_map_find(&ctx->npem.dev_map, path);
+	while (dev && dev->pending) {
+		if (_npem_cmd_done(dev)) {
+			_npem_issue(dev, dev->pending_cap);
+			dev->pending = 0;
+			break;
+		}
+		usleep(NPEM_POLL_INTERVAL_US);
+	}
+	return STATUS_SUCCESS;
 }
@@ -11,8 +11,48 @@
 
 int is_npem_capable(const char *path, struct led_ctx *ctx);
 status_t npem_write(struct block_device *device, enum led_ibpi_pattern ibpi);
+
+/**
+ * @brief Issues a control write parked behind an outstanding command.
+ *
+ * Registered as the flush function of NPEM block devices. npem_write() does
+ * not wait for the completion of the previous command; a value it could not
+ * issue is parked and written here once the controller is ready. Waiting is
+ * bounded by a time budget, a still busy controller is retried on the next
+ * flush cycle.
+ *
+ * @param[in]         device     Block device to flush.
+ *
+ * @return The function always returns 0.
+ */
+int npem_flush(struct block_device *device);
+
 char *npem_get_path(const char *cntrl_path);
 
+/**
+ * @brief Initializes the libpci cache embedded in the library context.
+ *
+ * @param[in]         ctx        Library context.
+ */
+void npem_cache_init(struct led_ctx *ctx);
+
+/**
+ * @brief Drops cached libpci state.
+ *
+ * Releases cached pci devices and the pci access handle. Called when the PCI
+ * topology may have changed; the cache is rebuilt lazily on next use.
+ *
+ * @param[in]         ctx        Library context.
+ */
+void npem_cache_reset(struct led_ctx *ctx);
+
+/**
+ * @brief Releases the libpci cache embedded in the library context.
+ *
+ * @param[in]         ctx        Library context.
+ */
+void npem_cache_fini(struct led_ctx *ctx);
+
 /**
  * @brief Gets slot information.
  *
@@ -3,8 +3,10 @@
 
 #include <limits.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <unistd.h>
 
 #if _HAVE_DMALLOC_H
@@ -29,7 +31,7 @@ struct pci_slot *pci_slot_init(const char *path, struct led_ctx *ctx)
 	result = calloc(1, sizeof(struct pci_slot));
 	if (result == NULL)
 		return NULL;
-	result->sysfs_path = strdup(path);
+	result->sysfs_path = str_pool_intern(&ctx->path_pool, path);
 	if (!result->sysfs_path) {
 		goto error;
 	}
@@ -39,10 +41,23 @@ struct pci_slot *pci_slot_init(const char *path, struct led_ctx *ctx)
 
 	result->ctx = ctx;
 
+	/*
+	 * Attention only changes on explicit writes; watch the file so the
+	 * cached value is served without file I/O until then. Without a
+	 * watch the value is simply re-read on every access.
+	 */
+	result->attention_wd = -1;
+	if (ctx->sys.pci_ino_fd >= 0) {
+		char temp[PATH_MAX];
+
+		snprintf(temp, PATH_MAX, "%s/attention", path);
+		result->attention_wd = inotify_add_watch(ctx->sys.pci_ino_fd,
+							 temp, IN_MODIFY | IN_CLOSE_WRITE);
+	}
+
 	return result;
 error:
 	free(result->address);
-	free(result->sysfs_path);
 	free(result);
 	return NULL;
 }
@@ -54,12 +69,43 @@ error:
 void pci_slot_fini(struct pci_slot *slot)
 {
 	if (slot) {
-		free(slot->sysfs_path);
+		if (slot->attention_wd >= 0)
+			inotify_rm_watch(slot->ctx->sys.pci_ino_fd,
+					 slot->attention_wd);
+		/* sysfs_path is interned, the pool owns it. */
 		free(slot->address);
 		free(slot);
 	}
 }
 
+/*
+ * Invalidates cached attention values for slots with pending notifications.
+ * See pci_slot.h for details.
+ */
+void pci_slot_attention_drain(struct led_ctx *ctx)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	if (ctx->sys.pci_ino_fd < 0)
+		return;
+
+	while ((len = read(ctx->sys.pci_ino_fd, buf, sizeof(buf))) > 0) {
+		ssize_t off = 0;
+
+		while (off < len) {
+			struct inotify_event *ev =
+				(struct inotify_event *)(buf + off);
+			struct pci_slot *slot;
+
+			list_for_each(&ctx->sys.pci_slots_list, slot)
+				if (slot->attention_wd == ev->wd)
+					slot->attention_valid = 0;
+			off += sizeof(*ev) + ev->len;
+		}
+	}
+}
+
 const struct slot_property_common pci_slot_common = {
 	.cntrl_type = LED_CNTRL_TYPE_VMD,
 	.get_state_fn = pci_get_state,
@@ -68,7 +114,8 @@ const struct slot_property_common pci_slot_common = {
 
 struct slot_property *pci_slot_property_init(struct pci_slot *pci_slot)
 {
-	struct slot_property *result = calloc(1, sizeof(struct slot_property));
+	struct slot_property *result =
+		arena_alloc(&pci_slot->ctx->scan_arena, sizeof(struct slot_property));
 	if (result == NULL)
 		return NULL;
 
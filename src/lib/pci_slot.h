@@ -25,6 +25,19 @@ struct pci_slot {
  */
 	char *address;
 
+ /**
+ * Cached raw value of the attention attribute, meaningful only when
+ * attention_valid is set. Kept current by the inotify watch, so repeated
+ * state reads do not touch the file.
+ */
+	int attention;
+	int attention_valid;
+
+ /**
+ * Inotify watch descriptor of the attention file, -1 when unwatched.
+ */
+	int attention_wd;
+
 	struct led_ctx *ctx;
 };
 
@@ -88,4 +101,15 @@ status_t pci_set_slot(struct slot_property *slot, enum led_ibpi_pattern state);
  */
 struct slot_property *pci_slot_property_init(struct pci_slot *pci_slot);
 
+/**
+ * @brief Applies pending attention change notifications.
+ *
+ * Drains the inotify descriptor watching the attention attributes and marks
+ * the cached value of every touched slot invalid, so the next state read
+ * goes back to the file. Cheap when nothing changed.
+ *
+ * @param[in]      ctx            The library context.
+ */
+void pci_slot_attention_drain(struct led_ctx *ctx);
+
 #endif // PCI_SLOT_H_INCLUDED_
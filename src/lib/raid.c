@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #if _HAVE_DMALLOC_H
 #include <dmalloc.h>
@@ -22,13 +23,12 @@
 #include "libled_private.h"
 
 /**
+ * @brief Translates the content of md/array_state attribute, p may be NULL.
  */
-static enum raid_state _get_array_state(const char *path)
+static enum raid_state _get_array_state(const char *p)
 {
-	char buf[BUF_SZ_SM];
 	enum raid_state state = RAID_STATE_UNKNOWN;
 
-	char *p = get_text_to_dest(path, "md/array_state", buf, sizeof(buf));
 	if (p) {
 		if (strcmp(p, "clear") == 0)
 			state = RAID_STATE_CLEAR;
@@ -53,13 +53,12 @@ static enum raid_state _get_array_state(const char *path)
 }
 
 /**
+ * @brief Translates the content of md/sync_action attribute, p may be NULL.
  */
-static enum raid_action _get_sync_action(const char *path)
+static enum raid_action _get_sync_action(const char *p)
 {
-	char buf[BUF_SZ_SM];
 	enum raid_action action = RAID_ACTION_UNKNOWN;
 
-	char *p = get_text_to_dest(path, "md/sync_action", buf, sizeof(buf));
 	if (p) {
 		if (strcmp(p, "idle") == 0)
 			action = RAID_ACTION_IDLE;
@@ -80,13 +79,12 @@ static enum raid_action _get_sync_action(const char *path)
 }
 
 /**
+ * @brief Translates the content of md/level attribute, p may be NULL.
  */
-static enum raid_level _get_level(const char *path)
+static enum raid_level _get_level(const char *p)
 {
-	char buf[BUF_SZ_SM];
 	enum raid_level result = RAID_LEVEL_UNKNOWN;
 
-	char *p = get_text_to_dest(path, "md/level", buf, sizeof(buf));
 	if (p) {
 		if (strcmp(p, "raid0") == 0)
 			result = RAID_LEVEL_0;
@@ -108,40 +106,126 @@ static enum raid_level _get_level(const char *path)
 	return result;
 }
 
+/**
+ * @brief Fetches the lazily loaded attributes on first access.
+ *
+ * Everything besides md/array_state is read here, in one batch, the first
+ * time any of it is asked for. Devices are rebuilt on every rescan, so the
+ * object lifetime doubles as the scan generation and no explicit
+ * invalidation is needed.
+ */
+static void _raid_load_attrs(struct raid_device *device)
+{
+	char action_buf[BUF_SZ_SM], level_buf[BUF_SZ_SM];
+	char degraded_buf[BUF_SZ_NUM], disks_buf[BUF_SZ_NUM];
+	struct sysfs_attr attrs[] = {
+		{.name = "md/sync_action", .buf = action_buf, .buf_size = sizeof(action_buf)},
+		{.name = "md/level", .buf = level_buf, .buf_size = sizeof(level_buf)},
+		{.name = "md/degraded", .buf = degraded_buf, .buf_size = sizeof(degraded_buf)},
+		{.name = "md/raid_disks", .buf = disks_buf, .buf_size = sizeof(disks_buf)},
+	};
+	const char *debug_dev;
+	int dirfd;
+
+	if (device->attrs_loaded)
+		return;
+	device->attrs_loaded = 1;
+
+	dirfd = sysfs_open_dir(device->sysfs_path);
+	sysfs_read_attrs(dirfd, attrs, ARRAY_SIZE(attrs));
+	if (dirfd >= 0)
+		close(dirfd);
+
+	device->sync_action = _get_sync_action(attrs[0].value);
+	device->level = _get_level(attrs[1].value);
+	device->degraded = -1;
+	if (attrs[2].value)
+		str_toi(&device->degraded, attrs[2].value, NULL, 10);
+	device->raid_disks = 0;
+	if (attrs[3].value)
+		str_toi(&device->raid_disks, attrs[3].value, NULL, 10);
+	debug_dev = strrchr(device->sysfs_path, '/');
+	debug_dev = debug_dev ? debug_dev + 1 : device->sysfs_path;
+	lib_log(device->ctx, LED_LOG_LEVEL_DEBUG,
+		"(%s) path: %s, level=%u, degraded=%d, disks=%d",
+		__func__, debug_dev, device->level, device->degraded,
+		device->raid_disks);
+}
+
+/**
+ */
+enum raid_level raid_device_level(struct raid_device *device)
+{
+	_raid_load_attrs(device);
+	return device->level;
+}
+
+/**
+ */
+enum raid_action raid_device_sync_action(struct raid_device *device)
+{
+	_raid_load_attrs(device);
+	return device->sync_action;
+}
+
+/**
+ */
+int raid_device_degraded(struct raid_device *device)
+{
+	_raid_load_attrs(device);
+	return device->degraded;
+}
+
+/**
+ */
+int raid_device_raid_disks(struct raid_device *device)
+{
+	_raid_load_attrs(device);
+	return device->raid_disks;
+}
+
 /**
  */
 struct raid_device *raid_device_init(const char *path, unsigned int device_num,
 				     enum device_type type, struct led_ctx *ctx)
 {
+	char state_buf[BUF_SZ_SM];
+	struct sysfs_attr attrs[] = {
+		{.name = "md/array_state", .buf = state_buf, .buf_size = sizeof(state_buf)},
+	};
 	struct raid_device *device = NULL;
 	enum raid_state state;
 	const char *debug_dev;
+	int dirfd;
 
-	state = _get_array_state(path);
+	/* Only array_state decides whether the device exists at all. */
+	dirfd = sysfs_open_dir(path);
+	sysfs_read_attrs(dirfd, attrs, ARRAY_SIZE(attrs));
+	if (dirfd >= 0)
+		close(dirfd);
+
+	state = _get_array_state(attrs[0].value);
 	if (state > RAID_STATE_INACTIVE ||
 	    (type == DEVICE_TYPE_CONTAINER && state > RAID_STATE_CLEAR)) {
 		device = calloc(1, sizeof(struct raid_device));
 		if (!device)
 			return NULL;
 
-		device->sysfs_path = strdup(path);
+		device->sysfs_path = str_pool_intern(&ctx->path_pool, path);
 		if (!device->sysfs_path) {
 			free(device);
 			return NULL;
 		}
+		device->ctx = ctx;
 		device->device_num = device_num;
-		device->sync_action = _get_sync_action(path);
 		device->array_state = state;
-		device->level = _get_level(path);
-		device->degraded = get_int(path, -1, "md/degraded");
-		device->raid_disks = get_int(path, 0, "md/raid_disks");
+		device->degraded = -1;
 		device->type = type;
 		debug_dev = strrchr(path, '/');
 		debug_dev = debug_dev ? debug_dev + 1 : path;
 		lib_log(ctx, LED_LOG_LEVEL_DEBUG,
-			"(%s) path: %s, level=%u, state=%u, degraded=%d, disks=%d, type=%u",
-			__func__, debug_dev, device->level, state, device->degraded,
-			device->raid_disks, type);
+			"(%s) path: %s, state=%u, type=%u",
+			__func__, debug_dev, state, type);
 	}
 	return device;
 }
@@ -150,11 +234,8 @@ struct raid_device *raid_device_init(const char *path, unsigned int device_num,
  */
 void raid_device_fini(struct raid_device *device)
 {
-	if (device) {
-		if (device->sysfs_path)
-			free(device->sysfs_path);
-		free(device);
-	}
+	/* sysfs_path is interned, the pool owns it. */
+	free(device);
 }
 
 /**
@@ -164,15 +245,16 @@ struct raid_device *raid_device_duplicate(struct raid_device *device)
 	struct raid_device *new_device = NULL;
 
 	if (device) {
+		/*
+		 * Duplicates outlive the scan the original belongs to, so load
+		 * the lazy attributes now; the copy always carries concrete
+		 * values instead of re-reading a possibly stopped array later.
+		 */
+		_raid_load_attrs(device);
 		new_device = malloc(sizeof(struct raid_device));
-		if (new_device) {
+		if (new_device)
+			/* Shares the interned sysfs_path with the original. */
 			*new_device = *device;
-			new_device->sysfs_path = strdup(device->sysfs_path);
-			if (!new_device->sysfs_path) {
-				free(new_device);
-				return NULL;
-			}
-		}
 	}
 	return new_device;
 }
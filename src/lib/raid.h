@@ -55,11 +55,18 @@ enum raid_action {
 };
 
 /**
+ * Only array_state is read when the device is created, it decides whether the
+ * md device is part of the model at all. The remaining attributes are fetched
+ * in one batch on first access through the raid_device_*() getters, so the
+ * common path of a healthy array costs a single sysfs read per scan. Use the
+ * getters instead of the fields unless the device is known to be loaded.
  */
 struct raid_device {
 	enum device_type type;
 	int device_num;
 	char *sysfs_path;
+	struct led_ctx *ctx;
+	int attrs_loaded;
 	int raid_disks;
 	int degraded;
 	enum raid_state array_state;
@@ -80,6 +87,28 @@ void raid_device_fini(struct raid_device *device);
  */
 struct raid_device *raid_device_duplicate(struct raid_device *device);
 
+/**
+ * @brief Returns md/level, fetching the lazily loaded attributes if needed.
+ */
+enum raid_level raid_device_level(struct raid_device *device);
+
+/**
+ * @brief Returns md/sync_action, fetching the lazily loaded attributes if
+ *        needed.
+ */
+enum raid_action raid_device_sync_action(struct raid_device *device);
+
+/**
+ * @brief Returns md/degraded, fetching the lazily loaded attributes if needed.
+ */
+int raid_device_degraded(struct raid_device *device);
+
+/**
+ * @brief Returns md/raid_disks, fetching the lazily loaded attributes if
+ *        needed.
+ */
+int raid_device_raid_disks(struct raid_device *device);
+
 /**
  */
 struct raid_device *find_raid_device(const struct list *raid_list,
@@ -3,6 +3,7 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -17,6 +18,7 @@
 #include "cntrl.h"
 #include "config.h"
 #include "enclosure.h"
+#include "hashmap.h"
 #include "list.h"
 #include "scsi.h"
 #include "ses.h"
@@ -59,8 +61,8 @@ static uint64_t get_drive_sas_addr(const char *path)
 		return ret;
 	}
 
-	snprintf(buff, size, "/sys/class/sas_end_device/%s/device/sas_device/%s",
-		 end_dev, end_dev);
+	snprintf(buff, size, "%s/%s/device/sas_device/%s",
+		 sysfs_path("/sys/class/sas_end_device"), end_dev, end_dev);
 
 	ret = get_uint64(buff, ret, "sas_address");
 
@@ -130,15 +132,20 @@ status_t scsi_ses_write_enclosure(struct enclosure_device *enclosure, int idx,
 int scsi_ses_flush_enclosure(struct enclosure_device *enclosure)
 {
 	int ret = 0;
-	int fd = enclosure_open(enclosure);
+	int fd;
+
+	if (!enclosure->ses_pages.changes)
+		return 0;
+
+	fd = enclosure_open(enclosure);
 	if (fd == -1)
 		return 1;
 
-	ret = ses_send_diag(fd, &enclosure->ses_pages);
-	close(fd);
-
-	if (ret)
+	ret = ses_send_diag(fd, &enclosure->ses_pages, enclosure->ctx);
+	if (ret) {
+		enclosure_close(enclosure);
 		return ret;
+	}
 
 	return enclosure_reload(enclosure);
 }
@@ -158,12 +165,12 @@ int scsi_ses_flush(struct block_device *device)
 	if (fd == -1)
 		return 1;
 
-	ret = ses_send_diag(fd, &device->enclosure->ses_pages);
-
-	close(fd);
-
-	if (ret)
+	ret = ses_send_diag(fd, &device->enclosure->ses_pages,
+			    device->enclosure->ctx);
+	if (ret) {
+		enclosure_close(device->enclosure);
 		return ret;
+	}
 
 	return enclosure_reload(device->enclosure);
 }
@@ -186,14 +193,39 @@ char *scsi_get_host_path(const char *path, const char *ctrl_path)
 }
 
 
-struct block_device *locate_block_by_sas_addr(struct led_ctx *ctx, uint64_t sas_address)
+/**
+ * @brief Builds the SAS address index of the block device model.
+ *
+ * This is internal function of scsi module. Reads the sas_address attribute
+ * of every block device once and fills the context map keyed by the address
+ * printed as hex, so slot-to-device matching of a whole enclosure pass costs
+ * one walk instead of one per slot. The index stays valid until the block
+ * model changes, see the sas_addr_map member in sysfs.h.
+ */
+static void _sas_map_build(struct led_ctx *ctx)
 {
 	struct block_device *block_device;
-	list_for_each(sysfs_get_block_devices(ctx), block_device) {
-		uint64_t tmp = get_drive_sas_addr(block_device->sysfs_path);
-		if (tmp != 0 && tmp == sas_address) {
-			return block_device;
-		}
+	char key[17];
+
+	vector_for_each(sysfs_get_block_devices(ctx), block_device) {
+		uint64_t addr = get_drive_sas_addr(block_device->sysfs_path);
+
+		if (addr == 0)
+			continue;
+		snprintf(key, sizeof(key), "%016" PRIx64, addr);
+		hash_map_insert(&ctx->sys.sas_addr_map, key, block_device);
 	}
-	return NULL;
+	ctx->sys.sas_addr_map_valid = 1;
+}
+
+struct block_device *locate_block_by_sas_addr(struct led_ctx *ctx, uint64_t sas_address)
+{
+	char key[17];
+
+	if (sas_address == 0)
+		return NULL;
+	if (!ctx->sys.sas_addr_map_valid)
+		_sas_map_build(ctx);
+	snprintf(key, sizeof(key), "%016" PRIx64, sas_address);
+	return hash_map_find(&ctx->sys.sas_addr_map, key);
 }
@@ -2,11 +2,16 @@
 // Copyright (C) 2022 Intel Corporation.
 
 #include <dirent.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <poll.h>
+#include <scsi/sg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 
 #if _HAVE_DMALLOC_H
@@ -150,168 +155,396 @@ static void print_page10(struct ses_pages *sp)
 	return;
 }
 
-int ses_load_pages(int fd, struct ses_pages *sp, struct led_ctx *ctx)
+/*
+ * Asynchronous SES command engine. RECEIVE/SEND DIAGNOSTIC commands are
+ * submitted to the sg driver with write() and reaped with poll()/read(), so
+ * commands addressed to different enclosures (or different pages of one
+ * enclosure) are serviced by the hardware concurrently. Every command carries
+ * a kernel-enforced timeout; when completions stop arriving the engine
+ * abandons what is left and a hung expander degrades to a warning instead of
+ * stalling the whole scan.
+ */
+
+/* Per-command timeout, milliseconds. */
+#define SES_IO_TIMEOUT_MS	10000
+/* Extra poll() time given to in-flight commands before they are abandoned. */
+#define SES_IO_GRACE_MS		2000
+/* Submission attempts per command, matches get_ses_page() retries. */
+#define SES_IO_RETRIES		3
+
+#define SCSI_RECEIVE_DIAG	0x1c
+#define SCSI_SEND_DIAG		0x1d
+
+struct ses_io_cmd {
+	int fd;
+	int pg_code;		/* page to fetch, 0 submits SEND DIAGNOSTIC */
+	struct ses_page *page;
+	int retries;
+	int done;
+	int result;
+	unsigned char cdb[6];
+	unsigned char sense[32];
+	sg_io_hdr_t hdr;
+};
+
+static uint64_t _now_ms(void)
 {
-	int ret;
-
-	/* Read configuration. */
-	ret = get_ses_page(fd, &sp->page1, ENCL_CFG_DIAG_STATUS);
-	if (ret)
-		return ret;
-
-	ret = process_page1(sp, ctx);
-	if (ret)
-		return ret;
-
-	/* Get Enclosure Status */
-	ret = get_ses_page(fd, &sp->page2, ENCL_CTRL_DIAG_STATUS);
-	if (ret)
-		return ret;
-
-	/* Additional Element Status */
-	ret = get_ses_page(fd, &sp->page10, ENCL_ADDITIONAL_EL_STATUS);
-	if (ret)
-		return ret;
-
-	if (debug)
-		print_page10(sp);
+	struct timespec ts;
 
-	return ret;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-static enum led_ibpi_pattern ibpi_to_ses(enum led_ibpi_pattern ibpi)
+static int _ses_io_submit(struct ses_io_cmd *cmd)
 {
-	switch (ibpi) {
-	case LED_IBPI_PATTERN_UNKNOWN:
-	case LED_IBPI_PATTERN_ONESHOT_NORMAL:
-	case LED_IBPI_PATTERN_NORMAL:
-		return LED_SES_REQ_OK;
-	case LED_IBPI_PATTERN_FAILED_ARRAY:
-		return LED_SES_REQ_IFA;
-	case LED_IBPI_PATTERN_DEGRADED:
-		return LED_SES_REQ_ICA;
-	case LED_IBPI_PATTERN_REBUILD:
-		return LED_SES_REQ_REBUILD;
-	case LED_IBPI_PATTERN_FAILED_DRIVE:
-		return LED_SES_REQ_FAULT;
-	case LED_IBPI_PATTERN_LOCATE:
-		return LED_SES_REQ_IDENT;
-	case LED_IBPI_PATTERN_HOTSPARE:
-		return LED_SES_REQ_HOTSPARE;
-	case LED_IBPI_PATTERN_PFA:
-		return LED_SES_REQ_PRDFAIL;
-	case LED_IBPI_PATTERN_LOCATE_AND_FAIL:
-		return LED_SES_REQ_IDENT_AND_FAULT;
-	default:
-		return ibpi;
+	sg_io_hdr_t *hdr = &cmd->hdr;
+	int queuing = 1;
+
+	/* More than one command may be in flight on a descriptor. */
+	ioctl(cmd->fd, SG_SET_COMMAND_Q, &queuing);
+
+	memset(hdr, 0, sizeof(*hdr));
+	memset(cmd->cdb, 0, sizeof(cmd->cdb));
+	if (cmd->pg_code) {
+		cmd->cdb[0] = SCSI_RECEIVE_DIAG;
+		cmd->cdb[1] = 0x01;	/* page code valid */
+		cmd->cdb[2] = cmd->pg_code;
+		cmd->cdb[3] = sizeof(cmd->page->buf) >> 8;
+		cmd->cdb[4] = sizeof(cmd->page->buf) & 0xff;
+		hdr->dxfer_direction = SG_DXFER_FROM_DEV;
+		hdr->dxfer_len = sizeof(cmd->page->buf);
+	} else {
+		cmd->cdb[0] = SCSI_SEND_DIAG;
+		cmd->cdb[1] = 0x10;	/* page format */
+		cmd->cdb[3] = cmd->page->len >> 8;
+		cmd->cdb[4] = cmd->page->len & 0xff;
+		hdr->dxfer_direction = SG_DXFER_TO_DEV;
+		hdr->dxfer_len = cmd->page->len;
 	}
+	hdr->interface_id = 'S';
+	hdr->cmd_len = sizeof(cmd->cdb);
+	hdr->cmdp = cmd->cdb;
+	hdr->dxferp = cmd->page->buf;
+	hdr->mx_sb_len = sizeof(cmd->sense);
+	hdr->sbp = cmd->sense;
+	hdr->timeout = SES_IO_TIMEOUT_MS;
+	hdr->usr_ptr = cmd;
+
+	return write(cmd->fd, hdr, sizeof(*hdr)) != sizeof(*hdr);
 }
 
-static inline void _set_prdfail(unsigned char *u)
+/*
+ * Runs a command synchronously through the sg_ll helpers. Used when
+ * asynchronous submission is not available for a descriptor.
+ */
+static void _ses_io_fallback(struct ses_io_cmd *cmd)
 {
-	u[0] |= (1 << 6);
+	if (cmd->pg_code)
+		cmd->result = get_ses_page(cmd->fd, cmd->page, cmd->pg_code);
+	else
+		cmd->result = sg_ll_send_diag(cmd->fd, 0, 1, 0, 0, 0, 0,
+					      cmd->page->buf, cmd->page->len,
+					      0, debug);
+	cmd->done = 1;
 }
 
-static inline void _set_abrt(unsigned char *u)
+static void _ses_io_reap(struct ses_io_cmd *cmds, int count, int fd)
 {
-	u[1] |= (1 << 0);
-}
+	sg_io_hdr_t hdr;
+	struct ses_io_cmd *cmd = NULL;
+	int i;
 
-static inline void _set_rebuild(unsigned char *u)
-{
-	u[1] |= (1 << 1);
-}
+	memset(&hdr, 0, sizeof(hdr));
+	if (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+		return;
 
-static inline void _set_ifa(unsigned char *u)
-{
-	u[1] |= (1 << 2);
+	for (i = 0; i < count; i++) {
+		if (hdr.usr_ptr == &cmds[i]) {
+			cmd = &cmds[i];
+			break;
+		}
+	}
+	if (!cmd || cmd->done)
+		return;
+
+	if ((hdr.info & SG_INFO_OK_MASK) != SG_INFO_OK) {
+		if (--cmd->retries > 0 && !_ses_io_submit(cmd))
+			return;
+		cmd->result = 1;
+	} else {
+		if (cmd->pg_code)
+			cmd->page->len = (cmd->page->buf[2] << 8) +
+					 cmd->page->buf[3] + 4;
+		cmd->result = 0;
+	}
+	cmd->done = 1;
 }
 
-static inline void _set_ica(unsigned char *u)
+static int ses_io_run(struct ses_io_cmd *cmds, int count, struct led_ctx *ctx)
 {
-	u[1] |= (1 << 3);
-}
+	uint64_t deadline = _now_ms() + SES_IO_TIMEOUT_MS + SES_IO_GRACE_MS;
+	struct pollfd *pfd;
+	int i, failed = 0;
 
-static inline void _set_cons_check(unsigned char *u)
-{
-	u[1] |= (1 << 4);
-}
+	pfd = calloc(count, sizeof(*pfd));
 
-static inline void _set_hspare(unsigned char *u)
-{
-	u[1] |= (1 << 5);
-}
+	for (i = 0; i < count; i++) {
+		cmds[i].retries = SES_IO_RETRIES;
+		if (!pfd || _ses_io_submit(&cmds[i]))
+			_ses_io_fallback(&cmds[i]);
+	}
 
-static inline void _set_rsvd_dev(unsigned char *u)
-{
-	u[1] |= (1 << 6);
-}
+	while (pfd) {
+		uint64_t now = _now_ms();
+		int nfds = 0, pending = 0, j, rc;
+
+		for (i = 0; i < count; i++) {
+			if (cmds[i].done)
+				continue;
+			pending++;
+			for (j = 0; j < nfds; j++)
+				if (pfd[j].fd == cmds[i].fd)
+					break;
+			if (j == nfds) {
+				pfd[nfds].fd = cmds[i].fd;
+				pfd[nfds].events = POLLIN;
+				pfd[nfds].revents = 0;
+				nfds++;
+			}
+		}
+		if (!pending)
+			break;
 
-static inline void _set_ok(unsigned char *u)
-{
-	u[1] |= (1 << 7);
-}
+		rc = now < deadline ? poll(pfd, nfds, (int)(deadline - now)) : 0;
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0) {
+			for (i = 0; i < count; i++) {
+				if (cmds[i].done)
+					continue;
+				cmds[i].result = 1;
+				cmds[i].done = 1;
+				lib_log(ctx, LED_LOG_LEVEL_WARNING,
+					"SES: command timed out, abandoning enclosure I/O\n");
+			}
+			break;
+		}
+		for (j = 0; j < nfds; j++)
+			if (pfd[j].revents & POLLIN)
+				_ses_io_reap(cmds, count, pfd[j].fd);
+	}
+	free(pfd);
 
-static inline void _set_ident(unsigned char *u)
-{
-	u[2] |= (1 << 1);
+	for (i = 0; i < count; i++)
+		failed += cmds[i].result != 0;
+	return failed;
 }
 
-static inline void _clr_ident(unsigned char *u)
+/*
+ * Builds the command set needed to refresh the given pages. Configuration
+ * pages are included only when the cached copies are stale, see
+ * ses_load_pages().
+ */
+static int _ses_load_build(struct ses_load_req *req, struct ses_io_cmd *cmds,
+			   struct led_ctx *ctx)
 {
-	u[2] &= ~(1 << 1);
+	struct ses_pages *sp = req->sp;
+	int refetch = sp->config_gen != ctx->ses_cfg_gen;
+	int n = 0;
+
+	memset(cmds, 0, (refetch ? 2 : 1) * sizeof(*cmds));
+	if (refetch) {
+		/* Read configuration. */
+		cmds[n].fd = req->fd;
+		cmds[n].pg_code = ENCL_CFG_DIAG_STATUS;
+		cmds[n].page = &sp->page1;
+		n++;
+	}
+	/* Get Enclosure Status */
+	cmds[n].fd = req->fd;
+	cmds[n].pg_code = ENCL_CTRL_DIAG_STATUS;
+	cmds[n].page = &sp->page2;
+	n++;
+	return n;
 }
 
-static inline void _set_rm(unsigned char *u)
+static void _ses_load_parse(struct ses_load_req *req, struct ses_io_cmd *cmds,
+			    int count, struct led_ctx *ctx)
 {
-	u[2] |= (1 << 2);
-}
+	struct ses_pages *sp = req->sp;
+	int i;
 
-static inline void _set_ins(unsigned char *u)
-{
-	u[2] |= (1 << 3);
-}
+	for (i = 0; i < count; i++) {
+		if (cmds[i].result) {
+			req->result = cmds[i].result;
+			return;
+		}
+	}
 
-static inline void _set_miss(unsigned char *u)
-{
-	u[2] |= (1 << 4);
-}
+	if (count == 2) {
+		req->result = process_page1(sp, ctx);
+		if (req->result)
+			return;
 
-static inline void _set_dnr(unsigned char *u)
-{
-	u[2] |= (1 << 6);
+		sp->config_gen = ctx->ses_cfg_gen;
+	}
+
+	/* Fresh pages carry no unsent control element edits. */
+	sp->changes = 0;
+	req->result = 0;
 }
 
-static inline void _set_actv(unsigned char *u)
+int ses_load_pages_batch(struct ses_load_req *reqs, int count, struct led_ctx *ctx)
 {
-	u[2] |= (1 << 7);
+	struct ses_io_cmd stack_cmds[2];
+	struct ses_io_cmd *cmds;
+	int i, n, failed = 0;
+
+	cmds = calloc(count * 2, sizeof(*cmds));
+	if (!cmds) {
+		/* Degrade to loading one enclosure at a time. */
+		for (i = 0; i < count; i++) {
+			if (reqs[i].fd < 0) {
+				reqs[i].result = 1;
+				continue;
+			}
+			n = _ses_load_build(&reqs[i], stack_cmds, ctx);
+			ses_io_run(stack_cmds, n, ctx);
+			_ses_load_parse(&reqs[i], stack_cmds, n, ctx);
+		}
+	} else {
+		n = 0;
+		for (i = 0; i < count; i++) {
+			if (reqs[i].fd < 0) {
+				reqs[i].result = 1;
+				continue;
+			}
+			n += _ses_load_build(&reqs[i], cmds + n, ctx);
+		}
+
+		ses_io_run(cmds, n, ctx);
+
+		n = 0;
+		for (i = 0; i < count; i++) {
+			int c;
+
+			if (reqs[i].fd < 0)
+				continue;
+			c = reqs[i].sp->config_gen != ctx->ses_cfg_gen ? 2 : 1;
+			_ses_load_parse(&reqs[i], cmds + n, c, ctx);
+			n += c;
+		}
+		free(cmds);
+	}
+
+	for (i = 0; i < count; i++)
+		failed += reqs[i].result != 0;
+	return failed;
 }
 
-static inline void _set_enbb(unsigned char *u)
+int ses_load_pages(int fd, struct ses_pages *sp, struct led_ctx *ctx)
 {
-	u[3] |= (1 << 2);
+	struct ses_load_req req = { .fd = fd, .sp = sp, .result = 0 };
+
+	/*
+	 * Page 1 describes the enclosure composition, which cannot change
+	 * without a matching sysfs topology change. It is re-fetched only when
+	 * the cached copy belongs to an older generation and routinely just
+	 * the status page 2 is re-read. Page 10 is not touched here at all,
+	 * see ses_load_page10().
+	 */
+	ses_load_pages_batch(&req, 1, ctx);
+	return req.result;
 }
 
-static inline void _set_enba(unsigned char *u)
+int ses_load_page10(int fd, struct ses_pages *sp, struct led_ctx *ctx)
 {
-	u[3] |= (1 << 3);
+	struct ses_io_cmd cmd;
+
+	if (sp->page10_gen == ctx->ses_cfg_gen)
+		return 0;
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.fd = fd;
+	cmd.pg_code = ENCL_ADDITIONAL_EL_STATUS;
+	cmd.page = &sp->page10;
+	if (ses_io_run(&cmd, 1, ctx))
+		return 1;
+
+	if (debug)
+		print_page10(sp);
+
+	sp->page10_gen = ctx->ses_cfg_gen;
+	return 0;
 }
 
-static inline void _set_off(unsigned char *u)
+static enum led_ibpi_pattern ibpi_to_ses(enum led_ibpi_pattern ibpi)
 {
-	u[3] |= (1 << 4);
+	switch (ibpi) {
+	case LED_IBPI_PATTERN_UNKNOWN:
+	case LED_IBPI_PATTERN_ONESHOT_NORMAL:
+	case LED_IBPI_PATTERN_NORMAL:
+		return LED_SES_REQ_OK;
+	case LED_IBPI_PATTERN_FAILED_ARRAY:
+		return LED_SES_REQ_IFA;
+	case LED_IBPI_PATTERN_DEGRADED:
+		return LED_SES_REQ_ICA;
+	case LED_IBPI_PATTERN_REBUILD:
+		return LED_SES_REQ_REBUILD;
+	case LED_IBPI_PATTERN_FAILED_DRIVE:
+		return LED_SES_REQ_FAULT;
+	case LED_IBPI_PATTERN_LOCATE:
+		return LED_SES_REQ_IDENT;
+	case LED_IBPI_PATTERN_HOTSPARE:
+		return LED_SES_REQ_HOTSPARE;
+	case LED_IBPI_PATTERN_PFA:
+		return LED_SES_REQ_PRDFAIL;
+	case LED_IBPI_PATTERN_LOCATE_AND_FAIL:
+		return LED_SES_REQ_IDENT_AND_FAULT;
+	default:
+		return ibpi;
+	}
 }
 
-static inline void _set_fault(unsigned char *u)
+/*
+ * Control element templates indexed by SES request. The request-to-element
+ * mapping is fixed, so the 4 control bytes are formed at compile time and
+ * per-drive message construction is a plain structure store - relevant when
+ * many slots are batched into one enclosure flush. Byte and bit positions
+ * follow the SES-2 array device slot control element.
+ */
+static const struct ses_slot_ctrl_elem _ses_ctrl_msg[] = {
+	[LED_SES_REQ_PRDFAIL]		= { .b = {0x40, 0x00, 0x00, 0x00} },
+	[LED_SES_REQ_ABORT]		= { .b = {0x00, 0x01, 0x00, 0x00} },
+	[LED_SES_REQ_REBUILD]		= { .b = {0x00, 0x02, 0x00, 0x00} },
+	[LED_SES_REQ_IFA]		= { .b = {0x00, 0x04, 0x00, 0x00} },
+	[LED_SES_REQ_ICA]		= { .b = {0x00, 0x08, 0x00, 0x00} },
+	[LED_SES_REQ_CONS_CHECK]	= { .b = {0x00, 0x10, 0x00, 0x00} },
+	[LED_SES_REQ_HOTSPARE]		= { .b = {0x00, 0x20, 0x00, 0x00} },
+	[LED_SES_REQ_RSVD_DEV]		= { .b = {0x00, 0x40, 0x00, 0x00} },
+	[LED_SES_REQ_OK]		= { .b = {0x00, 0x80, 0x00, 0x00} },
+	[LED_SES_REQ_IDENT]		= { .b = {0x00, 0x00, 0x02, 0x00} },
+	[LED_SES_REQ_RM]		= { .b = {0x00, 0x00, 0x04, 0x00} },
+	[LED_SES_REQ_INS]		= { .b = {0x00, 0x00, 0x08, 0x00} },
+	[LED_SES_REQ_MISSING]		= { .b = {0x00, 0x00, 0x10, 0x00} },
+	[LED_SES_REQ_DNR]		= { .b = {0x00, 0x00, 0x40, 0x00} },
+	[LED_SES_REQ_ACTIVE]		= { .b = {0x00, 0x00, 0x80, 0x00} },
+	[LED_SES_REQ_EN_BB]		= { .b = {0x00, 0x00, 0x00, 0x04} },
+	[LED_SES_REQ_EN_BA]		= { .b = {0x00, 0x00, 0x00, 0x08} },
+	[LED_SES_REQ_DEV_OFF]		= { .b = {0x00, 0x00, 0x00, 0x10} },
+	[LED_SES_REQ_FAULT]		= { .b = {0x00, 0x00, 0x00, 0x20} },
+	[LED_SES_REQ_IDENT_AND_FAULT]	= { .b = {0x00, 0x00, 0x02, 0x20} },
+};
+
+static inline void _clr_ident(unsigned char *u)
 {
-	u[3] |= (1 << 5);
+	u[2] &= ~(1 << 1);
 }
 
 static int ses_set_message(enum led_ibpi_pattern ibpi, struct ses_slot_ctrl_elem *el)
 {
-	struct ses_slot_ctrl_elem msg;
+	enum led_ibpi_pattern req;
 
-	memset(&msg, 0, sizeof(msg));
 	if (ibpi == LED_IBPI_PATTERN_LOCATE_OFF) {
 		/*
 		 * For locate_off we don't set a new state, just clear the
@@ -325,74 +558,11 @@ static int ses_set_message(enum led_ibpi_pattern ibpi, struct ses_slot_ctrl_elem
 		return 0;
 	}
 
-	switch (ibpi_to_ses(ibpi)) {
-	case LED_SES_REQ_ABORT:
-		_set_abrt(msg.b);
-		break;
-	case LED_SES_REQ_REBUILD:
-		_set_rebuild(msg.b);
-		break;
-	case LED_SES_REQ_IFA:
-		_set_ifa(msg.b);
-		break;
-	case LED_SES_REQ_ICA:
-		_set_ica(msg.b);
-		break;
-	case LED_SES_REQ_CONS_CHECK:
-		_set_cons_check(msg.b);
-		break;
-	case LED_SES_REQ_HOTSPARE:
-		_set_hspare(msg.b);
-		break;
-	case LED_SES_REQ_RSVD_DEV:
-		_set_rsvd_dev(msg.b);
-		break;
-	case LED_SES_REQ_OK:
-		_set_ok(msg.b);
-		break;
-	case LED_SES_REQ_IDENT:
-		_set_ident(msg.b);
-		break;
-	case LED_SES_REQ_RM:
-		_set_rm(msg.b);
-		break;
-	case LED_SES_REQ_INS:
-		_set_ins(msg.b);
-		break;
-	case LED_SES_REQ_MISSING:
-		_set_miss(msg.b);
-		break;
-	case LED_SES_REQ_DNR:
-		_set_dnr(msg.b);
-		break;
-	case LED_SES_REQ_ACTIVE:
-		_set_actv(msg.b);
-		break;
-	case LED_SES_REQ_EN_BB:
-		_set_enbb(msg.b);
-		break;
-	case LED_SES_REQ_EN_BA:
-		_set_enba(msg.b);
-		break;
-	case LED_SES_REQ_DEV_OFF:
-		_set_off(msg.b);
-		break;
-	case LED_SES_REQ_FAULT:
-		_set_fault(msg.b);
-		break;
-	case LED_SES_REQ_PRDFAIL:
-		_set_prdfail(msg.b);
-		break;
-	case LED_SES_REQ_IDENT_AND_FAULT:
-		_set_ident(msg.b);
-		_set_fault(msg.b);
-		break;
-	default:
+	req = ibpi_to_ses(ibpi);
+	if (req < LED_SES_REQ_ABORT || req > LED_SES_REQ_IDENT_AND_FAULT)
 		return 1;
-	}
-
-	*el = msg;
 
+	*el = _ses_ctrl_msg[req];
 	return 0;
 }
 
@@ -449,10 +619,27 @@ status_t ses_write_msg(enum led_ibpi_pattern ibpi, struct ses_pages *sp, int idx
 	return STATUS_FILE_WRITE_ERROR;
 }
 
-int ses_send_diag(int fd, struct ses_pages *sp)
+int ses_send_diag(int fd, struct ses_pages *sp, struct led_ctx *ctx)
 {
-	return sg_ll_send_diag(fd, 0, 1, 0, 0, 0, 0, sp->page2.buf,
-			       sp->page2.len, 0, debug);
+	struct ses_io_cmd cmd;
+	int ret;
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.fd = fd;
+	cmd.page = &sp->page2;
+
+	ret = ses_io_run(&cmd, 1, ctx);
+
+	/*
+	 * The single SEND DIAGNOSTIC above delivers control elements for every
+	 * slot of the enclosure at once. Clear the dirty counter so flushing
+	 * the remaining devices behind the same enclosure becomes a no-op
+	 * instead of repeating the command per device.
+	 */
+	if (ret == 0)
+		sp->changes = 0;
+
+	return ret;
 }
 
 static void get_led_status(struct ses_pages *sp, int idx, enum led_ibpi_pattern *led_status)
@@ -532,3 +719,14 @@ int ses_get_slots(struct ses_pages *sp, struct ses_slot **out_slots, int *out_sl
 
 	return 1;
 }
+
+void ses_refresh_slots(struct ses_pages *sp, struct ses_slot *slots, int slots_count)
+{
+	int i;
+
+	for (i = 0; i < slots_count; i++) {
+		if (slots[i].index == -1)
+			continue;
+		get_led_status(sp, slots[i].index, &slots[i].ibpi_status);
+	}
+}
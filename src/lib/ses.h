@@ -37,6 +37,21 @@ struct ses_pages {
 	const struct type_descriptor_header *page1_types;
 	int page1_types_len;
 	int changes;
+	/**
+	 * Generation of the cached configuration page 1. The page describes
+	 * the enclosure composition and only changes together with the sysfs
+	 * topology, so ses_load_pages() re-fetches it just once per generation
+	 * and routinely re-reads only the status page 2.
+	 * Zero means no configuration page is cached.
+	 */
+	unsigned int config_gen;
+	/**
+	 * Generation of the cached additional element status page 10. The
+	 * page is fetched on demand by ses_load_page10() only when the
+	 * slot-to-SAS-address mapping has to be rebuilt, see
+	 * enclosure_reload_finish(). Zero means no page is cached.
+	 */
+	unsigned int page10_gen;
 };
 
 struct ses_slot_ctrl_elem {
@@ -57,9 +72,69 @@ struct ses_slot {
 	enum led_ibpi_pattern ibpi_status;
 };
 
+/**
+ * @brief Single request of a batched page load, see ses_load_pages_batch().
+ */
+struct ses_load_req {
+	/**
+	 * Open descriptor of the enclosure sg node. A negative value fails
+	 * the request without submitting any command.
+	 */
+	int fd;
+
+	/**
+	 * Pages of the enclosure the descriptor belongs to.
+	 */
+	struct ses_pages *sp;
+
+	/**
+	 * Completion status of the request, 0 on success.
+	 */
+	int result;
+};
+
 int ses_load_pages(int fd, struct ses_pages *sp, struct led_ctx *ctx);
+
+/**
+ * @brief Fetches the additional element status page on demand.
+ *
+ * Page 10 is large and needed only to rebuild the slot-to-SAS-address
+ * mapping, so it is not part of the routine page load. A cached copy of the
+ * current configuration generation is reused without any enclosure I/O.
+ *
+ * @param[in]      fd             Open descriptor of the enclosure sg node.
+ * @param[in]      sp             Pages of the enclosure.
+ * @param[in]      ctx            Library context.
+ *
+ * @return 0 on success, 1 on failure.
+ */
+int ses_load_page10(int fd, struct ses_pages *sp, struct led_ctx *ctx);
+
+/**
+ * @brief Loads SES pages of many enclosures concurrently.
+ *
+ * Commands needed to refresh the pages of all given requests are submitted at
+ * once and reaped as they complete, so enclosures are probed in parallel
+ * instead of strictly one after another. Commands carry individual timeouts;
+ * an unresponsive enclosure fails its own request with a warning and does not
+ * block the remaining ones.
+ *
+ * @param[in]      reqs           Array of load requests.
+ * @param[in]      count          Number of elements in the array.
+ * @param[in]      ctx            Library context.
+ *
+ * @return Number of failed requests, 0 if all succeeded.
+ */
+int ses_load_pages_batch(struct ses_load_req *reqs, int count, struct led_ctx *ctx);
+
 status_t ses_write_msg(enum led_ibpi_pattern ibpi, struct ses_pages *sp, int idx);
-int ses_send_diag(int fd, struct ses_pages *sp);
+int ses_send_diag(int fd, struct ses_pages *sp, struct led_ctx *ctx);
 int ses_get_slots(struct ses_pages *sp, struct ses_slot **out_slots, int *out_slots_count);
 
+/**
+ * @brief Refreshes the LED statuses of an already built slots array from the
+ *        status page, without re-parsing the configuration pages.
+ */
+void ses_refresh_slots(struct ses_pages *sp, struct ses_slot *slots, int slots_count);
+
 #endif
@@ -9,17 +9,84 @@
 #endif
 
 #include "enclosure.h"
+#include "hashmap.h"
 #include "npem.h"
 #include "slot.h"
 #include "sysfs.h"
 #include "pci_slot.h"
 
+/**
+ * @brief Composes a slot index key.
+ *
+ * This is internal function of slot module. The indexes are shared between
+ * controller types, so the key combines the type with the base name of the
+ * slot id or device node the lookups compare.
+ */
+static const char *_slot_key(char *buf, size_t buf_size,
+			     enum led_cntrl_type cntrl_type, char *name)
+{
+	snprintf(buf, buf_size, "%d:%s", cntrl_type, basename(name));
+	return buf;
+}
+
+/*
+ * Rebuilds the slot lookup indexes. See slot.h for details.
+ */
+void slot_index_rebuild(struct led_ctx *ctx)
+{
+	struct slot_property *slot;
+	char key[PATH_MAX];
+
+	hash_map_clear(&ctx->sys.slot_id_map);
+	hash_map_clear(&ctx->sys.slot_devnode_map);
+
+	vector_for_each(&ctx->sys.slots_list, slot) {
+		hash_map_insert(&ctx->sys.slot_id_map,
+				_slot_key(key, sizeof(key),
+					  slot->c->cntrl_type, slot->slot_id),
+				slot);
+		if (!slot->bl_device || slot->bl_device->devnode[0] == 0)
+			continue;
+		hash_map_insert(&ctx->sys.slot_devnode_map,
+				_slot_key(key, sizeof(key),
+					  slot->c->cntrl_type,
+					  slot->bl_device->devnode),
+				slot);
+	}
+}
+
+/*
+ * Drops the device node index entry of a slot. See slot.h for details.
+ */
+void slot_index_unbind(struct led_ctx *ctx, struct slot_property *slot)
+{
+	char key[PATH_MAX];
+
+	if (!slot->bl_device || slot->bl_device->devnode[0] == 0)
+		return;
+	_slot_key(key, sizeof(key), slot->c->cntrl_type,
+		  slot->bl_device->devnode);
+	if (hash_map_find(&ctx->sys.slot_devnode_map, key) == slot)
+		hash_map_remove(&ctx->sys.slot_devnode_map, key);
+}
+
 struct slot_property *find_slot_by_device_name(struct led_ctx *ctx, char *device_name,
 					       enum led_cntrl_type cntrl_type)
 {
 	struct slot_property *slot;
+	char key[PATH_MAX];
 
-	list_for_each(sysfs_get_slots(ctx), slot) {
+	slot = hash_map_find(&ctx->sys.slot_devnode_map,
+			     _slot_key(key, sizeof(key), cntrl_type,
+				       device_name));
+	if (slot)
+		return slot;
+
+	/*
+	 * The indexes cover slots built by the scan; walk the model for
+	 * contexts populated elsewhere, e.g. from the shared memory state.
+	 */
+	vector_for_each(sysfs_get_slots(ctx), slot) {
 		if (slot->c->cntrl_type != cntrl_type)
 			continue;
 
@@ -37,8 +104,15 @@ struct slot_property *find_slot_by_slot_path(struct led_ctx *ctx, char *slot_pat
 					     enum led_cntrl_type cntrl_type)
 {
 	struct slot_property *slot;
+	char key[PATH_MAX];
+
+	slot = hash_map_find(&ctx->sys.slot_id_map,
+			     _slot_key(key, sizeof(key), cntrl_type,
+				       slot_path));
+	if (slot)
+		return slot;
 
-	list_for_each(sysfs_get_slots(ctx), slot) {
+	vector_for_each(sysfs_get_slots(ctx), slot) {
 		if (slot->c->cntrl_type != cntrl_type)
 			continue;
 		if (strncmp(basename(slot->slot_id), basename(slot_path), PATH_MAX) == 0)
@@ -15,6 +15,7 @@
 
 /* Forward decl. */
 struct slot_property;
+struct state_shm_slot;
 
 
 /**
@@ -67,6 +68,7 @@ struct slot_property {
 		struct pci_slot *pci;
 		struct cntrl_device *cntrl;
 		struct ses_slot_info ses;
+		struct state_shm_slot *shm;
 	} slot_spec;
 
 	/**
@@ -99,6 +101,29 @@ struct slot_property *find_slot_by_slot_path(struct led_ctx *ctx, char *slot_pat
 struct slot_property *find_slot_by_device_name(struct led_ctx *ctx, char *device_name,
 					       enum led_cntrl_type cntrl_type);
 
+/**
+ * @brief Rebuilds the slot lookup indexes of the context.
+ *
+ * Fills the maps backing find_slot_by_slot_path() and
+ * find_slot_by_device_name() from the current slot model, keyed by
+ * controller type and slot id respectively attached device node. Called
+ * after the slot model was (re)built.
+ *
+ * @param[in]        ctx              The library context.
+ */
+void slot_index_rebuild(struct led_ctx *ctx);
+
+/**
+ * @brief Drops the device node index entry of a slot.
+ *
+ * Called before the block device of the slot is unbound, so the device name
+ * lookup cannot return a slot whose device is gone.
+ *
+ * @param[in]        ctx              The library context.
+ * @param[in]        slot             Slot losing its block device.
+ */
+void slot_index_unbind(struct led_ctx *ctx, struct slot_property *slot);
+
 /**
  * @brief Set the slot pattern for the given slot
  *
@@ -6,6 +6,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <linux/bsg.h>
+#include <pthread.h>
 #include <scsi/sg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -475,33 +476,181 @@ status_t scsi_smp_fill_buffer(struct block_device *device, enum led_ibpi_pattern
 	return STATUS_SUCCESS;
 }
 
+/* Upper bound of WRITE GPIO frames transmitted concurrently. */
+#define SMP_MAX_FLUSH_JOBS	16
+
+/**
+ * One WRITE GPIO frame of a flush pass. Jobs for different hosts run on
+ * separate threads, each writing through the persistent descriptor of its
+ * host.
+ */
+struct smp_host_job {
+	struct _host_type *host;
+	int reg_type;
+	int reg_index;
+	int reg_count;
+	void *data;
+	size_t len;
+	pthread_t thread;
+	int result;
+};
+
+/**
+ * @brief Transmits one WRITE GPIO frame through the host descriptor.
+ *
+ * This is internal function of smp module. The function reuses the bsg
+ * descriptor cached in the host structure, opening it on first use. A
+ * descriptor can go stale when the fabric is reconfigured, so after a failed
+ * transmission it is reopened once and the frame is retransmitted.
+ *
+ * @param[in]      job            Frame to transmit and its target host.
+ *
+ * @return GPIO_STATUS_OK if successful, otherwise transmission status.
+ */
+static int _host_write_gpio(struct smp_host_job *job)
+{
+	struct _host_type *host = job->host;
+	struct smp_write_request_frame_header header;
+	int status;
+
+	memset(&header, 0, sizeof(header));
+	header.frame_type = SMP_FRAME_TYPE_REQ;
+	header.function = SMP_FUNC_GPIO_WRITE;
+	header.register_type = job->reg_type;
+	header.register_index = job->reg_index;
+	header.register_count = job->reg_count;
+
+	if (host->smp_fd < 0)
+		host->smp_fd = _open_smp_device(host->bsg_path);
+	if (host->smp_fd < 0)
+		return GPIO_STATUS_FAILURE;
+
+	status = _start_smp_write_gpio(host->smp_fd, &header, job->data,
+				       job->len);
+	if (status == GPIO_STATUS_OK)
+		return status;
+
+	/* The descriptor may be stale, reopen once and retransmit. */
+	_close_smp_device(host->smp_fd);
+	host->smp_fd = _open_smp_device(host->bsg_path);
+	if (host->smp_fd < 0)
+		return GPIO_STATUS_FAILURE;
+	return _start_smp_write_gpio(host->smp_fd, &header, job->data,
+				     job->len);
+}
+
+static void *_smp_flush_thread(void *data)
+{
+	struct smp_host_job *job = data;
+
+	job->result = _host_write_gpio(job);
+	return NULL;
+}
+
+/**
+ * @brief Transmits collected frames, concurrently when there is more than one.
+ *
+ * This is internal function of smp module. A single frame is written on the
+ * calling thread. Frames for different hosts target independent bsg nodes,
+ * so they are handed to one thread each and the function waits for all of
+ * them. Jobs whose thread cannot be started fall back to the calling thread.
+ *
+ * @param[in]      jobs           Frames to transmit.
+ * @param[in]      count          Number of frames.
+ *
+ * @return GPIO_STATUS_OK if all frames were delivered, otherwise the status
+ *         of a failed frame.
+ */
+static int _smp_run_jobs(struct smp_host_job *jobs, int count)
+{
+	int i, started = 0, status = GPIO_STATUS_OK;
+
+	if (count == 1) {
+		_smp_flush_thread(&jobs[0]);
+		return jobs[0].result;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (pthread_create(&jobs[i].thread, NULL, _smp_flush_thread,
+				   &jobs[i]) != 0)
+			break;
+		started++;
+	}
+	for (i = started; i < count; i++)
+		_smp_flush_thread(&jobs[i]);
+	for (i = 0; i < started; i++)
+		pthread_join(jobs[i].thread, NULL);
+
+	for (i = 0; i < count; i++)
+		if (jobs[i].result != GPIO_STATUS_OK)
+			status = jobs[i].result;
+	return status;
+}
+
 int scsi_smp_write_buffer(struct block_device *device)
 {
-	const char *sysfs_path = device->cntrl_path;
+	struct smp_host_job jobs[SMP_MAX_FLUSH_JOBS];
+	struct _host_type *host;
+	int count = 0, total = 0, status = GPIO_STATUS_OK;
 
-	if (sysfs_path == NULL)
+	if (device->cntrl_path == NULL)
 		__set_errno_and_return(EINVAL);
 	if (!device->host)
 		__set_errno_and_return(ENODEV);
 
-	if (device->host->flush) {
-		device->host->flush = 0;
-		/* re-transmit the bitstream */
+	/*
+	 * Collect every host of the controller with a pending bitstream, so
+	 * one call transmits all of them concurrently. Subsequent calls of
+	 * the same flush pass find the flush flags already cleared.
+	 */
+	for (host = device->cntrl->hosts; host; host = host->next) {
+		struct smp_host_job *job;
+
+		if (!host->flush)
+			continue;
+		if (!host->bsg_path) {
+			if (host != device->host)
+				continue;
+			host->bsg_path = device->cntrl_path;
+		}
+		if (!device->cntrl->isci_present && !host->ibpi_state_buffer)
+			continue;
+		host->flush = 0;
+
+		job = &jobs[count++];
+		total++;
+		job->host = host;
+		job->result = GPIO_STATUS_OK;
 		if (device->cntrl->isci_present) {
-			return smp_write_gpio(sysfs_path,
-					       GPIO_REG_TYPE_TX_GP,
-					       GPIO_TX_GP1, 1,
-					       &device->host->bitstream[0],
-					       SMP_DATA_CHUNKS);
+			job->reg_type = GPIO_REG_TYPE_TX_GP;
+			job->reg_index = GPIO_TX_GP1;
+			job->reg_count = 1;
+			job->data = &host->bitstream[0];
+			job->len = SMP_DATA_CHUNKS;
 		} else {
-			return smp_write_gpio(sysfs_path,
-					       GPIO_REG_TYPE_TX,
-					       0, (device->host->ports+3)/4,
-					       device->host->ibpi_state_buffer,
-					       (device->host->ports+3)/4);
+			job->reg_type = GPIO_REG_TYPE_TX;
+			job->reg_index = 0;
+			job->reg_count = (host->ports + 3) / 4;
+			job->data = host->ibpi_state_buffer;
+			job->len = (host->ports + 3) / 4;
 		}
-	} else
+		if (count == SMP_MAX_FLUSH_JOBS) {
+			int rc = _smp_run_jobs(jobs, count);
+
+			if (rc != GPIO_STATUS_OK)
+				status = rc;
+			count = 0;
+		}
+	}
+	if (count) {
+		int rc = _smp_run_jobs(jobs, count);
+
+		if (rc != GPIO_STATUS_OK)
+			status = rc;
+	}
+	if (total == 0)
 		return 1;
+	return status;
 }
 
 /**
@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+/* Shared-memory export of the slot model */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if _HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif
+
+#include "libled_private.h"
+#include "slot.h"
+#include "state_shm.h"
+#include "status.h"
+#include "sysfs.h"
+#include "utils.h"
+
+/**
+ * @brief Maps the state file for writing, growing it when needed.
+ *
+ * The mapping is cached in the context; it is recreated only when the slot
+ * model outgrows the current file size.
+ */
+static struct state_shm_header *_publish_map(struct led_ctx *ctx, size_t size)
+{
+	struct state_shm_pub *pub = &ctx->shm;
+	void *map;
+
+	if (pub->map && pub->size >= size)
+		return pub->map;
+
+	if (pub->fd < 0) {
+		pub->fd = open(STATE_SHM_PATH, O_RDWR | O_CREAT | O_CLOEXEC,
+			       0644);
+		if (pub->fd < 0)
+			return NULL;
+	}
+	if (ftruncate(pub->fd, size) != 0)
+		return NULL;
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, pub->fd, 0);
+	if (map == MAP_FAILED)
+		return NULL;
+	if (pub->map)
+		munmap(pub->map, pub->size);
+	pub->map = map;
+	pub->size = size;
+	return map;
+}
+
+int state_shm_publish(struct led_ctx *ctx)
+{
+	const struct vector *slots = sysfs_get_slots(ctx);
+	struct state_shm_header *hdr;
+	struct state_shm_slot *recs;
+	struct slot_property *slot;
+	uint32_t seq;
+	size_t i = 0;
+
+	hdr = _publish_map(ctx, sizeof(*hdr) +
+			   slots->count * sizeof(*recs));
+	if (!hdr)
+		return -1;
+	recs = (struct state_shm_slot *)(hdr + 1);
+
+	/* Seqlock write side: seq is odd while the body is inconsistent. */
+	seq = hdr->seq;
+	__atomic_store_n(&hdr->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	vector_for_each(slots, slot) {
+		struct state_shm_slot *rec = &recs[i++];
+
+		snprintf(rec->slot_id, sizeof(rec->slot_id), "%s",
+			 slot->slot_id);
+		snprintf(rec->devnode, sizeof(rec->devnode), "%s",
+			 slot->bl_device ? slot->bl_device->devnode : "");
+		rec->cntrl_type = slot->c->cntrl_type;
+		rec->state = get_slot_pattern(slot);
+	}
+	hdr->magic = STATE_SHM_MAGIC;
+	hdr->version = STATE_SHM_VERSION;
+	hdr->slot_count = i;
+
+	__atomic_store_n(&hdr->seq, seq + 2, __ATOMIC_RELEASE);
+	return 0;
+}
+
+void state_shm_fini(struct led_ctx *ctx)
+{
+	struct state_shm_pub *pub = &ctx->shm;
+
+	if (pub->map) {
+		munmap(pub->map, pub->size);
+		pub->map = NULL;
+		pub->size = 0;
+	}
+	if (pub->fd >= 0) {
+		close(pub->fd);
+		pub->fd = -1;
+	}
+}
+
+/**
+ * @brief get_state_fn of a shared-memory slot, returns the published state.
+ */
+static enum led_ibpi_pattern _shm_get_state(struct slot_property *slot)
+{
+	return slot->slot_spec.shm->state;
+}
+
+/**
+ * @brief set_slot_fn of a shared-memory slot. The read-only context has no
+ *        access to the hardware, setting a state is refused.
+ */
+static status_t _shm_set_slot(struct slot_property *slot __attribute__((unused)),
+			      enum led_ibpi_pattern state __attribute__((unused)))
+{
+	return STATUS_INVALID_STATE;
+}
+
+/* Upper bound on seqlock read retries, see _read_stable(). */
+#define STATE_SHM_READ_RETRIES	1000
+
+/**
+ * @brief Copies a consistent snapshot of the published records.
+ *
+ * Seqlock read side: the body is copied and the sequence re-checked, a torn
+ * copy is retried while the monitor is mid-publish. The retries are bounded,
+ * a publisher killed between the sequence stores leaves the sequence odd
+ * forever and must not livelock the reader.
+ *
+ * @return Number of copied records, -1 on allocation failure, -2 when no
+ *         consistent snapshot could be taken, because the publisher died
+ *         mid-publish or the file grew past the mapping.
+ */
+static int _read_stable(const struct state_shm_header *hdr, size_t map_size,
+			struct state_shm_slot **out_recs)
+{
+	struct state_shm_slot *recs = NULL;
+	uint32_t seq1, seq2, count;
+	int retry;
+
+	for (retry = 0; retry < STATE_SHM_READ_RETRIES; retry++) {
+		seq1 = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+		if (seq1 & 1) {
+			sched_yield();
+			continue;
+		}
+		count = hdr->slot_count;
+		if (sizeof(*hdr) + (size_t)count * sizeof(*recs) > map_size) {
+			/*
+			 * The file grew after mmap, the stale mapping cannot
+			 * cover the body and retrying does not help.
+			 */
+			free(recs);
+			return -2;
+		}
+		free(recs);
+		recs = malloc(count * sizeof(*recs));
+		if (count && !recs)
+			return -1;
+		memcpy(recs, hdr + 1, count * sizeof(*recs));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED);
+		if (seq1 == seq2) {
+			*out_recs = recs;
+			return count;
+		}
+	}
+
+	free(recs);
+	return -2;
+}
+
+led_status_t state_shm_load(struct led_ctx *ctx)
+{
+	struct state_shm_header *hdr;
+	struct state_shm_slot *recs = NULL;
+	struct stat st;
+	led_status_t status = LED_STATUS_SUCCESS;
+	int fd, count, i;
+
+	fd = open(STATE_SHM_PATH, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return LED_STATUS_INVALID_PATH;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(*hdr)) {
+		close(fd);
+		return LED_STATUS_DATA_ERROR;
+	}
+
+	hdr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hdr == MAP_FAILED)
+		return LED_STATUS_DATA_ERROR;
+	if (hdr->magic != STATE_SHM_MAGIC ||
+	    hdr->version != STATE_SHM_VERSION) {
+		munmap(hdr, st.st_size);
+		return LED_STATUS_DATA_ERROR;
+	}
+
+	count = _read_stable(hdr, st.st_size, &recs);
+	munmap(hdr, st.st_size);
+	if (count == -1)
+		return LED_STATUS_OUT_OF_MEMORY;
+	if (count < 0)
+		return LED_STATUS_DATA_ERROR;
+
+	/* Rebuild the slot model of the context from the snapshot. */
+	sysfs_reset(ctx);
+	for (i = 0; i < count; i++) {
+		struct slot_property *slot;
+		struct slot_property_common *common;
+		struct state_shm_slot *rec;
+
+		slot = arena_alloc(&ctx->scan_arena, sizeof(*slot));
+		common = arena_alloc(&ctx->scan_arena, sizeof(*common));
+		rec = arena_alloc(&ctx->scan_arena, sizeof(*rec));
+		if (!slot || !common || !rec) {
+			status = LED_STATUS_OUT_OF_MEMORY;
+			break;
+		}
+		memset(slot, 0, sizeof(*slot));
+		*rec = recs[i];
+		common->cntrl_type = rec->cntrl_type;
+		common->get_state_fn = _shm_get_state;
+		common->set_slot_fn = _shm_set_slot;
+		slot->c = common;
+		slot->slot_spec.shm = rec;
+		snprintf(slot->slot_id, PATH_MAX, "%s", rec->slot_id);
+
+		if (rec->devnode[0]) {
+			struct block_device *bd;
+
+			bd = arena_alloc(&ctx->scan_arena, sizeof(*bd));
+			if (!bd) {
+				status = LED_STATUS_OUT_OF_MEMORY;
+				break;
+			}
+			memset(bd, 0, sizeof(*bd));
+			str_cpy(bd->devnode, rec->devnode, PATH_MAX);
+			bd->ibpi = rec->state;
+			slot->bl_device = bd;
+		}
+		vector_append_ctx(&ctx->sys.slots_list, slot, ctx);
+	}
+	free(recs);
+	slot_index_rebuild(ctx);
+	if (status == LED_STATUS_SUCCESS)
+		status = ctx->deferred_error;
+	return status;
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _STATE_SHM_H_INCLUDED_
+#define _STATE_SHM_H_INCLUDED_
+
+#include <stdint.h>
+
+#include "led/libled.h"
+
+/**
+ * Shared-memory export of the ledmon slot model. The monitor publishes the
+ * slot list after every cycle, external consumers attach read-only through
+ * led_ctx_open_readonly() instead of paying a full hardware scan. The file
+ * is a plain mmap'd layout: one header followed by slot_count slot records,
+ * protected by a seqlock so readers retry instead of blocking the writer.
+ */
+#define STATE_SHM_PATH		"/run/ledmon/state"
+#define STATE_SHM_MAGIC		0x4C454453	/* "SDEL" little endian */
+#define STATE_SHM_VERSION	1
+#define STATE_SHM_STR_LEN	256
+
+/**
+ * @brief One exported slot record.
+ */
+struct state_shm_slot {
+	char slot_id[STATE_SHM_STR_LEN];
+	char devnode[STATE_SHM_STR_LEN];
+	uint32_t cntrl_type;
+	uint32_t state;
+};
+
+/**
+ * @brief Header of the exported state file.
+ *
+ * The seq field implements a seqlock: it is odd while the writer updates the
+ * body, readers copy the body and re-check seq to detect a torn read.
+ */
+struct state_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;
+	uint32_t slot_count;
+};
+
+/**
+ * @brief Publishes the slot model of the context to the state file.
+ *
+ * Called by ledmon after every monitor cycle. The mapping is kept open in
+ * the context and only grown when the slot count increases.
+ *
+ * @param[in]      ctx            Library context owning the slot model.
+ *
+ * @return 0 if successful, otherwise -1.
+ */
+int state_shm_publish(struct led_ctx *ctx);
+
+/**
+ * @brief Unmaps and closes the publisher side of the state file.
+ */
+void state_shm_fini(struct led_ctx *ctx);
+
+/**
+ * @brief Rebuilds the slot model of a read-only context from the state file.
+ *
+ * A consistent snapshot of the published records is taken under the seqlock
+ * and turned into slot properties, no sysfs or hardware access is involved.
+ *
+ * @param[in]      ctx            Read-only library context.
+ *
+ * @return LED_STATUS_SUCCESS if successful, otherwise an error reason.
+ */
+led_status_t state_shm_load(struct led_ctx *ctx);
+
+#endif				/* _STATE_SHM_H_INCLUDED_ */
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if _HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif
+
+#include "strpool.h"
+
+/*
+ * Initializes a string pool object. See strpool.h for details.
+ */
+void str_pool_init(struct str_pool *pool)
+{
+	hash_map_init(&pool->map);
+	list_init(&pool->strings, free);
+	pthread_mutex_init(&pool->lock, NULL);
+}
+
+/*
+ * Interns a string. See strpool.h for details.
+ */
+char *str_pool_intern(struct str_pool *pool, const char *str)
+{
+	char *interned;
+
+	pthread_mutex_lock(&pool->lock);
+	interned = hash_map_find(&pool->map, str);
+	if (!interned) {
+		interned = strdup(str);
+		if (interned && !list_append(&pool->strings, interned)) {
+			free(interned);
+			interned = NULL;
+		}
+		/*
+		 * The copy is owned by the list already, on index failure it
+		 * is kept there and released by str_pool_fini(). Returning it
+		 * would break the pointer equality guarantee, so fail instead.
+		 */
+		if (interned && !hash_map_insert(&pool->map, str, interned))
+			interned = NULL;
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return interned;
+}
+
+/*
+ * Releases all strings held by the pool. See strpool.h for details.
+ */
+void str_pool_fini(struct str_pool *pool)
+{
+	hash_map_fini(&pool->map);
+	list_erase(&pool->strings);
+	pthread_mutex_destroy(&pool->lock);
+}
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _STRPOOL_H_INCLUDED_
+#define _STRPOOL_H_INCLUDED_
+
+#include <pthread.h>
+
+#include "hashmap.h"
+#include "list.h"
+
+/**
+ * Interning pool for sysfs path strings. Every distinct path is kept in one
+ * shared immutable allocation, so duplicating a device costs a pointer copy
+ * and equality of two interned paths can be decided by comparing pointers.
+ * Interned strings stay valid until str_pool_fini() and must never be
+ * modified nor passed to free().
+ *
+ * The pool may be used concurrently by the probe worker threads, see
+ * sysfs.c, all operations take the embedded lock.
+ */
+struct str_pool {
+	struct hash_map map;
+	struct list strings;
+	pthread_mutex_t lock;
+};
+
+/**
+ * @brief Initializes a string pool object.
+ *
+ * Initializes a string pool object to reflect an empty state.
+ *
+ * @param[in]      pool           pointer to a string pool object.
+ */
+void str_pool_init(struct str_pool *pool);
+
+/**
+ * @brief Interns a string.
+ *
+ * Returns the pooled copy of the given string, creating it on first use.
+ * Calls with equal contents return the same pointer, so interned strings can
+ * be compared for equality by address.
+ *
+ * @param[in]      pool           pointer to a string pool object.
+ * @param[in]      str            null-terminated string to intern.
+ *
+ * @return Pooled copy of the string if successful, otherwise NULL pointer.
+ */
+char *str_pool_intern(struct str_pool *pool, const char *str);
+
+/**
+ * @brief Releases all strings held by the pool.
+ *
+ * The pool is left in initialized, empty state. All pointers handed out by
+ * str_pool_intern() become invalid.
+ *
+ * @param[in]      pool           pointer to a string pool object.
+ */
+void str_pool_fini(struct str_pool *pool);
+
+#endif				/* _STRPOOL_H_INCLUDED_ */
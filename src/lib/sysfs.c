@@ -3,10 +3,13 @@
 
 #include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -22,6 +25,8 @@
 #include "npem.h"
 #include "pci_slot.h"
 #include "raid.h"
+#include "ses.h"
+#include "smp.h"
 #include "tail.h"
 #include "slot.h"
 #include "stdio.h"
@@ -108,10 +113,13 @@ static void _tail_vol_add(struct led_ctx *ctx, const char *path, struct raid_dev
 
 	char *t = strrchr(path, '/');
 	if (strncmp(t + 1, "dev-", 4) == 0) {
-		device = tail_device_init(path, &ctx->sys.sysfs_block_list);
+		device = tail_device_init(ctx, path, &ctx->sys.sysfs_block_list);
 		if (device) {
 			device->raid = raid;
 			list_append_ctx(&ctx->sys.tail_list, device, ctx);
+			hash_map_insert(&ctx->sys.tail_block_map,
+					device->block->sysfs_path,
+					device->block);
 		}
 	}
 }
@@ -120,22 +128,18 @@ static void _tail_vol_add(struct led_ctx *ctx, const char *path, struct raid_dev
  * @brief Checks for duplicate entries on list of tail devices.
  *
  * This is internal function of sysfs module. The functions checks if the given
- * tail device is already on list with tail devices. This function is used by
- * _tail_cnt_add() function to avoid duplicate entries.
+ * tail device is already on list with tail devices, using the membership set
+ * kept alongside tail_list. This function is used by _tail_cnt_add() function
+ * to avoid duplicate entries.
  *
  * @param[in]      tail          Pointer to tail device structure to check.
  *
  * @return 1 the given device is on the list, otherwise the function returns 0.
  */
-static int _is_duplicate(struct list *tail_list, struct tail_device *tail)
+static int _is_duplicate(struct led_ctx *ctx, struct tail_device *tail)
 {
-	struct tail_device *device;
-
-	list_for_each(tail_list, device) {
-		if (device->block == tail->block)
-			return 1;
-	}
-	return 0;
+	return hash_map_find(&ctx->sys.tail_block_map,
+			     tail->block->sysfs_path) != NULL;
 }
 
 /**
@@ -148,17 +152,10 @@ static int _is_duplicate(struct list *tail_list, struct tail_device *tail)
  *
  * @return 1 if can be removed, otherwise 0.
  */
-static int _is_non_raid_device(struct list *tail_list, struct block_device *block_device)
+static int _is_non_raid_device(struct led_ctx *ctx, struct block_device *block_device)
 {
-	struct tail_device *tail_device;
-
-	list_for_each(tail_list, tail_device) {
-		if (strcmp(tail_device->block->sysfs_path,
-			   block_device->sysfs_path) == 0)
-			return 0;
-	}
-
-	return 1;
+	return hash_map_find(&ctx->sys.tail_block_map,
+			     block_device->sysfs_path) == NULL;
 }
 
 /**
@@ -173,11 +170,14 @@ static void _tail_cnt_add(struct led_ctx *ctx, const char *path, struct raid_dev
 		return;
 
 	if (strncmp(t + 1, "dev-", 4) == 0) {
-		device = tail_device_init(path, &ctx->sys.sysfs_block_list);
+		device = tail_device_init(ctx, path, &ctx->sys.sysfs_block_list);
 		if (device) {
-			if (!_is_duplicate(&ctx->sys.tail_list, device)) {
+			if (!_is_duplicate(ctx, device)) {
 				device->raid = raid;
 				list_append_ctx(&ctx->sys.tail_list, device, ctx);
+				hash_map_insert(&ctx->sys.tail_block_map,
+						device->block->sysfs_path,
+						device->block);
 			} else {
 				tail_device_fini(device);
 			}
@@ -207,12 +207,328 @@ static void _link_raid_device(struct led_ctx *ctx, struct raid_device *device,
 }
 
 /**
+ * Maximal number of threads probing devices in parallel, see _probe_devices().
  */
-static void _block_add(struct led_ctx *ctx, const char *path)
+#define PROBE_MAX_THREADS	16
+
+/**
+ * @brief Single unit of work of the probing pool, see _probe_devices().
+ */
+struct probe_task {
+	const char *path;
+	void *device;
+};
+
+/**
+ * @brief Work shared by device probing threads, see _probe_devices().
+ */
+struct probe_work {
+	struct led_ctx *ctx;
+	void *(*probe_fn)(struct led_ctx *ctx, const char *path);
+	struct probe_task *tasks;
+	int count;
+	int next;
+	pthread_mutex_t lock;
+};
+
+/**
+ */
+static void *_probe_worker(void *arg)
 {
-	struct block_device *device = block_device_init(&ctx->sys.cntrl_list, path);
-	if (device)
-		list_append_ctx(&ctx->sys.sysfs_block_list, device, ctx);
+	struct probe_work *work = arg;
+
+	for (;;) {
+		struct probe_task *task;
+
+		pthread_mutex_lock(&work->lock);
+		if (work->next >= work->count) {
+			pthread_mutex_unlock(&work->lock);
+			break;
+		}
+		task = &work->tasks[work->next++];
+		pthread_mutex_unlock(&work->lock);
+
+		task->device = work->probe_fn(work->ctx, task->path);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Probes directory entries in parallel and merges the results.
+ *
+ * This is internal function of sysfs module. Every entry of the directory
+ * listing is probed with the given function. Probing is spread over a pool of
+ * worker threads because per-device probing is independent and dominated by
+ * blocking sysfs reads. Results are merged into the context lists on the
+ * calling thread, in directory order, so list contents do not depend on probe
+ * timing. Degrades to sequential probing when no thread can be spawned.
+ *
+ * @param[in]      ctx            Library context.
+ * @param[in]      dir            Directory listing to probe.
+ * @param[in]      probe_fn       Builds a device object from a path, NULL if
+ *                                the device is not supported.
+ * @param[in]      merge_fn       Puts a device object onto the context lists.
+ */
+static void _probe_devices(struct led_ctx *ctx, struct list *dir,
+			   void *(*probe_fn)(struct led_ctx *ctx, const char *path),
+			   void (*merge_fn)(struct led_ctx *ctx, void *device))
+{
+	pthread_t threads[PROBE_MAX_THREADS];
+	struct probe_work work;
+	const char *dir_path;
+	long nthreads;
+	int count = 0, started = 0, i;
+
+	list_for_each(dir, dir_path)
+		count++;
+	if (count == 0)
+		return;
+
+	work.tasks = calloc(count, sizeof(*work.tasks));
+	if (!work.tasks) {
+		ctx->deferred_error = LED_STATUS_OUT_OF_MEMORY;
+		return;
+	}
+	work.ctx = ctx;
+	work.probe_fn = probe_fn;
+	work.count = count;
+	work.next = 0;
+	pthread_mutex_init(&work.lock, NULL);
+
+	i = 0;
+	list_for_each(dir, dir_path)
+		work.tasks[i++].path = dir_path;
+
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > PROBE_MAX_THREADS)
+		nthreads = PROBE_MAX_THREADS;
+	if (nthreads > count)
+		nthreads = count;
+
+	for (i = 1; i < nthreads; i++) {
+		if (pthread_create(&threads[started], NULL, _probe_worker,
+				   &work))
+			break;
+		started++;
+	}
+	_probe_worker(&work);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&work.lock);
+
+	for (i = 0; i < count; i++)
+		if (work.tasks[i].device)
+			merge_fn(ctx, work.tasks[i].device);
+	free(work.tasks);
+}
+
+/**
+ */
+static void *_block_probe(struct led_ctx *ctx, const char *path)
+{
+	return block_device_init(&ctx->sys.cntrl_list, path);
+}
+
+/**
+ */
+static void _block_merge(struct led_ctx *ctx, void *item)
+{
+	struct block_device *device = item;
+
+	device->gen = ctx->sys.scan_gen;
+	vector_append_ctx(&ctx->sys.sysfs_block_list, device, ctx);
+	hash_map_insert(&ctx->sys.block_path_map, device->sysfs_path, device);
+	if (device->devnode[0])
+		hash_map_insert(&ctx->sys.devnode_map, device->devnode,
+				device);
+}
+
+/**
+ * Upper length of the md attribute values kept for change detection, enough
+ * for every sync_action keyword and the degraded counter.
+ */
+#define RAID_WATCH_VAL_MAX	32
+
+/**
+ * @brief Poll watch on the state attributes of a single RAID device.
+ *
+ * This is internal structure of sysfs module. One instance is kept per
+ * discovered array, holding open descriptors of md/sync_action and
+ * md/degraded together with the values read last, so spurious notifications
+ * can be told apart from real state changes.
+ */
+struct raid_watch {
+	const char *path;	/* array sysfs path, interned in path_pool */
+	int sync_fd;
+	int degr_fd;
+	char sync_val[RAID_WATCH_VAL_MAX];
+	char degr_val[RAID_WATCH_VAL_MAX];
+};
+
+/**
+ * @brief Reads a watched attribute, arming the sysfs change notification.
+ *
+ * This is internal function of sysfs module. Sysfs reports POLLPRI only to
+ * readers which consumed the attribute content, so every wakeup has to be
+ * followed by a fresh read.
+ *
+ * @return 0 on success, -1 when the attribute is gone.
+ */
+static int _raid_watch_read(int fd, char *val)
+{
+	ssize_t count;
+
+	if (lseek(fd, 0, SEEK_SET) < 0)
+		return -1;
+	count = read(fd, val, RAID_WATCH_VAL_MAX - 1);
+	if (count < 0)
+		return -1;
+	while (count > 0 && val[count - 1] == '\n')
+		count--;
+	val[count] = '\0';
+	return 0;
+}
+
+/**
+ * @brief Closes the descriptors of a watch, keeping the entry.
+ *
+ * This is internal function of sysfs module. Closing removes the descriptors
+ * from the epoll set, the dead entry stays registered until sysfs_reset().
+ */
+static void _raid_watch_disarm(struct raid_watch *watch)
+{
+	if (watch->sync_fd >= 0) {
+		close(watch->sync_fd);
+		watch->sync_fd = -1;
+	}
+	if (watch->degr_fd >= 0) {
+		close(watch->degr_fd);
+		watch->degr_fd = -1;
+	}
+}
+
+/**
+ */
+static void _raid_watch_fini(struct raid_watch *watch)
+{
+	_raid_watch_disarm(watch);
+	free(watch);
+}
+
+/**
+ * @brief Arms one attribute descriptor of a watch.
+ *
+ * This is internal function of sysfs module. The initial read arms the
+ * notification and seeds the value compared against on wakeup. Attributes
+ * which cannot be read are closed and left unwatched.
+ */
+static void _raid_watch_arm(struct led_ctx *ctx, struct raid_watch *watch,
+			    int *fd, char *val)
+{
+	struct epoll_event ev;
+
+	if (*fd < 0)
+		return;
+	if (_raid_watch_read(*fd, val) != 0) {
+		close(*fd);
+		*fd = -1;
+		return;
+	}
+	ev.events = EPOLLPRI | EPOLLERR;
+	ev.data.ptr = watch;
+	epoll_ctl(ctx->sys.raid_wd_epoll, EPOLL_CTL_ADD, *fd, &ev);
+}
+
+/**
+ * @brief Starts watching the state attributes of a RAID device.
+ *
+ * This is internal function of sysfs module. The function opens md/sync_action
+ * and md/degraded of the given array and registers them with the watch epoll
+ * set, so a state change wakes the daemon event loop without waiting for the
+ * reconciliation interval. Called on every discovery, arrays watched already
+ * are recognized and skipped.
+ */
+static void _raid_watch_add(struct led_ctx *ctx, const char *path)
+{
+	struct raid_watch *watch;
+	char temp[PATH_MAX];
+
+	if (ctx->sys.raid_wd_epoll < 0)
+		return;
+	if (hash_map_find(&ctx->sys.raid_watch_map, path))
+		return;
+
+	watch = calloc(1, sizeof(struct raid_watch));
+	if (!watch)
+		return;
+	watch->path = str_pool_intern(&ctx->path_pool, path);
+	snprintf(temp, sizeof(temp), "%s/md/sync_action", path);
+	watch->sync_fd = open(temp, O_RDONLY);
+	snprintf(temp, sizeof(temp), "%s/md/degraded", path);
+	watch->degr_fd = open(temp, O_RDONLY);
+	if (!watch->path ||
+	    (watch->sync_fd < 0 && watch->degr_fd < 0) ||
+	    !list_append(&ctx->sys.raid_watch_list, watch)) {
+		/* Containers expose neither attribute, nothing to watch. */
+		_raid_watch_fini(watch);
+		return;
+	}
+	_raid_watch_arm(ctx, watch, &watch->sync_fd, watch->sync_val);
+	_raid_watch_arm(ctx, watch, &watch->degr_fd, watch->degr_val);
+	hash_map_insert(&ctx->sys.raid_watch_map, watch->path, watch);
+}
+
+int sysfs_raid_event_fd(struct led_ctx *ctx)
+{
+	if (!ctx)
+		return -1;
+	return ctx->sys.raid_wd_epoll;
+}
+
+int sysfs_raid_events_handle(struct led_ctx *ctx)
+{
+	struct epoll_event events[16];
+	int nfds, i, changed = 0;
+
+	if (!ctx || ctx->sys.raid_wd_epoll < 0)
+		return 0;
+
+	nfds = epoll_wait(ctx->sys.raid_wd_epoll, events, 16, 0);
+	for (i = 0; i < nfds; i++) {
+		struct raid_watch *watch = events[i].data.ptr;
+		char val[RAID_WATCH_VAL_MAX];
+
+		if (watch->sync_fd >= 0) {
+			if (_raid_watch_read(watch->sync_fd, val) != 0) {
+				/* The array is gone, stop watching it. */
+				_raid_watch_disarm(watch);
+				changed++;
+				continue;
+			}
+			if (strcmp(val, watch->sync_val) != 0) {
+				lib_log(ctx, LED_LOG_LEVEL_DEBUG,
+					"(%s) sync_action: %s -> %s",
+					watch->path, watch->sync_val, val);
+				memcpy(watch->sync_val, val, sizeof(watch->sync_val));
+				changed++;
+			}
+		}
+		if (watch->degr_fd >= 0) {
+			if (_raid_watch_read(watch->degr_fd, val) != 0) {
+				_raid_watch_disarm(watch);
+				changed++;
+				continue;
+			}
+			if (strcmp(val, watch->degr_val) != 0) {
+				lib_log(ctx, LED_LOG_LEVEL_DEBUG,
+					"(%s) degraded: %s -> %s",
+					watch->path, watch->degr_val, val);
+				memcpy(watch->degr_val, val, sizeof(watch->degr_val));
+				changed++;
+			}
+		}
+	}
+	return changed;
 }
 
 /**
@@ -221,8 +537,10 @@ static void _volum_add(struct led_ctx *ctx, const char *path, unsigned int devic
 {
 	struct raid_device *device =
 		raid_device_init(path, device_num, DEVICE_TYPE_VOLUME, ctx);
-	if (device)
+	if (device) {
 		list_append_ctx(&ctx->sys.volum_list, device, ctx);
+		_raid_watch_add(ctx, path);
+	}
 }
 
 /**
@@ -231,8 +549,10 @@ static void _cntnr_add(struct led_ctx *ctx, const char *path, unsigned int devic
 {
 	struct raid_device *device =
 	    raid_device_init(path, device_num, DEVICE_TYPE_CONTAINER, ctx);
-	if (device)
+	if (device) {
 		list_append_ctx(&ctx->sys.cntnr_list, device, ctx);
+		_raid_watch_add(ctx, path);
+	}
 }
 
 /**
@@ -260,16 +580,25 @@ static void _raid_add(struct led_ctx *ctx, const char *path)
  */
 static void _cntrl_add(struct led_ctx *ctx, const char *path)
 {
-	struct cntrl_device *device = cntrl_device_init(path, ctx);
-	if (device)
-		list_append_ctx(&ctx->sys.cntrl_list, device, ctx);
+	struct cntrl_device *device;
+
+	if (!cntrl_path_allowed(ctx, path))
+		return;
+	device = cntrl_device_init(path, ctx);
+	if (!device)
+		return;
+	if (!(ctx->scan_mask & LED_SCAN_MASK(device->cntrl_type))) {
+		cntrl_device_fini(device);
+		return;
+	}
+	vector_append_ctx(&ctx->sys.cntrl_list, device, ctx);
 }
 
 /**
  */
 static void _enclo_add(struct led_ctx *ctx, const char *path)
 {
-	struct enclosure_device *device = enclosure_device_init(path, ctx);
+	struct enclosure_device *device = enclosure_device_open(path, ctx);
 
 	if (device)
 		list_append_ctx(&ctx->sys.enclo_list, device, ctx);
@@ -280,8 +609,10 @@ static void _enclo_add(struct led_ctx *ctx, const char *path)
 static void _pci_slots_add(struct led_ctx *ctx, const char *path)
 {
 	struct pci_slot *device = pci_slot_init(path, ctx);
-	if (device)
+	if (device) {
 		list_append_ctx(&ctx->sys.pci_slots_list, device, ctx);
+		hash_map_insert(&ctx->sys.pci_slot_map, device->address, device);
+	}
 }
 
 /**
@@ -318,11 +649,20 @@ static void _check_enclo(struct led_ctx *ctx, const char *path)
 static void _scan_block(struct led_ctx *ctx)
 {
 	struct list dir;
-	if (scan_dir(SYSFS_CLASS_BLOCK, &dir) == 0) {
-		const char *dir_path;
 
-		list_for_each(&dir, dir_path)
-			_block_add(ctx, dir_path);
+	ctx->sys.scan_gen++;
+	if (scan_dir(sysfs_path(SYSFS_CLASS_BLOCK), &dir) == 0) {
+		struct cntrl_device *cntrl;
+
+		/*
+		 * Force the lazily built SMP state of SCSI controllers into
+		 * existence up front, the probing threads then only read it.
+		 */
+		vector_for_each(&ctx->sys.cntrl_list, cntrl)
+			if (cntrl->cntrl_type == LED_CNTRL_TYPE_SCSI)
+				cntrl_init_smp(NULL, cntrl);
+
+		_probe_devices(ctx, &dir, _block_probe, _block_merge);
 		list_erase(&dir);
 	}
 }
@@ -330,7 +670,7 @@ static void _scan_block(struct led_ctx *ctx)
 static void _scan_raid(struct led_ctx *ctx)
 {
 	struct list dir;
-	if (scan_dir(SYSFS_CLASS_BLOCK, &dir) == 0) {
+	if (scan_dir(sysfs_path(SYSFS_CLASS_BLOCK), &dir) == 0) {
 		const char *dir_path;
 
 		list_for_each(&dir, dir_path)
@@ -342,7 +682,7 @@ static void _scan_raid(struct led_ctx *ctx)
 static void _scan_cntrl(struct led_ctx *ctx)
 {
 	struct list dir;
-	if (scan_dir(SYSFS_PCI_DEVICES, &dir) == 0) {
+	if (scan_dir(sysfs_path(SYSFS_PCI_DEVICES), &dir) == 0) {
 		const char *dir_path;
 
 		list_for_each(&dir, dir_path)
@@ -360,31 +700,100 @@ static void _scan_tail(struct led_ctx *ctx)
 	list_for_each(&ctx->sys.cntnr_list, device)
 		_link_raid_device(ctx, device, DEVICE_TYPE_CONTAINER);
 	if (ctx->config.raid_members_only) {
-		struct node *node;
+		struct vector *blocks = &ctx->sys.sysfs_block_list;
+		size_t i = 0;
+
+		while (i < blocks->count) {
+			struct block_device *block = blocks->items[i];
 
-		list_for_each_node(&ctx->sys.sysfs_block_list, node) {
-			if (_is_non_raid_device(&ctx->sys.tail_list, node->item))
-				list_delete(node);
+			if (_is_non_raid_device(ctx, block)) {
+				if (block->devnode[0])
+					hash_map_remove(&ctx->sys.devnode_map,
+							block->devnode);
+				vector_delete_at(blocks, i);
+			} else {
+				i++;
+			}
 		}
 	}
 }
 
+/**
+ * @brief Loads SES pages of all enclosures found by the scan.
+ *
+ * This is internal function of sysfs module. Pages of all enclosures are
+ * fetched in one asynchronous batch, so slow expanders overlap instead of
+ * being probed strictly one after another. Enclosures which fail to respond
+ * are logged and dropped from the list.
+ */
+static void _load_enclo(struct led_ctx *ctx)
+{
+	struct ses_load_req *reqs;
+	struct enclosure_device *encl;
+	struct node *node;
+	int count = 0, i;
+
+	list_for_each(&ctx->sys.enclo_list, encl)
+		count++;
+	if (count == 0)
+		return;
+
+	reqs = calloc(count, sizeof(*reqs));
+	if (!reqs) {
+		ctx->deferred_error = LED_STATUS_OUT_OF_MEMORY;
+		return;
+	}
+
+	i = 0;
+	list_for_each(&ctx->sys.enclo_list, encl) {
+		reqs[i].fd = enclosure_open(encl);
+		reqs[i].sp = &encl->ses_pages;
+		i++;
+	}
+
+	ses_load_pages_batch(reqs, count, ctx);
+
+	i = 0;
+	list_for_each_node(&ctx->sys.enclo_list, node) {
+		encl = node->item;
+		if (reqs[i].result != 0 || enclosure_reload_finish(encl) != 0) {
+			lib_log(ctx, LED_LOG_LEVEL_WARNING,
+				"failed to initialize enclosure_device %s\n",
+				encl->sysfs_path);
+			list_delete(node);
+		}
+		i++;
+	}
+	free(reqs);
+}
+
 static void _scan_enclo(struct led_ctx *ctx)
 {
 	struct list dir;
-	if (scan_dir(SYSFS_CLASS_ENCLOSURE, &dir) == 0) {
+
+	/* Enclosures only back SCSI controllers, skip the SES traffic too. */
+	if (!(ctx->scan_mask & LED_SCAN_MASK(LED_CNTRL_TYPE_SCSI)))
+		return;
+
+	if (scan_dir(sysfs_path(SYSFS_CLASS_ENCLOSURE), &dir) == 0) {
 		const char *dir_path;
 
 		list_for_each(&dir, dir_path)
 			_check_enclo(ctx, dir_path);
 		list_erase(&dir);
 	}
+	_load_enclo(ctx);
 }
 
 static void _scan_pci_slots(struct led_ctx *ctx)
 {
 	struct list dir;
-	if (scan_dir(SYSFS_PCI_SLOTS, &dir) == 0) {
+
+	/* PCI hotplug slots are only consumed by the VMD controller. */
+	if (!(ctx->scan_mask & LED_SCAN_MASK(LED_CNTRL_TYPE_VMD)))
+		return;
+
+	if (scan_dir(sysfs_path(SYSFS_PCI_SLOTS), &dir) == 0) {
 		const char *dir_path;
 
 		list_for_each(&dir, dir_path) {
@@ -402,43 +811,47 @@ static void _scan_slots(struct led_ctx *ctx)
 	struct enclosure_device *encl;
 	struct slot_property *slot;
 
-	list_for_each(sysfs_get_cntrl_devices(ctx), cntrl_device) {
+	vector_for_each(sysfs_get_cntrl_devices(ctx), cntrl_device) {
 		if (cntrl_device->cntrl_type == LED_CNTRL_TYPE_NPEM) {
 			slot = npem_slot_property_init(cntrl_device);
 			if (slot)
-				list_append_ctx(&ctx->sys.slots_list, slot, ctx);
+				vector_append_ctx(&ctx->sys.slots_list, slot, ctx);
 		}
 	}
 
 	list_for_each(sysfs_get_pci_slots(ctx), pci_slot) {
 		slot = pci_slot_property_init(pci_slot);
 		if (slot)
-			list_append_ctx(&ctx->sys.slots_list, slot, ctx);
+			vector_append_ctx(&ctx->sys.slots_list, slot, ctx);
 	}
 
 	list_for_each(sysfs_get_enclosure_devices(ctx), encl) {
 		for (int i = 0; i < encl->slots_count; i++) {
 			slot = enclosure_slot_property_init(encl, i);
 			if (slot)
-				list_append_ctx(&ctx->sys.slots_list, slot, ctx);
+				vector_append_ctx(&ctx->sys.slots_list, slot, ctx);
 		}
 	}
+
+	slot_index_rebuild(ctx);
 }
 
 /**
  */
 static int _is_failed_array(struct raid_device *raid)
 {
-	if (raid->degraded > 0) {
-		switch (raid->level) {
+	int degraded = raid_device_degraded(raid);
+
+	if (degraded > 0) {
+		switch (raid_device_level(raid)) {
 		case RAID_LEVEL_1:
 		case RAID_LEVEL_10:
-			return (raid->degraded == raid->raid_disks);
+			return (degraded == raid_device_raid_disks(raid));
 		case RAID_LEVEL_4:
 		case RAID_LEVEL_5:
-			return (raid->degraded > 1);
+			return (degraded > 1);
 		case RAID_LEVEL_6:
-			return (raid->degraded > 2);
+			return (degraded > 2);
 		case RAID_LEVEL_LINEAR:
 		case RAID_LEVEL_UNKNOWN:
 		case RAID_LEVEL_0:
@@ -469,7 +882,7 @@ static void _set_array_state(struct led_ctx *ctx,
 				struct raid_device *raid,
 				struct block_device *block)
 {
-	switch (raid->sync_action) {
+	switch (raid_device_sync_action(raid)) {
 	case RAID_ACTION_UNKNOWN:
 	case RAID_ACTION_IDLE:
 	case RAID_ACTION_FROZEN:
@@ -510,7 +923,7 @@ static void _determine(struct led_ctx *ctx, struct tail_device *device)
 		_set_block_state(device->block, LED_IBPI_PATTERN_NORMAL);
 	} else if ((device->state & TAIL_STATE_SPARE) != 0) {
 		if (_is_failed_array(device->raid) == 0) {
-			if (device->raid->sync_action != RAID_ACTION_RESHAPE ||
+			if (raid_device_sync_action(device->raid) != RAID_ACTION_RESHAPE ||
 				ctx->config.blink_on_migration == 1)
 				_set_block_state(device->block,
 						 LED_IBPI_PATTERN_REBUILD);
@@ -539,41 +952,331 @@ static void _determine_tails(struct led_ctx *ctx)
 		_determine(ctx, device);
 }
 
+/**
+ * @brief No-op item free callback for arena-backed items.
+ *
+ * This is internal function of sysfs module. Slot properties are drawn from
+ * the scan arena and released by arena reset, the callback keeps
+ * vector_erase() from calling free() on them.
+ */
+static void _item_nofree(void *item __attribute__ ((unused)))
+{
+}
+
 void sysfs_init(struct led_ctx *ctx)
 {
-	list_init(&ctx->sys.sysfs_block_list, (item_free_t)block_device_fini);
-	list_init(&ctx->sys.volum_list, (item_free_t)raid_device_fini);
-	list_init(&ctx->sys.cntrl_list, (item_free_t)cntrl_device_fini);
-	list_init(&ctx->sys.tail_list, (item_free_t)tail_device_fini);
-	list_init(&ctx->sys.cntnr_list, (item_free_t)raid_device_fini);
-	list_init(&ctx->sys.enclo_list, (item_free_t)enclosure_device_fini);
-	list_init(&ctx->sys.pci_slots_list, (item_free_t)pci_slot_fini);
-	list_init(&ctx->sys.slots_list, NULL);
+	vector_init(&ctx->sys.sysfs_block_list, (item_free_t)block_device_fini);
+	list_init_arena(&ctx->sys.volum_list, (item_free_t)raid_device_fini,
+			&ctx->raid_arena);
+	vector_init(&ctx->sys.cntrl_list, (item_free_t)cntrl_device_fini);
+	list_init_arena(&ctx->sys.tail_list, (item_free_t)tail_device_fini,
+			&ctx->raid_arena);
+	list_init_arena(&ctx->sys.cntnr_list, (item_free_t)raid_device_fini,
+			&ctx->raid_arena);
+	list_init_arena(&ctx->sys.enclo_list, (item_free_t)enclosure_device_fini,
+			&ctx->scan_arena);
+	list_init_arena(&ctx->sys.pci_slots_list, (item_free_t)pci_slot_fini,
+			&ctx->scan_arena);
+	vector_init(&ctx->sys.slots_list, _item_nofree);
+	hash_map_init(&ctx->sys.devnode_map);
+	hash_map_init(&ctx->sys.block_path_map);
+	hash_map_init(&ctx->sys.pci_slot_map);
+	hash_map_init(&ctx->sys.sas_addr_map);
+	hash_map_init(&ctx->sys.slot_id_map);
+	hash_map_init(&ctx->sys.slot_devnode_map);
+	hash_map_init(&ctx->sys.tail_block_map);
+	list_init(&ctx->sys.raid_watch_list, (item_free_t)_raid_watch_fini);
+	hash_map_init(&ctx->sys.raid_watch_map);
+	ctx->sys.raid_wd_epoll = epoll_create1(EPOLL_CLOEXEC);
+	ctx->sys.pci_ino_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
 }
 
 void sysfs_reset(struct led_ctx *ctx)
 {
-	list_erase(&ctx->sys.sysfs_block_list);
+	vector_erase(&ctx->sys.sysfs_block_list);
 	list_erase(&ctx->sys.volum_list);
-	list_erase(&ctx->sys.cntrl_list);
+	vector_erase(&ctx->sys.cntrl_list);
 	list_erase(&ctx->sys.tail_list);
 	list_erase(&ctx->sys.cntnr_list);
 	list_erase(&ctx->sys.enclo_list);
 	list_erase(&ctx->sys.pci_slots_list);
-	list_erase(&ctx->sys.slots_list);
+	vector_erase(&ctx->sys.slots_list);
+	hash_map_clear(&ctx->sys.devnode_map);
+	hash_map_clear(&ctx->sys.block_path_map);
+	hash_map_clear(&ctx->sys.pci_slot_map);
+	hash_map_clear(&ctx->sys.sas_addr_map);
+	ctx->sys.sas_addr_map_valid = 0;
+	hash_map_clear(&ctx->sys.slot_id_map);
+	hash_map_clear(&ctx->sys.slot_devnode_map);
+	hash_map_clear(&ctx->sys.tail_block_map);
+	list_erase(&ctx->sys.raid_watch_list);
+	hash_map_clear(&ctx->sys.raid_watch_map);
+	/* Devices may be gone or renumbered, cached name lookups with them. */
+	hash_map_clear(&ctx->name_cache);
+	arena_reset(&ctx->scan_arena);
+	arena_reset(&ctx->raid_arena);
+	ctx->sys.fp_valid = 0;
+	/* Enclosure composition may have changed, drop cached SES pages. */
+	ctx->ses_cfg_gen++;
+	/* Same for the PCI topology and cached pci devices. */
+	npem_cache_reset(ctx);
 }
 
 void sysfs_scan(struct led_ctx *ctx)
 {
+	uint64_t t = timing_now_ns();
+
 	_scan_enclo(ctx);
+	t = timing_add(ctx, TIMING_SCAN_ENCLO, t);
 	_scan_cntrl(ctx);
+	t = timing_add(ctx, TIMING_SCAN_CNTRL, t);
 	_scan_pci_slots(ctx);
+	t = timing_add(ctx, TIMING_SCAN_PCI_SLOTS, t);
 	_scan_block(ctx);
+	t = timing_add(ctx, TIMING_SCAN_BLOCK, t);
 	_scan_raid(ctx);
+	t = timing_add(ctx, TIMING_SCAN_RAID, t);
 	_scan_slots(ctx);
+	t = timing_add(ctx, TIMING_SCAN_SLOTS, t);
 	_scan_tail(ctx);
+	t = timing_add(ctx, TIMING_SCAN_TAIL, t);
 
 	_determine_tails(ctx);
+	timing_add(ctx, TIMING_DETERMINE_TAILS, t);
+}
+
+/**
+ * This is internal array of sysfs module. It maps fingerprint slots onto
+ * directories walked by sysfs_scan().
+ */
+static const char * const scan_fp_dirs[SCAN_FP_COUNT] = {
+	[SCAN_FP_BLOCK]       = SYSFS_CLASS_BLOCK,
+	[SCAN_FP_ENCLOSURE]   = SYSFS_CLASS_ENCLOSURE,
+	[SCAN_FP_PCI_SLOTS]   = SYSFS_PCI_SLOTS,
+	[SCAN_FP_PCI_DEVICES] = SYSFS_PCI_DEVICES,
+};
+
+/**
+ * @brief Computes a fingerprint of a sysfs directory.
+ *
+ * This is internal function of sysfs module. The function hashes names of all
+ * entries found in the given directory (FNV-1a). The fingerprint changes
+ * whenever a device node appears in or disappears from the directory. It is
+ * deliberately insensitive to attribute content - state carried in attributes
+ * is re-read on every scan regardless.
+ *
+ * @param[in]      path           Path to directory in sysfs tree.
+ *
+ * @return Fingerprint of the directory, 0 if directory cannot be read.
+ */
+static uint64_t _dir_fingerprint(const char *path)
+{
+	struct list dir;
+	uint64_t fp = 0xcbf29ce484222325ULL;
+	const char *dir_path;
+
+	if (scan_dir(path, &dir) != 0)
+		return 0;
+
+	list_for_each(&dir, dir_path) {
+		const char *c;
+
+		for (c = dir_path; *c; c++) {
+			fp ^= (unsigned char)*c;
+			fp *= 0x100000001b3ULL;
+		}
+		fp ^= (unsigned char)'/';
+		fp *= 0x100000001b3ULL;
+	}
+	list_erase(&dir);
+	return fp;
+}
+
+/**
+ * @brief Checks whether sysfs topology changed since the previous scan.
+ *
+ * This is internal function of sysfs module. The function computes current
+ * fingerprints of all scanned directories and compares them with values
+ * stored during the previous scan. Freshly computed fingerprints are always
+ * returned to the caller so they can be stored once the scan completes.
+ *
+ * @param[in]      ctx            Library context.
+ * @param[out]     fp             Placeholder for current fingerprints, must
+ *                                hold SCAN_FP_COUNT elements.
+ *
+ * @return Bitmask of changed fingerprint slots, every slot is reported
+ *         changed when there is no previous scan. Zero means the topology
+ *         is unchanged.
+ */
+static unsigned int _topology_changed(struct led_ctx *ctx, uint64_t *fp)
+{
+	unsigned int changed = 0;
+	int i;
+
+	for (i = 0; i < SCAN_FP_COUNT; i++) {
+		fp[i] = _dir_fingerprint(sysfs_path(scan_fp_dirs[i]));
+		if (!ctx->sys.fp_valid || fp[i] != ctx->sys.dir_fp[i])
+			changed |= 1u << i;
+	}
+	return changed;
+}
+
+/* Generations a vanished block device survives before it is reaped. */
+#define BLOCK_REAP_GENS	4
+
+/**
+ * @brief Drops references to a block device from the slot model.
+ *
+ * This is internal function of sysfs module. Called before a device is
+ * reaped, so slot properties bound to it do not dangle.
+ */
+static void _slots_unbind_block(struct led_ctx *ctx, struct block_device *block)
+{
+	struct slot_property *slot;
+
+	vector_for_each(&ctx->sys.slots_list, slot)
+		if (slot->bl_device == block) {
+			slot_index_unbind(ctx, slot);
+			slot->bl_device = NULL;
+		}
+}
+
+/**
+ * @brief Incrementally reconciles the block device model with /sys/block.
+ *
+ * This is internal function of sysfs module. Devices which are already part
+ * of the model are stamped with the new scan generation and kept as they
+ * are, only genuinely new devices are probed and allocated. A device which
+ * disappeared stays in the model for BLOCK_REAP_GENS generations, keeping
+ * references to it valid across short absences, and is reaped afterwards.
+ */
+static void _rescan_block(struct led_ctx *ctx)
+{
+	struct block_device *device;
+	const char *dir_path;
+	struct list dir;
+	size_t i;
+
+	ctx->sys.scan_gen++;
+	/* The block population may change, rebuild the SAS index on demand. */
+	hash_map_clear(&ctx->sys.sas_addr_map);
+	ctx->sys.sas_addr_map_valid = 0;
+	if (scan_dir(sysfs_path(SYSFS_CLASS_BLOCK), &dir) != 0)
+		return;
+
+	list_for_each(&dir, dir_path) {
+		char link[PATH_MAX];
+
+		if (realpath(dir_path, link) == NULL)
+			continue;
+		device = hash_map_find(&ctx->sys.block_path_map, link);
+		if (device) {
+			device->gen = ctx->sys.scan_gen;
+			continue;
+		}
+		device = block_device_init(&ctx->sys.cntrl_list, dir_path);
+		if (device)
+			_block_merge(ctx, device);
+	}
+	list_erase(&dir);
+
+	i = 0;
+	while (i < ctx->sys.sysfs_block_list.count) {
+		device = ctx->sys.sysfs_block_list.items[i];
+		if (ctx->sys.scan_gen - device->gen < BLOCK_REAP_GENS) {
+			i++;
+			continue;
+		}
+		lib_log(ctx, LED_LOG_LEVEL_DEBUG,
+			"(%s) reaping %s, missing for %u scans", __func__,
+			device->sysfs_path, ctx->sys.scan_gen - device->gen);
+		_slots_unbind_block(ctx, device);
+		hash_map_remove(&ctx->sys.block_path_map, device->sysfs_path);
+		if (device->devnode[0] &&
+		    hash_map_find(&ctx->sys.devnode_map, device->devnode) == device)
+			hash_map_remove(&ctx->sys.devnode_map, device->devnode);
+		vector_delete_at(&ctx->sys.sysfs_block_list, i);
+	}
+}
+
+/**
+ * @brief Clears RAID state carried by the retained device model.
+ *
+ * This is internal function of sysfs module. When the device model is kept
+ * between scans the lists describing RAID state must be rebuilt from scratch,
+ * because RAID state changes (sync action, failed member, etc.) do not alter
+ * the sysfs topology. IBPI patterns accumulated on retained block devices are
+ * reset too, so _determine_tails() starts from a clean state.
+ */
+static void _reset_raid_state(struct led_ctx *ctx)
+{
+	struct block_device *device;
+
+	list_erase(&ctx->sys.volum_list);
+	list_erase(&ctx->sys.cntnr_list);
+	list_erase(&ctx->sys.tail_list);
+	hash_map_clear(&ctx->sys.tail_block_map);
+	arena_reset(&ctx->raid_arena);
+
+	vector_for_each(&ctx->sys.sysfs_block_list, device) {
+		device->ibpi = LED_IBPI_PATTERN_UNKNOWN;
+		raid_device_fini(device->raid_dev);
+		device->raid_dev = NULL;
+	}
+}
+
+/*
+ * Marks the stored fingerprint of the block directory stale, so the next
+ * sysfs_rescan() reconciles the block device list even when the directory
+ * content hashes the same. See libled_internal.h.
+ */
+void device_block_rescan_force(struct led_ctx *ctx)
+{
+	if (ctx->sys.fp_valid)
+		ctx->sys.dir_fp[SCAN_FP_BLOCK] ^= 1;
+}
+
+void sysfs_rescan(struct led_ctx *ctx)
+{
+	uint64_t fp[SCAN_FP_COUNT];
+	unsigned int changed = _topology_changed(ctx, fp);
+
+	/*
+	 * With raid_members_only enabled _scan_tail() prunes the block device
+	 * list, the retained model would not match a fresh scan. Always take
+	 * the full path then. Changes confined to /sys/block are reconciled
+	 * in place, only controller, enclosure or PCI changes still tear the
+	 * whole model down.
+	 */
+	/*
+	 * Controller classification is remembered across scans, but a PCI
+	 * add/remove can bring new hardware and an enclosure appearing can
+	 * turn a so-far unclassified path into a SCSI controller.
+	 */
+	if (changed & ((1u << SCAN_FP_PCI_DEVICES) | (1u << SCAN_FP_ENCLOSURE)))
+		hash_map_clear(&ctx->cntrl_probe_cache);
+
+	if ((changed & ~(1u << SCAN_FP_BLOCK)) || ctx->config.raid_members_only) {
+		sysfs_reset(ctx);
+		sysfs_scan(ctx);
+	} else {
+		uint64_t t = timing_now_ns();
+
+		if (changed & (1u << SCAN_FP_BLOCK)) {
+			_rescan_block(ctx);
+			t = timing_add(ctx, TIMING_SCAN_BLOCK, t);
+		}
+		_reset_raid_state(ctx);
+		_scan_raid(ctx);
+		t = timing_add(ctx, TIMING_SCAN_RAID, t);
+		_scan_tail(ctx);
+		t = timing_add(ctx, TIMING_SCAN_TAIL, t);
+		_determine_tails(ctx);
+		timing_add(ctx, TIMING_DETERMINE_TAILS, t);
+	}
+
+	memcpy(ctx->sys.dir_fp, fp, sizeof(ctx->sys.dir_fp));
+	ctx->sys.fp_valid = 1;
 }
 
 /*
@@ -586,9 +1289,9 @@ const struct list *sysfs_get_enclosure_devices(struct led_ctx *ctx)
 }
 
 /*
- * The function returns list of controller devices present in the system.
+ * The function returns vector of controller devices present in the system.
  */
-const struct list *sysfs_get_cntrl_devices(struct led_ctx *ctx)
+const struct vector *sysfs_get_cntrl_devices(struct led_ctx *ctx)
 {
 	return &ctx->sys.cntrl_list;
 }
@@ -601,7 +1304,7 @@ const struct list *sysfs_get_volumes(struct led_ctx *ctx)
 	return &ctx->sys.volum_list;
 }
 
-const struct list *sysfs_get_block_devices(struct led_ctx *ctx)
+const struct vector *sysfs_get_block_devices(struct led_ctx *ctx)
 {
 	return &ctx->sys.sysfs_block_list;
 }
@@ -611,7 +1314,7 @@ const struct list *sysfs_get_pci_slots(struct led_ctx *ctx)
 	return &ctx->sys.pci_slots_list;
 }
 
-const struct list *sysfs_get_slots(struct led_ctx *ctx)
+const struct vector *sysfs_get_slots(struct led_ctx *ctx)
 {
 	return &ctx->sys.slots_list;
 }
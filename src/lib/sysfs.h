@@ -5,21 +5,36 @@
 #define _SYSFS_H_INCLUDED_
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "hashmap.h"
 #include "list.h"
 #include "status.h"
+#include "vector.h"
 
 #define SYSFS_PCI_DEVICES	"/sys/bus/pci/devices"
 
 #define SYSTEM_DEV_DIR		"/dev"
 
+/**
+ * Indexes of sysfs directories fingerprinted during a scan. The fingerprints
+ * are used by sysfs_rescan() to detect topology changes between scans.
+ */
+enum scan_fp_index {
+	SCAN_FP_BLOCK = 0,
+	SCAN_FP_ENCLOSURE,
+	SCAN_FP_PCI_SLOTS,
+	SCAN_FP_PCI_DEVICES,
+	SCAN_FP_COUNT		/* keep last */
+};
+
 struct sysfs {
 	/**
-	 * This is internal variable global to sysfs module only. It is a list of
+	 * This is internal variable global to sysfs module only. It is a vector of
 	 * block devices registered in the system. Use sysfs_init()
 	 * function to initialize the variable. Use sysfs_scan() function to populate
-	 * the list. Use sysfs_reset() function to delete the content of the list.
+	 * the vector. Use sysfs_reset() function to delete its content.
 	 */
-	struct list sysfs_block_list;
+	struct vector sysfs_block_list;
 
 	/**
 	 * This is internal variable global to sysfs module only. It is a list of
@@ -30,13 +45,13 @@ struct sysfs {
 	struct list volum_list;
 
 	/**
-	 * This is internal variable global to sysfs module only. It is a list of
+	 * This is internal variable global to sysfs module only. It is a vector of
 	 * storage controller devices registered in the system and
 	 * supported by Intel(R) Enclosure LEDs Control Utility. Use sysfs_init()
 	 * function to initialize the variable. Use sysfs_scan() function to populate
-	 * the list. Use sysfs_reset() function to delete the content of the list.
+	 * the vector. Use sysfs_reset() function to delete its content.
 	 */
-	struct list cntrl_list;
+	struct vector cntrl_list;
 
 	/**
 	 * This is internal variable global to sysfs module only. It is a list of
@@ -69,13 +84,108 @@ struct sysfs {
 	struct list pci_slots_list;
 
 	/**
-	 * This is internal variable global to sysfs module only. It is a list of
-	 * PCI slots registered in the system. Use sysfs_init()
+	 * This is internal variable global to sysfs module only. It is a vector of
+	 * slot properties of supported controllers. Use sysfs_init()
 	 * function to initialize the variable. Use sysfs_scan() function to populate
-	 * the list. Use sysfs_reset() function to delete the content of the list.
+	 * the vector. Use sysfs_reset() function to delete its content.
+	 */
+	struct vector slots_list;
+
+	/**
+	 * Index of block devices from sysfs_block_list keyed by device node.
+	 * It makes led_device_name_lookup() O(1) instead of a linear walk.
+	 * The map only references items owned by sysfs_block_list.
+	 */
+	struct hash_map devnode_map;
+
+	/**
+	 * Index of block devices from sysfs_block_list keyed by the canonical
+	 * sysfs path. Used by the incremental rescan to recognize devices
+	 * which are already part of the model, so they are stamped instead of
+	 * reallocated. The map only references items owned by
+	 * sysfs_block_list.
+	 */
+	struct hash_map block_path_map;
+
+	/**
+	 * Generation counter of block device scans. Every enumeration of
+	 * /sys/block bumps it and stamps the devices it saw, see the gen
+	 * member of struct block_device.
+	 */
+	unsigned int scan_gen;
+
+	/**
+	 * Index of PCI hotplug slots from pci_slots_list keyed by the PCI
+	 * address of the slot. It makes vmdssd_find_pci_slot() O(1) instead
+	 * of a linear walk per NVMe device. The map only references items
+	 * owned by pci_slots_list.
 	 */
-	struct list slots_list;
+	struct hash_map pci_slot_map;
 
+	/**
+	 * Index of block devices keyed by their SAS address printed as hex.
+	 * Built lazily by the first locate_block_by_sas_addr() call after a
+	 * scan and valid until the device model is reset, so enclosure slot
+	 * resolution reads each drive's sas_address attribute once per scan
+	 * generation instead of once per slot candidate. The map only
+	 * references items owned by sysfs_block_list.
+	 */
+	struct hash_map sas_addr_map;
+	int sas_addr_map_valid;
+
+	/**
+	 * Lookup indexes of the slot model, keyed by controller type plus
+	 * slot id and by controller type plus attached device node, see
+	 * slot_index_rebuild(). They make find_slot_by_slot_path() and
+	 * find_slot_by_device_name() independent of the total slot count.
+	 * The maps only reference items owned by slots_list.
+	 */
+	struct hash_map slot_id_map;
+	struct hash_map slot_devnode_map;
+
+	/**
+	 * Membership set of the block devices currently on tail_list, keyed
+	 * by the canonical sysfs path. Makes duplicate detection during RAID
+	 * member discovery and the raid-members-only filter O(1) per device
+	 * instead of a tail list walk each. Cleared together with tail_list.
+	 */
+	struct hash_map tail_block_map;
+
+	/**
+	 * Poll watches on the md/sync_action and md/degraded attributes of
+	 * discovered RAID devices, keyed by the array sysfs path. Sysfs
+	 * signals attribute changes with POLLPRI, the epoll descriptor
+	 * aggregates the attribute fds so the daemon event loop can nest it,
+	 * see sysfs_raid_event_fd(). Watches persist across rescans and are
+	 * dropped by sysfs_reset() or when the array vanishes. The map only
+	 * references items owned by raid_watch_list.
+	 */
+	int raid_wd_epoll;
+	struct list raid_watch_list;
+	struct hash_map raid_watch_map;
+
+	/**
+	 * Non-blocking inotify descriptor watching the attention attribute
+	 * of discovered PCI hotplug slots. Events invalidate the attention
+	 * value cached in struct pci_slot, so the steady-state VMD path
+	 * serves slot state without any file I/O, see
+	 * pci_slot_attention_drain(). Watches are added by pci_slot_init()
+	 * and removed by pci_slot_fini().
+	 */
+	int pci_ino_fd;
+
+	/**
+	 * Fingerprints of scanned sysfs directories taken during the last
+	 * scan. Used by sysfs_rescan() to detect topology changes and to skip
+	 * the full device model rebuild when nothing changed between scans.
+	 */
+	uint64_t dir_fp[SCAN_FP_COUNT];
+
+	/**
+	 * Non-zero if dir_fp content is valid. Cleared by sysfs_reset() to
+	 * force a full rebuild on next sysfs_rescan() call.
+	 */
+	int fp_valid;
 };
 
 
@@ -104,6 +214,19 @@ void sysfs_reset(struct led_ctx *ctx);
  */
 void sysfs_scan(struct led_ctx *ctx);
 
+/**
+ * @brief Updates internal lists, avoiding full rebuild when possible.
+ *
+ * This function compares fingerprints of scanned sysfs directories against
+ * values remembered from the previous scan. If no device has been added to or
+ * removed from the system since then, existing block device, controller,
+ * enclosure and slot lists are retained and only RAID state (which changes
+ * without altering the sysfs topology) is re-read. Otherwise the function
+ * falls back to the full teardown and rebuild, see sysfs_reset() and
+ * sysfs_scan().
+ */
+void sysfs_rescan(struct led_ctx *ctx);
+
 /**
  * The function returns list of enclosure devices attached to SAS/SCSI storage
  * controller(s).
@@ -111,9 +234,9 @@ void sysfs_scan(struct led_ctx *ctx);
 const struct list *sysfs_get_enclosure_devices(struct led_ctx *ctx);
 
 /**
- * The function returns list of controller devices present in the system.
+ * The function returns vector of controller devices present in the system.
  */
-const struct list *sysfs_get_cntrl_devices(struct led_ctx *ctx);
+const struct vector *sysfs_get_cntrl_devices(struct led_ctx *ctx);
 
 /**
  * The function returns list of RAID volumes present in the system.
@@ -121,9 +244,9 @@ const struct list *sysfs_get_cntrl_devices(struct led_ctx *ctx);
 const struct list *sysfs_get_volumes(struct led_ctx *ctx);
 
 /**
- * The function returns list of block devices present in the system.
+ * The function returns vector of block devices present in the system.
  */
-const struct list *sysfs_get_block_devices(struct led_ctx *ctx);
+const struct vector *sysfs_get_block_devices(struct led_ctx *ctx);
 
 /**
  * The function returns list of pci slots present in the system.
@@ -131,10 +254,10 @@ const struct list *sysfs_get_block_devices(struct led_ctx *ctx);
 const struct list *sysfs_get_pci_slots(struct led_ctx *ctx);
 
 /**
- * The function returns list of slots for supported controllers
+ * The function returns vector of slots for supported controllers
  * present in the system.
  */
-const struct list *sysfs_get_slots(struct led_ctx *ctx);
+const struct vector *sysfs_get_slots(struct led_ctx *ctx);
 
 /**
  * The function checks if the given storage controller is attached to enclosure
@@ -142,6 +265,34 @@ const struct list *sysfs_get_slots(struct led_ctx *ctx);
  */
 int sysfs_enclosure_attached_to_cntrl(struct led_ctx *ctx, const char *path);
 
+/**
+ * @brief Returns the descriptor aggregating the RAID attribute watches.
+ *
+ * The returned epoll descriptor becomes readable when md/sync_action or
+ * md/degraded of a watched array signals a change. Add it to the daemon event
+ * loop and call sysfs_raid_events_handle() when it fires.
+ *
+ * @param[in]    ctx    Library context.
+ *
+ * @return A descriptor suitable for poll/epoll, or -1 if watches could not
+ *         be set up.
+ */
+int sysfs_raid_event_fd(struct led_ctx *ctx);
+
+/**
+ * @brief Consumes pending RAID attribute change notifications.
+ *
+ * Re-reads the fired attributes, which re-arms the sysfs notification, and
+ * compares the values against the last read. Spurious wakeups are filtered
+ * out here, so the caller only needs to rescan when the function reports a
+ * change.
+ *
+ * @param[in]    ctx    Library context.
+ *
+ * @return Number of arrays whose state actually changed.
+ */
+int sysfs_raid_events_handle(struct led_ctx *ctx);
+
 /*
  * This function checks driver type.
  */
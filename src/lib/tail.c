@@ -7,12 +7,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #if _HAVE_DMALLOC_H
 #include <dmalloc.h>
 #endif
 
 #include "config.h"
+#include "libled_private.h"
 #include "list.h"
 #include "tail.h"
 #include "status.h"
@@ -20,64 +22,65 @@
 #include "utils.h"
 
 /**
+ * @brief Translates the content of state attribute, s may be NULL. The string
+ * is modified in place while splitting it on commas.
  */
-static unsigned char _get_state(const char *path)
+static unsigned char _get_state(char *s)
 {
-	char *p, *t, *s;
+	char *t;
 	unsigned char result = TAIL_STATE_UNKNOWN;
 
-	s = p = get_text(path, "state");
-	if (p) {
-		while (s) {
-			t = strchr(s, ',');
-			if (t)
-				*(t++) = '\0';
-			if (strcmp(s, "spare") == 0)
-				result |= TAIL_STATE_SPARE;
-			else if (strcmp(s, "in_sync") == 0)
-				result |= TAIL_STATE_IN_SYNC;
-			else if (strcmp(s, "faulty") == 0)
-				result |= TAIL_STATE_FAULTY;
-			else if (strcmp(s, "write_mostly") == 0)
-				result |= TAIL_STATE_WRITE_MOSTLY;
-			else if (strcmp(s, "blocked") == 0)
-				result |= TAIL_STATE_BLOCKED;
-			s = t;
-		}
-		free(p);
+	while (s) {
+		t = strchr(s, ',');
+		if (t)
+			*(t++) = '\0';
+		if (strcmp(s, "spare") == 0)
+			result |= TAIL_STATE_SPARE;
+		else if (strcmp(s, "in_sync") == 0)
+			result |= TAIL_STATE_IN_SYNC;
+		else if (strcmp(s, "faulty") == 0)
+			result |= TAIL_STATE_FAULTY;
+		else if (strcmp(s, "write_mostly") == 0)
+			result |= TAIL_STATE_WRITE_MOSTLY;
+		else if (strcmp(s, "blocked") == 0)
+			result |= TAIL_STATE_BLOCKED;
+		s = t;
 	}
 	return result;
 }
 
 /**
+ * @brief Translates the content of errors attribute, p may be NULL.
  */
-static unsigned int _get_errors(const char *path)
+static unsigned int _get_errors(const char *p)
 {
-	return get_int(path, 0, "errors");
+	int errors = 0;
+
+	if (p)
+		str_toi(&errors, p, NULL, 10);
+	return errors;
 }
 
 /**
+ * @brief Translates the content of slot attribute, p may be NULL.
  */
-static int _get_slot(const char *path, unsigned int *dest)
+static int _get_slot(const char *p, unsigned int *dest)
 {
 	int ret = 1;
 	unsigned int n;
-	char *p = get_text(path, "slot");
-
-	if (p) {
-		if (strcmp(p, "none") != 0)
-			if (str_toui(&n, p, NULL, 10) == 0) {
-				*dest = n;
-				ret = 0;
-			}
-		free(p);
-	}
+
+	if (p && strcmp(p, "none") != 0)
+		if (str_toui(&n, p, NULL, 10) == 0) {
+			*dest = n;
+			ret = 0;
+		}
 	return ret;
 }
 
 /**
  */
-static struct block_device *_get_block(const char *path, struct list *block_list)
+static struct block_device *_get_block(struct led_ctx *ctx, const char *path,
+				       struct vector *block_list)
 {
 	char temp[PATH_MAX];
 	char link[PATH_MAX];
@@ -100,7 +103,12 @@ static struct block_device *_get_block(const char *path, struct list *block_list
 		}
 	}
 
-	list_for_each(block_list, device) {
+	/* Block devices are indexed by their canonical sysfs path. */
+	device = hash_map_find(&ctx->sys.block_path_map, link);
+	if (device)
+		return device;
+
+	vector_for_each(block_list, device) {
 		if (strcmp(device->sysfs_path, link) == 0)
 			return device;
 	}
@@ -109,21 +117,35 @@ static struct block_device *_get_block(const char *path, struct list *block_list
 
 /**
  */
-struct tail_device *tail_device_init(const char *path, struct list *block_list)
+struct tail_device *tail_device_init(struct led_ctx *ctx, const char *path,
+				     struct vector *block_list)
 {
+	char state_buf[BUFFER_MAX], errors_buf[BUF_SZ_NUM], slot_buf[BUF_SZ_NUM];
+	struct sysfs_attr attrs[] = {
+		{.name = "state", .buf = state_buf, .buf_size = sizeof(state_buf)},
+		{.name = "errors", .buf = errors_buf, .buf_size = sizeof(errors_buf)},
+		{.name = "slot", .buf = slot_buf, .buf_size = sizeof(slot_buf)},
+	};
 	struct tail_device *device = NULL;
 	struct block_device *block;
+	int dirfd;
 
-	block = _get_block(path, block_list);
+	block = _get_block(ctx, path, block_list);
 	if (block) {
-		device = malloc(sizeof(struct tail_device));
-		if (device && _get_slot(path, &device->slot) == 0) {
+		/* All attributes live under one directory, read in one batch. */
+		dirfd = sysfs_open_dir(path);
+		sysfs_read_attrs(dirfd, attrs, ARRAY_SIZE(attrs));
+		if (dirfd >= 0)
+			close(dirfd);
+
+		device = arena_alloc(&ctx->raid_arena, sizeof(struct tail_device));
+		if (device && _get_slot(attrs[2].value, &device->slot) == 0) {
 			device->raid = NULL;
-			device->state = _get_state(path);
-			device->errors = _get_errors(path);
+			device->state = _get_state(attrs[0].value);
+			device->errors = _get_errors(attrs[1].value);
 			device->block = block;
 		} else {
-			free(device);
+			/* Arena memory, reclaimed on rescan. */
 			device = NULL;
 		}
 	}
@@ -131,8 +153,10 @@ struct tail_device *tail_device_init(const char *path, struct list *block_list)
 }
 
 /**
+ * Tail devices are drawn from the RAID state arena, their memory is released
+ * by arena reset on rescan. The function is kept as the tail list item free
+ * callback.
  */
-void tail_device_fini(struct tail_device *device)
+void tail_device_fini(struct tail_device *device __attribute__ ((unused)))
 {
-	free(device);
 }
@@ -27,8 +27,11 @@ struct tail_device {
 };
 
 /**
+ * The structure is allocated from the RAID state arena of the library
+ * context, its memory is released when the arena is reset on rescan.
  */
-struct tail_device *tail_device_init(const char *path, struct list *block_list);
+struct tail_device *tail_device_init(struct led_ctx *ctx, const char *path,
+				     struct vector *block_list);
 
 /**
  */
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "led/libled.h"
+#include "libled_private.h"
+#include "timing.h"
+
+/**
+ * This is internal array of timing module. It maps phases onto names used in
+ * the timing report.
+ */
+static const char * const timing_phase_names[TIMING_PHASE_COUNT] = {
+	[TIMING_SCAN_ENCLO]      = "scan enclosures",
+	[TIMING_SCAN_CNTRL]      = "scan controllers",
+	[TIMING_SCAN_PCI_SLOTS]  = "scan pci slots",
+	[TIMING_SCAN_BLOCK]      = "scan block devices",
+	[TIMING_SCAN_RAID]       = "scan raid devices",
+	[TIMING_SCAN_SLOTS]      = "scan slots",
+	[TIMING_SCAN_TAIL]       = "scan tail devices",
+	[TIMING_DETERMINE_TAILS] = "determine tails",
+	[TIMING_SEND_MSG]        = "controller send",
+	[TIMING_FLUSH_MSG]       = "controller flush",
+	[TIMING_FLUSH_DELLSSD]   = "flush dellssd",
+	[TIMING_FLUSH_VMD]       = "flush vmd",
+	[TIMING_FLUSH_SCSI]      = "flush scsi",
+	[TIMING_FLUSH_AHCI]      = "flush ahci",
+	[TIMING_FLUSH_NPEM]      = "flush npem",
+	[TIMING_FLUSH_AMD]       = "flush amd",
+	[TIMING_UDEV_EVENT]      = "udev event",
+};
+
+uint64_t timing_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Maps a latency onto its histogram bucket.
+ *
+ * Bucket i counts runs shorter than 2^i microseconds, see TIMING_HIST_BUCKETS.
+ */
+static int _hist_bucket(uint64_t delta_ns)
+{
+	uint64_t us = delta_ns / 1000;
+	int i;
+
+	for (i = 0; i < TIMING_HIST_BUCKETS - 1; i++)
+		if (us < (1ULL << i))
+			return i;
+	return TIMING_HIST_BUCKETS - 1;
+}
+
+uint64_t timing_add(struct led_ctx *ctx, enum timing_phase phase,
+		    uint64_t start_ns)
+{
+	uint64_t now = timing_now_ns();
+	uint64_t delta = now - start_ns;
+	struct phase_time *pt = &ctx->timing[phase];
+	uint64_t max;
+
+	/*
+	 * Flush phases are accounted from the per-controller threads of
+	 * led_flush(), keep the counters lock-free with relaxed atomics.
+	 */
+	__atomic_fetch_add(&pt->calls, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&pt->total_ns, delta, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&pt->hist[_hist_bucket(delta)], 1, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&pt->max_ns, __ATOMIC_RELAXED);
+	while (delta > max &&
+	       !__atomic_compare_exchange_n(&pt->max_ns, &max, delta, false,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	return now;
+}
+
+void timing_report(struct led_ctx *ctx)
+{
+	int i;
+
+	lib_log(ctx, LED_LOG_LEVEL_INFO,
+		"timing report: %-20s %10s %12s %12s %12s",
+		"phase", "calls", "total ms", "avg us", "max us");
+	for (i = 0; i < TIMING_PHASE_COUNT; i++) {
+		struct phase_time *pt = &ctx->timing[i];
+
+		if (pt->calls == 0)
+			continue;
+		lib_log(ctx, LED_LOG_LEVEL_INFO,
+			"timing report: %-20s %10llu %12.3f %12.1f %12.1f",
+			timing_phase_names[i], (unsigned long long)pt->calls,
+			pt->total_ns / 1e6, pt->total_ns / 1e3 / pt->calls,
+			pt->max_ns / 1e3);
+		pt->calls = 0;
+		pt->total_ns = 0;
+		pt->max_ns = 0;
+		memset(pt->hist, 0, sizeof(pt->hist));
+	}
+}
+
+/**
+ * @brief Prints a phase name with spaces turned into underscores, so it is
+ *        usable as a Prometheus label value without quoting surprises.
+ */
+static void _print_phase_label(FILE *f, const char *name)
+{
+	for (; *name; name++)
+		fputc(*name == ' ' ? '_' : *name, f);
+}
+
+int timing_stats_write(struct led_ctx *ctx, const char *path)
+{
+	char tmp_path[PATH_MAX];
+	FILE *f;
+	int i, b;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.new", path);
+	f = fopen(tmp_path, "w");
+	if (!f)
+		return -1;
+
+	fprintf(f, "# HELP ledmon_phase_duration_seconds "
+		"Wall time of instrumented scan and flush phases.\n");
+	fprintf(f, "# TYPE ledmon_phase_duration_seconds histogram\n");
+	for (i = 0; i < TIMING_PHASE_COUNT; i++) {
+		struct phase_time *pt = &ctx->timing[i];
+		uint64_t calls = __atomic_load_n(&pt->calls, __ATOMIC_RELAXED);
+		uint64_t cumulative = 0;
+
+		if (calls == 0)
+			continue;
+		for (b = 0; b < TIMING_HIST_BUCKETS - 1; b++) {
+			cumulative += __atomic_load_n(&pt->hist[b],
+						      __ATOMIC_RELAXED);
+			fprintf(f, "ledmon_phase_duration_seconds_bucket{phase=\"");
+			_print_phase_label(f, timing_phase_names[i]);
+			fprintf(f, "\",le=\"%g\"} %llu\n", (1ULL << b) / 1e6,
+				(unsigned long long)cumulative);
+		}
+		fprintf(f, "ledmon_phase_duration_seconds_bucket{phase=\"");
+		_print_phase_label(f, timing_phase_names[i]);
+		fprintf(f, "\",le=\"+Inf\"} %llu\n", (unsigned long long)calls);
+		fprintf(f, "ledmon_phase_duration_seconds_sum{phase=\"");
+		_print_phase_label(f, timing_phase_names[i]);
+		fprintf(f, "\"} %.9f\n",
+			__atomic_load_n(&pt->total_ns, __ATOMIC_RELAXED) / 1e9);
+		fprintf(f, "ledmon_phase_duration_seconds_count{phase=\"");
+		_print_phase_label(f, timing_phase_names[i]);
+		fprintf(f, "\"} %llu\n", (unsigned long long)calls);
+	}
+
+	if (fclose(f) != 0 || rename(tmp_path, path) != 0) {
+		unlink(tmp_path);
+		return -1;
+	}
+	return 0;
+}
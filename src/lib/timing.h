@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _TIMING_H_INCLUDED_
+#define _TIMING_H_INCLUDED_
+
+#include <stdint.h>
+
+struct led_ctx;
+
+/**
+ * Instrumented phases of the scan and flush paths. Scan phases map onto the
+ * directory walks done by sysfs_scan(), the send/flush phases cover the
+ * hardware write paths driven by the monitor loop.
+ */
+enum timing_phase {
+	TIMING_SCAN_ENCLO,
+	TIMING_SCAN_CNTRL,
+	TIMING_SCAN_PCI_SLOTS,
+	TIMING_SCAN_BLOCK,
+	TIMING_SCAN_RAID,
+	TIMING_SCAN_SLOTS,
+	TIMING_SCAN_TAIL,
+	TIMING_DETERMINE_TAILS,
+	TIMING_SEND_MSG,
+	TIMING_FLUSH_MSG,
+	TIMING_FLUSH_DELLSSD,
+	TIMING_FLUSH_VMD,
+	TIMING_FLUSH_SCSI,
+	TIMING_FLUSH_AHCI,
+	TIMING_FLUSH_NPEM,
+	TIMING_FLUSH_AMD,
+	TIMING_UDEV_EVENT,
+
+	TIMING_PHASE_COUNT
+};
+
+/**
+ * Number of latency histogram buckets per phase. Bucket i counts runs that
+ * took less than 2^i microseconds, runs above the last bound land in the
+ * last bucket.
+ */
+#define TIMING_HIST_BUCKETS	20
+
+/**
+ * @brief Accumulated wall time of a single instrumented phase.
+ *
+ * Counters are updated with relaxed atomics, the flush phases are accounted
+ * from the concurrent per-controller threads of led_flush().
+ */
+struct phase_time {
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t hist[TIMING_HIST_BUCKETS];
+};
+
+/**
+ * @brief Reads the monotonic clock.
+ *
+ * @return Current CLOCK_MONOTONIC time in nanoseconds.
+ */
+uint64_t timing_now_ns(void);
+
+/**
+ * @brief Accounts one completed phase run in the library context.
+ *
+ * The elapsed time since @p start_ns is added to the accumulated counters of
+ * the given phase. The current time is returned, so consecutive phases can be
+ * timed by chaining calls without re-reading the clock.
+ *
+ * @param[in]      ctx            Library context.
+ * @param[in]      phase          Phase the measured interval belongs to.
+ * @param[in]      start_ns       Monotonic start time of the phase.
+ *
+ * @return Current CLOCK_MONOTONIC time in nanoseconds.
+ */
+uint64_t timing_add(struct led_ctx *ctx, enum timing_phase phase,
+		    uint64_t start_ns);
+
+/**
+ * @brief Dumps accumulated timing counters to the library log.
+ *
+ * One line per phase: number of runs, total wall time, average and worst
+ * observed latency. Counters are reset afterwards, so consecutive dumps
+ * report disjoint intervals.
+ *
+ * @param[in]      ctx            Library context.
+ */
+void timing_report(struct led_ctx *ctx);
+
+/**
+ * @brief Writes accumulated timing counters as Prometheus textfile metrics.
+ *
+ * One histogram series per phase with latency buckets, sum and count. The
+ * file is written to a temporary name first and renamed into place, so
+ * scrapers never see a partial file. Counters are not reset, the export is
+ * cumulative; note that timing_report() does reset them.
+ *
+ * @param[in]      ctx            Library context.
+ * @param[in]      path           Destination path of the stats file.
+ *
+ * @return 0 if successful, otherwise -1.
+ */
+int timing_stats_write(struct led_ctx *ctx, const char *path);
+
+#endif /* _TIMING_H_INCLUDED_ */
@@ -0,0 +1,401 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "uring.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define _URING_KERNEL_SUPPORT 1
+#endif
+#endif
+
+#ifdef _URING_KERNEL_SUPPORT
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/**
+ * Submission queue size of a ring. Each attribute needs three entries
+ * (open, read, close), batches larger than the queue are submitted in
+ * chunks.
+ */
+#define URING_ENTRIES		256U
+#define URING_CHUNK_ATTRS	(URING_ENTRIES / 3U)
+
+/**
+ * One mapped ring. The submission and completion queues stay mapped for
+ * the lifetime of the owning thread.
+ */
+struct uring {
+	int fd;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring;
+	void *cq_ring;
+	size_t sq_ring_size;
+	size_t cq_ring_size;
+	size_t sqes_size;
+};
+
+/**
+ * Set once a completion proves the kernel lacks direct descriptor support
+ * (pre 5.15); every later batch falls back to the sequential reader
+ * without touching the ring again. Races on the flag are benign, it only
+ * ever goes from zero to one.
+ */
+static int _uring_broken;
+
+static pthread_key_t _uring_key;
+static pthread_once_t _uring_once = PTHREAD_ONCE_INIT;
+
+static int _io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int _io_uring_enter(int fd, unsigned int to_submit,
+			   unsigned int min_complete, unsigned int flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+static int _io_uring_register(int fd, unsigned int opcode, const void *arg,
+			      unsigned int nr_args)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void _uring_free(void *arg)
+{
+	struct uring *ring = arg;
+
+	if (!ring)
+		return;
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	free(ring);
+}
+
+static void _uring_key_init(void)
+{
+	if (pthread_key_create(&_uring_key, _uring_free) != 0)
+		_uring_broken = 1;
+}
+
+static struct uring *_uring_create(void)
+{
+	int files[URING_CHUNK_ATTRS];
+	struct io_uring_params p;
+	struct uring *ring;
+	size_t i;
+
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+	ring->fd = -1;
+
+	memset(&p, 0, sizeof(p));
+	ring->fd = _io_uring_setup(URING_ENTRIES, &p);
+	if (ring->fd < 0)
+		goto error;
+
+	ring->sq_ring_size = p.sq_off.array +
+			     p.sq_entries * sizeof(unsigned int);
+	ring->cq_ring_size = p.cq_off.cqes +
+			     p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_ring_size > ring->sq_ring_size)
+			ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size,
+			     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			     ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		ring->sq_ring = NULL;
+		goto error;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_ring = ring->sq_ring;
+	} else {
+		ring->cq_ring = mmap(NULL, ring->cq_ring_size,
+				     PROT_READ | PROT_WRITE,
+				     MAP_SHARED | MAP_POPULATE,
+				     ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cq_ring == MAP_FAILED) {
+			ring->cq_ring = NULL;
+			goto error;
+		}
+	}
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, ring->fd,
+			  IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = NULL;
+		goto error;
+	}
+
+	ring->sq_head = (unsigned int *)((char *)ring->sq_ring + p.sq_off.head);
+	ring->sq_tail = (unsigned int *)((char *)ring->sq_ring + p.sq_off.tail);
+	ring->sq_mask = (unsigned int *)((char *)ring->sq_ring +
+					 p.sq_off.ring_mask);
+	ring->sq_array = (unsigned int *)((char *)ring->sq_ring +
+					  p.sq_off.array);
+	ring->cq_head = (unsigned int *)((char *)ring->cq_ring + p.cq_off.head);
+	ring->cq_tail = (unsigned int *)((char *)ring->cq_ring + p.cq_off.tail);
+	ring->cq_mask = (unsigned int *)((char *)ring->cq_ring +
+					 p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring +
+					     p.cq_off.cqes);
+
+	/*
+	 * Sparse table of direct descriptor slots, one per in-flight
+	 * attribute. The open operations instantiate the slots, close
+	 * releases them without the files ever becoming process fds.
+	 */
+	for (i = 0; i < URING_CHUNK_ATTRS; i++)
+		files[i] = -1;
+	if (_io_uring_register(ring->fd, IORING_REGISTER_FILES, files,
+			       URING_CHUNK_ATTRS) < 0)
+		goto error;
+
+	return ring;
+
+error:
+	_uring_free(ring);
+	return NULL;
+}
+
+/**
+ * @brief Returns the ring of the calling thread, created on first use.
+ */
+static struct uring *_uring_get(void)
+{
+	struct uring *ring;
+
+	pthread_once(&_uring_once, _uring_key_init);
+	if (_uring_broken)
+		return NULL;
+
+	ring = pthread_getspecific(_uring_key);
+	if (ring)
+		return ring;
+
+	ring = _uring_create();
+	if (!ring || pthread_setspecific(_uring_key, ring) != 0) {
+		_uring_free(ring);
+		_uring_broken = 1;
+		return NULL;
+	}
+	return ring;
+}
+
+/**
+ * @brief Appends a zeroed submission entry to the ring.
+ *
+ * The tail is published immediately; without SQPOLL the kernel only looks
+ * at the queue inside io_uring_enter(), after the caller filled the entry.
+ */
+static struct io_uring_sqe *_uring_sqe(struct uring *ring)
+{
+	unsigned int tail = *ring->sq_tail;
+	unsigned int index = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	ring->sq_array[index] = index;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	return sqe;
+}
+
+/**
+ * The attribute index and chain stage are packed into the completion user
+ * data, only read completions carry payload worth acting on.
+ */
+enum uring_stage {
+	URING_STAGE_OPEN,
+	URING_STAGE_READ,
+	URING_STAGE_CLOSE,
+};
+
+/**
+ * @brief Submits one chunk of attribute chains and applies the results.
+ *
+ * @return Number of attributes read, or -1 when a completion shows the
+ *         kernel does not support the chains.
+ */
+static int _uring_run_chunk(struct uring *ring, int dirfd,
+			    struct sysfs_attr *attrs, size_t count)
+{
+	unsigned int stale[URING_CHUNK_ATTRS];
+	unsigned int submitted = 0, stale_cnt = 0, head;
+	int read_cnt = 0, ret;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		struct sysfs_attr *attr = &attrs[i];
+		struct io_uring_sqe *sqe;
+
+		attr->value = NULL;
+		if (!attr->buf || attr->buf_size < 1)
+			continue;
+		memset(attr->buf, 0, attr->buf_size);
+
+		/*
+		 * Open into direct slot i, read from it, close it. The link
+		 * flag cancels the rest of a chain when a stage fails, a
+		 * missing attribute simply leaves its value NULL.
+		 */
+		sqe = _uring_sqe(ring);
+		sqe->opcode = IORING_OP_OPENAT;
+		sqe->fd = dirfd;
+		sqe->addr = (uint64_t)(uintptr_t)attr->name;
+		sqe->open_flags = O_RDONLY;
+		sqe->file_index = i + 1;
+		sqe->flags = IOSQE_IO_LINK;
+		sqe->user_data = ((uint64_t)i << 2) | URING_STAGE_OPEN;
+
+		sqe = _uring_sqe(ring);
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = i;
+		sqe->addr = (uint64_t)(uintptr_t)attr->buf;
+		sqe->len = attr->buf_size - 1;
+		sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+		sqe->user_data = ((uint64_t)i << 2) | URING_STAGE_READ;
+
+		sqe = _uring_sqe(ring);
+		sqe->opcode = IORING_OP_CLOSE;
+		sqe->file_index = i + 1;
+		sqe->user_data = ((uint64_t)i << 2) | URING_STAGE_CLOSE;
+
+		submitted += 3;
+	}
+	if (!submitted)
+		return 0;
+
+	do {
+		ret = _io_uring_enter(ring->fd, submitted, submitted,
+				      IORING_ENTER_GETEVENTS);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0)
+		return -1;
+
+	head = *ring->cq_head;
+	while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+		size_t attr_index = cqe->user_data >> 2;
+		enum uring_stage stage = cqe->user_data & 3;
+		struct sysfs_attr *attr = &attrs[attr_index];
+
+		head++;
+		if (stage == URING_STAGE_OPEN &&
+		    (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP))
+			read_cnt = -1;
+		if (stage == URING_STAGE_CLOSE && cqe->res < 0 &&
+		    stale_cnt < URING_CHUNK_ATTRS)
+			stale[stale_cnt++] = attr_index;
+		if (read_cnt < 0 || stage != URING_STAGE_READ || cqe->res <= 0)
+			continue;
+
+		attr->buf[cqe->res] = '\0';
+		*strchrnul(attr->buf, '\n') = '\0';
+		attr->value = attr->buf;
+		read_cnt++;
+	}
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+	/*
+	 * A failed read cancels its linked close and leaves the direct
+	 * descriptor slot occupied, so every later open into the slot would
+	 * fail. Release the slots of cancelled closes explicitly; clearing
+	 * a slot the cancelled open never filled is a no-op.
+	 */
+	for (i = 0; read_cnt >= 0 && i < stale_cnt; i++) {
+		struct io_uring_files_update up;
+		int fd = -1;
+
+		memset(&up, 0, sizeof(up));
+		up.offset = stale[i];
+		up.fds = (uint64_t)(uintptr_t)&fd;
+		if (_io_uring_register(ring->fd, IORING_REGISTER_FILES_UPDATE,
+				       &up, 1) < 0)
+			return -1;
+	}
+
+	return read_cnt;
+}
+
+/*
+ * Reads a set of sysfs attributes through io_uring. See uring.h for
+ * details.
+ */
+int uring_read_attrs(int dirfd, struct sysfs_attr *attrs, size_t count)
+{
+	struct uring *ring;
+	int read_cnt = 0;
+	size_t done = 0;
+
+	if (_uring_broken || dirfd < 0)
+		return -1;
+	ring = _uring_get();
+	if (!ring)
+		return -1;
+
+	while (done < count) {
+		size_t chunk = count - done;
+		int ret;
+
+		if (chunk > URING_CHUNK_ATTRS)
+			chunk = URING_CHUNK_ATTRS;
+		ret = _uring_run_chunk(ring, dirfd, attrs + done, chunk);
+		if (ret < 0) {
+			_uring_broken = 1;
+			return -1;
+		}
+		read_cnt += ret;
+		done += chunk;
+	}
+	return read_cnt;
+}
+
+#else				/* _URING_KERNEL_SUPPORT */
+
+/*
+ * Built against headers without io_uring, the sequential reader handles
+ * everything.
+ */
+int uring_read_attrs(int dirfd, struct sysfs_attr *attrs, size_t count)
+{
+	(void)dirfd;
+	(void)attrs;
+	(void)count;
+	return -1;
+}
+
+#endif				/* _URING_KERNEL_SUPPORT */
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+#ifndef _URING_H_INCLUDED_
+#define _URING_H_INCLUDED_
+
+#include <stddef.h>
+
+#include "utils.h"
+
+/**
+ * io_uring backend of sysfs_read_attrs(). Every attribute becomes a linked
+ * open/read/close chain and the whole batch is submitted as one ring
+ * operation, so reading N attributes costs a couple of io_uring_enter()
+ * calls instead of 3*N syscalls. Rings are created lazily per thread and
+ * reused across batches, matching the per-thread device probing in
+ * sysfs.c. Built directly on the kernel interface, no liburing needed.
+ */
+
+/**
+ * @brief Reads a set of sysfs attributes through io_uring.
+ *
+ * Semantics match sysfs_read_attrs(): attributes are read relative to the
+ * directory descriptor, missing ones only leave their value field NULL.
+ *
+ * @param[in]     dirfd       Directory descriptor from sysfs_open_dir().
+ * @param[in,out] attrs       Array of attribute requests to fill in.
+ * @param[in]     count       Number of elements in attrs array.
+ *
+ * @return Number of attributes successfully read, or -1 when io_uring is
+ *         unavailable on this kernel; the caller then falls back to the
+ *         sequential reader. Once -1 is returned the backend stays
+ *         disabled for the process.
+ */
+int uring_read_attrs(int dirfd, struct sysfs_attr *attrs, size_t count);
+
+#endif				/* _URING_H_INCLUDED_ */
@@ -8,7 +8,10 @@
 #include <inttypes.h>
 #include <libgen.h>
 #include <limits.h>
+#include <pthread.h>
 #include <regex.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -28,6 +31,7 @@
 #include "config.h"
 #include "list.h"
 #include "status.h"
+#include "uring.h"
 #include "utils.h"
 
 #include <lib/libled_internal.h>
@@ -48,6 +52,34 @@ struct log_level_info log_level_infos[] = {
 		[LED_LOG_LEVEL_ERROR] = {PREFIX_ERROR, LOG_ERR}
 };
 
+/*
+ * Root directory the sysfs accessors operate under. Normally the live /sys
+ * tree; pointing LEDMON_SYSFS_ROOT at an extracted snapshot (see
+ * tests/bench/sysfs-snapshot.sh) replays a recorded topology instead, which
+ * makes scans reproducible for benchmarking and bisection. Resolved once on
+ * first use.
+ */
+static const char *_sysfs_root;
+
+const char *sysfs_path(const char *path)
+{
+	static char bufs[4][PATH_MAX];
+	static unsigned int next;
+	char *buf;
+
+	if (!_sysfs_root) {
+		_sysfs_root = getenv("LEDMON_SYSFS_ROOT");
+		if (!_sysfs_root)
+			_sysfs_root = "";
+	}
+	if (_sysfs_root[0] == '\0')
+		return path;
+
+	buf = bufs[next++ % ARRAY_SIZE(bufs)];
+	snprintf(buf, PATH_MAX, "%s%s", _sysfs_root, path);
+	return buf;
+}
+
 /*
  * Function returns a content of a text file. See utils.h for details.
  */
@@ -262,6 +294,63 @@ char *buf_read_to_dest(const char *path, char *dest, size_t dest_size)
 	return NULL;
 }
 
+/*
+ * Opens a sysfs directory for batched attribute access. See utils.h for
+ * details.
+ */
+int sysfs_open_dir(const char *path)
+{
+	return open(path, O_RDONLY | O_DIRECTORY);
+}
+
+/*
+ * Reads a set of attributes from one sysfs directory. See utils.h for
+ * details.
+ */
+int sysfs_read_attrs(int dirfd, struct sysfs_attr *attrs, size_t count)
+{
+	int read_cnt = 0;
+	size_t i;
+
+	/*
+	 * Batches are submitted as one io_uring operation where the kernel
+	 * supports it; uring_read_attrs() returns -1 once when it does not
+	 * and the sequential loop below takes over for good.
+	 */
+	if (count > 1) {
+		read_cnt = uring_read_attrs(dirfd, attrs, count);
+		if (read_cnt >= 0)
+			return read_cnt;
+		read_cnt = 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct sysfs_attr *attr = &attrs[i];
+		ssize_t size;
+		char *t;
+		int fd;
+
+		attr->value = NULL;
+		if (dirfd < 0 || !attr->buf || attr->buf_size < 1)
+			continue;
+		memset(attr->buf, 0, attr->buf_size);
+
+		fd = openat(dirfd, attr->name, O_RDONLY);
+		if (fd < 0)
+			continue;
+		size = read(fd, attr->buf, attr->buf_size - 1);
+		close(fd);
+		if (size <= 0)
+			continue;
+
+		attr->buf[size] = '\0';
+		t = strchrnul(attr->buf, '\n');
+		*t = '\0';
+		attr->value = attr->buf;
+		read_cnt++;
+	}
+	return read_cnt;
+}
 
 /**
  */
@@ -284,23 +373,6 @@ void get_id(const char *path, struct device_id *did)
 	}
 }
 
-/**
- */
-static void _log_timestamp(int log_fd)
-{
-	time_t timestamp;
-	struct tm *t;
-	char buf[30];
-
-	timestamp = time(NULL);
-	t = localtime(&timestamp);
-
-	if (t) {
-		strftime(buf, sizeof(buf), TIMESTAMP_PATTERN, t);
-		dprintf(log_fd, "%s", buf);
-	}
-}
-
 /**
  */
 int log_open(struct ledmon_conf *conf)
@@ -318,6 +390,7 @@ int log_open(struct ledmon_conf *conf)
  */
 void log_close(struct ledmon_conf *conf)
 {
+	log_drain();
 	if (conf->s_log) {
 		fflush(conf->s_log);
 		fclose(conf->s_log);
@@ -326,6 +399,152 @@ void log_close(struct ledmon_conf *conf)
 }
 
 
+/*
+ * Asynchronous log sink. The formatting callers stay on the hot path, but
+ * the write()/fsync() of the message is done by a background writer thread
+ * fed through a lock-free ring. A full ring drops the message and counts it
+ * instead of blocking the producer. Errors and worse are still written
+ * synchronously, they are rare and must survive a crash of the process.
+ */
+#define LOG_RING_ENTRIES	256	/* power of two */
+#define LOG_RING_MSG_MAX	1024
+
+struct log_ring_entry {
+	int fd;
+	int priority;
+	const char *prefix;	/* points into static log_level_infos */
+	time_t timestamp;
+	int ready;		/* atomic: message complete, writer may go */
+	char msg[LOG_RING_MSG_MAX];
+};
+
+static struct log_ring_entry log_ring[LOG_RING_ENTRIES];
+static uint64_t log_ring_head;		/* next free slot, claimed by producers */
+static uint64_t log_ring_tail;		/* next slot to write, writer thread only */
+static uint64_t log_ring_dropped;	/* messages lost to a full ring */
+static sem_t log_ring_sem;
+static pthread_once_t log_ring_once = PTHREAD_ONCE_INIT;
+static int log_ring_active;
+
+/**
+ * @brief Writes one message to the log fd and syslog, with timestamp taken
+ *        when the message was produced.
+ */
+static void _log_write(int log_fd, int priority, const char *prefix,
+		       time_t timestamp, const char *msg)
+{
+	struct tm *t = localtime(&timestamp);
+	char buf[30];
+
+	if (t) {
+		strftime(buf, sizeof(buf), TIMESTAMP_PATTERN, t);
+		dprintf(log_fd, "%s", buf);
+	}
+	dprintf(log_fd, "%s", prefix);
+	dprintf(log_fd, "%s\n", msg);
+	fsync(log_fd);
+	syslog(priority, "%s", msg);
+}
+
+static void *_log_writer(void *arg __attribute__((unused)))
+{
+	for (;;) {
+		struct log_ring_entry *e;
+		uint64_t dropped;
+
+		sem_wait(&log_ring_sem);
+		e = &log_ring[log_ring_tail % LOG_RING_ENTRIES];
+		/* Producers may complete out of order, wait for this slot. */
+		while (!__atomic_load_n(&e->ready, __ATOMIC_ACQUIRE))
+			sched_yield();
+		_log_write(e->fd, e->priority, e->prefix, e->timestamp,
+			   e->msg);
+		__atomic_store_n(&e->ready, 0, __ATOMIC_RELEASE);
+		__atomic_store_n(&log_ring_tail, log_ring_tail + 1,
+				 __ATOMIC_RELEASE);
+
+		dropped = __atomic_exchange_n(&log_ring_dropped, 0,
+					      __ATOMIC_RELAXED);
+		if (dropped)
+			dprintf(e->fd, "dropped %llu log message(s), "
+				"ring buffer was full\n",
+				(unsigned long long)dropped);
+	}
+	return NULL;
+}
+
+static void _log_ring_init(void)
+{
+	pthread_t thread;
+
+	if (sem_init(&log_ring_sem, 0, 0) != 0)
+		return;
+	if (pthread_create(&thread, NULL, _log_writer, NULL) != 0) {
+		sem_destroy(&log_ring_sem);
+		return;
+	}
+	pthread_detach(thread);
+	log_ring_active = 1;
+}
+
+/**
+ * @brief Queues one formatted message for the writer thread.
+ *
+ * @return 1 if queued or dropped by overflow, 0 if the caller must write
+ *         synchronously because the writer thread could not be started.
+ */
+static int _log_enqueue(int log_fd, int priority, const char *prefix,
+			const char *msg)
+{
+	struct log_ring_entry *e;
+	uint64_t head, tail;
+
+	pthread_once(&log_ring_once, _log_ring_init);
+	if (!log_ring_active)
+		return 0;
+
+	for (;;) {
+		head = __atomic_load_n(&log_ring_head, __ATOMIC_RELAXED);
+		tail = __atomic_load_n(&log_ring_tail, __ATOMIC_ACQUIRE);
+		if (head - tail >= LOG_RING_ENTRIES) {
+			/* Full: count the loss, never block the hot path. */
+			__atomic_fetch_add(&log_ring_dropped, 1,
+					   __ATOMIC_RELAXED);
+			return 1;
+		}
+		if (__atomic_compare_exchange_n(&log_ring_head, &head,
+						head + 1, false,
+						__ATOMIC_ACQ_REL,
+						__ATOMIC_RELAXED))
+			break;
+	}
+
+	e = &log_ring[head % LOG_RING_ENTRIES];
+	e->fd = log_fd;
+	e->priority = priority;
+	e->prefix = prefix;
+	e->timestamp = time(NULL);
+	snprintf(e->msg, sizeof(e->msg), "%s", msg);
+	__atomic_store_n(&e->ready, 1, __ATOMIC_RELEASE);
+	sem_post(&log_ring_sem);
+	return 1;
+}
+
+void log_drain(void)
+{
+	int i;
+
+	if (!log_ring_active)
+		return;
+	/* Bounded wait, the writer usually catches up within microseconds. */
+	for (i = 0; i < 1000; i++) {
+		if (__atomic_load_n(&log_ring_head, __ATOMIC_RELAXED) ==
+		    __atomic_load_n(&log_ring_tail, __ATOMIC_ACQUIRE))
+			return;
+		usleep(1000);
+	}
+}
+
 void _common_log(int log_fd, enum led_log_level_enum config_level, enum led_log_level_enum loglevel,
 		const char *buf, va_list list)
 {
@@ -334,11 +553,10 @@ void _common_log(int log_fd, enum led_log_level_enum config_level, enum led_log_
 		struct log_level_info *lli = &log_level_infos[loglevel];
 
 		vsnprintf(msg, sizeof(msg), buf, list);
-		_log_timestamp(log_fd);
-		dprintf(log_fd, "%s", lli->prefix);
-		dprintf(log_fd, "%s\n", msg);
-		fsync(log_fd);
-		syslog(lli->priority, "%s", msg);
+		if (loglevel <= LED_LOG_LEVEL_ERROR ||
+		    !_log_enqueue(log_fd, lli->priority, lli->prefix, msg))
+			_log_write(log_fd, lli->priority, lli->prefix,
+				   time(NULL), msg);
 	}
 }
 
@@ -575,6 +793,7 @@ struct option longopt_all[] = {
 	[OPT_PRINT_PARAM]  = {"print", required_argument, NULL, 'r'},
 	[OPT_TEST]         = {"test", no_argument, NULL, 'T'},
 	[OPT_IBPI]         = {"ibpi", no_argument, NULL, 'I' },
+	[OPT_BATCH]        = {"batch", required_argument, NULL, 'B'},
 	[OPT_NULL_ELEMENT] = {NULL, no_argument, NULL, '\0'}
 };
 
@@ -228,6 +228,23 @@ int put_int(const char *path, const char *name, int value);
  */
 int scan_dir(const char *path, struct list *result);
 
+/**
+ * @brief Maps an absolute sysfs path under the configured sysfs root.
+ *
+ * By default the path is returned unchanged and the live /sys tree is used.
+ * When the LEDMON_SYSFS_ROOT environment variable names a directory holding
+ * an extracted sysfs snapshot, the path is prefixed with it, so scans replay
+ * the recorded topology instead of the running host.
+ *
+ * The result may point to one of a few internal static buffers, valid until
+ * the fourth following call. Not thread safe; intended for the scan paths.
+ *
+ * @param[in]      path           Absolute path below /sys.
+ *
+ * @return Path to use for the access, possibly redirected.
+ */
+const char *sysfs_path(const char *path);
+
 /**
  * @brief Writes a text to file.
  *
@@ -275,6 +292,61 @@ char *buf_read(const char *path);
  */
 char *buf_read_to_dest(const char *path, char *dest, size_t dest_size);
 
+/**
+ * Single attribute request for sysfs_read_attrs(). The attribute file name is
+ * resolved relative to a directory descriptor, so batched readers do not
+ * reassemble the directory part of the path for every attribute.
+ */
+struct sysfs_attr {
+	/**
+	 * Name of the attribute file, relative to the directory descriptor.
+	 * May contain a subdirectory, e.g. "md/level".
+	 */
+	const char *name;
+
+	/**
+	 * Caller supplied destination buffer for the attribute content.
+	 */
+	char *buf;
+
+	/**
+	 * Size of the destination buffer.
+	 */
+	size_t buf_size;
+
+	/**
+	 * Points to buf when the attribute was read, text is truncated on the
+	 * first new line character. NULL if the attribute is missing or empty.
+	 */
+	char *value;
+};
+
+/**
+ * @brief Opens a sysfs directory for batched attribute access.
+ *
+ * @param[in]     path        Path to a sysfs directory.
+ *
+ * @return Directory descriptor if successful, otherwise -1. The descriptor
+ *         must be released with close().
+ */
+int sysfs_open_dir(const char *path);
+
+/**
+ * @brief Reads a set of attributes from one sysfs directory.
+ *
+ * This function reads every requested attribute relative to the given
+ * directory descriptor using openat(), so the directory path is resolved by
+ * the kernel once instead of per attribute. A missing or empty attribute does
+ * not fail the batch, it only leaves the value field of its entry NULL.
+ *
+ * @param[in]     dirfd       Directory descriptor from sysfs_open_dir().
+ * @param[in,out] attrs       Array of attribute requests to fill in.
+ * @param[in]     count       Number of elements in attrs array.
+ *
+ * @return Number of attributes successfully read.
+ */
+int sysfs_read_attrs(int dirfd, struct sysfs_attr *attrs, size_t count);
+
 /**
  * @brief Gets major and minor of device.
  *
@@ -312,6 +384,17 @@ int log_open(struct ledmon_conf *conf);
  */
 void log_close(struct ledmon_conf *conf);
 
+/**
+ * @brief Waits until the asynchronous log writer has caught up.
+ *
+ * Messages below error level are written by a background thread, call this
+ * before process exit so queued messages are not lost. The wait is bounded,
+ * a stuck log destination cannot block shutdown.
+ *
+ * @return The function does not return a value.
+ */
+void log_drain(void);
+
 /**
  * @brief Common logging function for both lib_log & _log functions.
  *
@@ -473,6 +556,7 @@ enum opt {
 	OPT_PRINT_PARAM,
 	OPT_IBPI,
 	OPT_TEST,
+	OPT_BATCH,
 	OPT_NULL_ELEMENT
 };
 
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2022 Intel Corporation.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "vector.h"
+#include "libled_private.h"
+
+#define VECTOR_INITIAL_CAPACITY		16
+
+static bool _vector_grow(struct vector *vec)
+{
+	size_t capacity;
+	void **items;
+
+	if (vec->capacity)
+		capacity = vec->capacity * 2;
+	else
+		capacity = VECTOR_INITIAL_CAPACITY;
+	items = realloc(vec->items, capacity * sizeof(*items));
+	if (!items)
+		return false;
+	vec->items = items;
+	vec->capacity = capacity;
+	return true;
+}
+
+bool vector_append(struct vector *vec, void *item)
+{
+	assert(item != NULL);
+	if (vec->count == vec->capacity && !_vector_grow(vec))
+		return false;
+	vec->items[vec->count++] = item;
+	return true;
+}
+
+void vector_append_ctx(struct vector *vec, void *item, struct led_ctx *ctx)
+{
+	if (!vector_append(vec, item))
+		ctx->deferred_error = LED_STATUS_OUT_OF_MEMORY;
+}
+
+void vector_erase(struct vector *vec)
+{
+	size_t i;
+
+	for (i = 0; i < vec->count; i++)
+		vec->item_free(vec->items[i]);
+	vec->count = 0;
+}
+
+void vector_delete_at(struct vector *vec, size_t index)
+{
+	if (index >= vec->count)
+		return;
+	vec->item_free(vec->items[index]);
+	memmove(&vec->items[index], &vec->items[index + 1],
+		(vec->count - index - 1) * sizeof(*vec->items));
+	vec->count--;
+}
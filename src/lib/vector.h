@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2022 Intel Corporation.
+
+#ifndef _VECTOR_H_INCLUDED_
+#define _VECTOR_H_INCLUDED_
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "list.h"
+
+struct led_ctx;
+
+/**
+ * Contiguous growable array of item pointers, a cache friendly companion of
+ * struct list for scan-built, read-mostly collections. Iteration walks one
+ * packed pointer array instead of chasing per-node heap allocations. Items
+ * stay individually allocated, so pointers handed out to other modules (hash
+ * map indexes, slot back references) remain stable while the vector grows.
+ */
+struct vector {
+	void **items;
+	size_t count;
+	size_t capacity;
+	item_free_t item_free;
+};
+
+#define vector_for_each(__vec, __item) \
+	for (size_t __i = 0; \
+	     __i < (__vec)->count && \
+	     (((__item) = (__vec)->items[__i]) || (!(__item))); \
+	     __i++)
+
+/**
+ * @brief Initializes a vector object.
+ *
+ * Initializes a vector object to reflect an empty state. No storage is
+ * allocated until the first element is appended.
+ *
+ * @param[in]      vec            pointer to a vector object.
+ * @param[in]      item_free_fn   custom callback for deallocating items.
+ *                                If NULL, free() will be used.
+ */
+static inline void vector_init(struct vector *vec, item_free_t item_free_fn)
+{
+	vec->items = NULL;
+	vec->count = 0;
+	vec->capacity = 0;
+	if (item_free_fn)
+		vec->item_free = item_free_fn;
+	else
+		vec->item_free = free;
+}
+
+/**
+ * @brief Appends an element to the end of the vector.
+ *
+ * @param[in]      vec            pointer to a vector object.
+ * @param[in]      item           data item to be appended to the vector.
+ *
+ * @return true on success, else false on memory allocation failure.
+ */
+bool vector_append(struct vector *vec, void *item);
+
+/**
+ * @brief Appends an element to the end of the vector.
+ *
+ * @param[in]      vec            pointer to a vector object.
+ * @param[in]      item           data item to be appended to the vector.
+ * @param[in]      ctx            library context (sets ctx deferred error).
+ */
+void vector_append_ctx(struct vector *vec, void *item, struct led_ctx *ctx);
+
+/**
+ * @brief Clears a vector and frees the items it contains.
+ *
+ * This function frees the data items held by the vector and empties it. The
+ * item storage is kept, so a vector refilled on the next scan does not have
+ * to grow again.
+ *
+ * @param[in]      vec            pointer to a vector object.
+ */
+void vector_erase(struct vector *vec);
+
+/**
+ * @brief Removes the element at the given index and frees it.
+ *
+ * The elements following the removed one are shifted down, iteration order
+ * is preserved.
+ *
+ * @param[in]      vec            pointer to a vector object.
+ * @param[in]      index          index of the element to remove.
+ */
+void vector_delete_at(struct vector *vec, size_t index);
+
+/**
+ * @brief Clears a vector.
+ *
+ * This function empties the vector without freeing the data items, to do
+ * that use vector_erase().
+ *
+ * @param[in]      vec            pointer to a vector object.
+ */
+static inline void vector_clear(struct vector *vec)
+{
+	vec->count = 0;
+}
+
+/**
+ * @brief Releases a vector.
+ *
+ * This function frees the data items and releases the item storage. The
+ * vector is left in the empty, initialized state.
+ *
+ * @param[in]      vec            pointer to a vector object.
+ */
+static inline void vector_fini(struct vector *vec)
+{
+	vector_erase(vec);
+	free(vec->items);
+	vec->items = NULL;
+	vec->capacity = 0;
+}
+
+/**
+ * @brief Checks if a vector is empty.
+ *
+ * @param[in]      vec            pointer to a vector object.
+ *
+ * @return 1 if vector is empty, otherwise the function returns 0.
+ */
+static inline int vector_is_empty(const struct vector *vec)
+{
+	return (vec->count == 0);
+}
+
+#endif				/* _VECTOR_H_INCLUDED_ */
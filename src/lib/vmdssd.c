@@ -65,7 +65,7 @@ char *vmdssd_get_domain(const char *path)
 	char domain_path[PATH_MAX], real_domain_path[PATH_MAX];
 
 	snprintf(domain_path, PATH_MAX, "%s/%s/domain",
-		 SYSFS_VMD, basename(path));
+		 sysfs_path(SYSFS_VMD), basename(path));
 	if (realpath(domain_path, real_domain_path) == NULL)
 		return NULL;
 
@@ -82,7 +82,7 @@ bool vmdssd_check_slot_module(struct led_ctx *ctx, const char *slot_path)
 		return false;
 
 	// check if slot address contains vmd domain
-	list_for_each(sysfs_get_cntrl_devices(ctx), cntrl) {
+	vector_for_each(sysfs_get_cntrl_devices(ctx), cntrl) {
 		if (cntrl->cntrl_type == LED_CNTRL_TYPE_VMD) {
 			if (cntrl->domain[0] == '\0')
 				continue;
@@ -106,11 +106,7 @@ struct pci_slot *vmdssd_find_pci_slot(struct led_ctx *ctx, char *device_path)
 	if (!pci_addr)
 		return NULL;
 
-	list_for_each(sysfs_get_pci_slots(ctx), slot) {
-		if (strcmp(slot->address, pci_addr) == 0)
-			break;
-		slot = NULL;
-	}
+	slot = hash_map_find(&ctx->sys.pci_slot_map, pci_addr);
 	free(pci_addr);
 	if (slot == NULL || !vmdssd_check_slot_module(ctx, slot->sysfs_path))
 		return NULL;
@@ -120,8 +116,18 @@ struct pci_slot *vmdssd_find_pci_slot(struct led_ctx *ctx, char *device_path)
 
 enum led_ibpi_pattern vmdssd_get_attention(struct pci_slot *slot)
 {
-	int attention = get_int(slot->sysfs_path, -1, "attention");
 	const struct ibpi2value *ibpi2val;
+	int attention;
+
+	/* Take the cached value unless a pending notification voids it. */
+	pci_slot_attention_drain(slot->ctx);
+	if (slot->attention_wd >= 0 && slot->attention_valid) {
+		attention = slot->attention;
+	} else {
+		attention = get_int(slot->sysfs_path, -1, "attention");
+		slot->attention = attention;
+		slot->attention_valid = 1;
+	}
 
 	if (attention == -1)
 		return LED_IBPI_PATTERN_UNKNOWN;
@@ -158,6 +164,10 @@ status_t vmdssd_write_attention_buf(struct pci_slot *slot, enum led_ibpi_pattern
 			"%s write error: %d\n", slot->sysfs_path, errno);
 		return STATUS_FILE_WRITE_ERROR;
 	}
+	/* Remember what was written, the readback below is debug only. */
+	slot->attention = val;
+	slot->attention_valid = 1;
+
 	lib_log(slot->ctx, LED_LOG_LEVEL_DEBUG,
 		"%s after: 0x%x\n", slot->address,
 		(unsigned int)get_int(slot->sysfs_path, 0, "attention"));
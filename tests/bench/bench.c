@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 Intel Corporation.
+
+/*
+ * Micro-benchmarks for the scan and flush hot paths. The program prints one
+ * line per benchmark with the iteration count, total wall time and the cost
+ * per operation, so regressions between releases can be tracked with plain
+ * numbers. Run it manually from the build tree:
+ *
+ *    tests/bench/led_bench [scale]
+ *
+ * The optional scale factor multiplies the iteration counts. The scan
+ * benchmark works against the sysfs of the running host by default; point
+ * LEDMON_SYSFS_ROOT at an extracted snapshot (see sysfs-snapshot.sh) to
+ * replay a recorded topology deterministically. All other benchmarks run on
+ * synthetic data and need no hardware.
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <led/libled.h>
+
+#include <lib/block.h>
+#include <lib/cntrl.h>
+#include <lib/hashmap.h>
+#include <lib/list.h>
+#include <lib/ses.h>
+#include <lib/strpool.h>
+#include <lib/utils.h>
+
+/**
+ * Synthetic device count used by the model benchmarks. Roughly the largest
+ * enclosure population the tools are expected to manage.
+ */
+#define BENCH_DEVICES	1024
+
+/**
+ * Slots per synthetic SES enclosure in the message-build benchmark.
+ */
+#define BENCH_SES_SLOTS	64
+
+static uint64_t _now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void _report(const char *name, uint64_t ops, uint64_t ns)
+{
+	printf("%-28s %12llu ops %10.3f ms %10.1f ns/op\n", name,
+	       (unsigned long long)ops, ns / 1e6, (double)ns / ops);
+}
+
+static void _make_path(char *buf, size_t size, unsigned int i)
+{
+	snprintf(buf, size,
+		 "/sys/devices/pci0000:00/0000:00:%02x.0/host%u/target%u:0:0/%u:0:0:0/block/sd%c%c",
+		 i & 0xff, i, i, i, 'a' + (i / 26) % 26, 'a' + i % 26);
+}
+
+/**
+ * @brief Times list_append()/list_for_each() on the raw list.
+ */
+static void bench_list(unsigned long scale)
+{
+	uint64_t ops = 100000ULL * scale;
+	uint64_t start, append_ns, walk_ns;
+	unsigned long i, r;
+	struct list l;
+	char *item;
+
+	list_init(&l, NULL);
+
+	start = _now_ns();
+	for (i = 0; i < ops; i++)
+		list_append(&l, (void *)(uintptr_t)(i + 1));
+	append_ns = _now_ns() - start;
+
+	start = _now_ns();
+	for (r = 0; r < 100; r++)
+		list_for_each(&l, item)
+			(void)item;
+	walk_ns = _now_ns() - start;
+
+	/* Items are synthetic cast integers, drop the nodes only. */
+	list_clear(&l);
+
+	_report("list_append", ops, append_ns);
+	_report("list_for_each", ops * 100, walk_ns);
+}
+
+/**
+ * @brief Times hash map insert and lookup with sysfs-like path keys.
+ */
+static void bench_hash_map(unsigned long scale)
+{
+	uint64_t lookups = 100000ULL * scale;
+	uint64_t start, insert_ns, find_ns;
+	struct hash_map map;
+	char path[PATH_MAX];
+	unsigned long i;
+
+	hash_map_init(&map);
+
+	start = _now_ns();
+	for (i = 0; i < BENCH_DEVICES; i++) {
+		_make_path(path, sizeof(path), i);
+		hash_map_insert(&map, path, (void *)(uintptr_t)(i + 1));
+	}
+	insert_ns = _now_ns() - start;
+
+	start = _now_ns();
+	for (i = 0; i < lookups; i++) {
+		_make_path(path, sizeof(path), i % BENCH_DEVICES);
+		if (!hash_map_find(&map, path)) {
+			fprintf(stderr, "hash_map: lost key %s\n", path);
+			exit(EXIT_FAILURE);
+		}
+	}
+	find_ns = _now_ns() - start;
+
+	hash_map_fini(&map);
+
+	_report("hash_map_insert", BENCH_DEVICES, insert_ns);
+	_report("hash_map_find", lookups, find_ns);
+}
+
+/**
+ * @brief Times path interning, both the miss (first) and hit (hot) path.
+ */
+static void bench_str_pool(unsigned long scale)
+{
+	uint64_t hits = 100000ULL * scale;
+	uint64_t start, miss_ns, hit_ns;
+	struct str_pool pool;
+	char path[PATH_MAX];
+	unsigned long i;
+
+	str_pool_init(&pool);
+
+	start = _now_ns();
+	for (i = 0; i < BENCH_DEVICES; i++) {
+		_make_path(path, sizeof(path), i);
+		str_pool_intern(&pool, path);
+	}
+	miss_ns = _now_ns() - start;
+
+	start = _now_ns();
+	for (i = 0; i < hits; i++) {
+		_make_path(path, sizeof(path), i % BENCH_DEVICES);
+		str_pool_intern(&pool, path);
+	}
+	hit_ns = _now_ns() - start;
+
+	str_pool_fini(&pool);
+
+	_report("str_pool_intern miss", BENCH_DEVICES, miss_ns);
+	_report("str_pool_intern hit", hits, hit_ns);
+}
+
+/**
+ * @brief Times the merge step of the monitor scan loop.
+ *
+ * Models what ledmon's _add_block() does per scanned device: an index lookup
+ * by sysfs path followed by block_compare() against the stored device.
+ */
+static void bench_block_merge(unsigned long scale)
+{
+	uint64_t rounds = 100ULL * scale;
+	struct block_device *devices;
+	struct cntrl_device cntrl;
+	struct str_pool pool;
+	struct hash_map map;
+	char path[PATH_MAX];
+	uint64_t start, ns;
+	unsigned long i, r;
+
+	memset(&cntrl, 0, sizeof(cntrl));
+	cntrl.cntrl_type = LED_CNTRL_TYPE_AHCI;
+
+	devices = calloc(BENCH_DEVICES, sizeof(*devices));
+	if (!devices) {
+		fprintf(stderr, "bench: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	str_pool_init(&pool);
+	hash_map_init(&map);
+	for (i = 0; i < BENCH_DEVICES; i++) {
+		_make_path(path, sizeof(path), i);
+		devices[i].sysfs_path = str_pool_intern(&pool, path);
+		devices[i].cntrl = &cntrl;
+		devices[i].host_id = i;
+		hash_map_insert(&map, path, &devices[i]);
+	}
+
+	start = _now_ns();
+	for (r = 0; r < rounds; r++)
+		for (i = 0; i < BENCH_DEVICES; i++) {
+			struct block_device *temp;
+
+			_make_path(path, sizeof(path), i);
+			temp = hash_map_find(&map, path);
+			if (!temp || !block_compare(temp, &devices[i])) {
+				fprintf(stderr, "bench: merge miss %s\n",
+					path);
+				exit(EXIT_FAILURE);
+			}
+		}
+	ns = _now_ns() - start;
+
+	hash_map_fini(&map);
+	str_pool_fini(&pool);
+	free(devices);
+
+	_report("block merge", rounds * BENCH_DEVICES, ns);
+}
+
+/**
+ * @brief Times SES control message builds against a synthetic enclosure.
+ */
+static void bench_ses_write_msg(unsigned long scale)
+{
+	uint64_t ops = 100000ULL * scale;
+	struct type_descriptor_header type = {
+		.element_type = SES_ARRAY_DEVICE_SLOT,
+		.num_of_elements = BENCH_SES_SLOTS,
+	};
+	struct ses_pages sp;
+	uint64_t start, ns;
+	unsigned long i;
+
+	memset(&sp, 0, sizeof(sp));
+	sp.page1_types = &type;
+	sp.page1_types_len = 1;
+	sp.page2.len = 8 + 4 * (BENCH_SES_SLOTS + 1);
+
+	start = _now_ns();
+	for (i = 0; i < ops; i++)
+		if (ses_write_msg(LED_IBPI_PATTERN_LOCATE, &sp,
+				  i % BENCH_SES_SLOTS) != STATUS_SUCCESS) {
+			fprintf(stderr, "bench: ses_write_msg failed\n");
+			exit(EXIT_FAILURE);
+		}
+	ns = _now_ns() - start;
+
+	_report("ses_write_msg", ops, ns);
+}
+
+/**
+ * @brief Times a cold and a warm library scan against the host sysfs.
+ */
+static void bench_scan(void)
+{
+	struct led_ctx *ctx;
+	uint64_t start, cold_ns, warm_ns;
+
+	if (led_new(&ctx) != LED_STATUS_SUCCESS) {
+		fprintf(stderr, "bench: unable to initialize library\n");
+		return;
+	}
+
+	start = _now_ns();
+	if (led_scan(ctx) != LED_STATUS_SUCCESS) {
+		fprintf(stderr, "bench: led_scan failed\n");
+		led_free(ctx);
+		return;
+	}
+	cold_ns = _now_ns() - start;
+
+	start = _now_ns();
+	led_scan(ctx);
+	warm_ns = _now_ns() - start;
+
+	led_free(ctx);
+
+	_report("led_scan cold", 1, cold_ns);
+	_report("led_scan warm", 1, warm_ns);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long scale = 1;
+
+	if (argc > 1) {
+		scale = strtoul(argv[1], NULL, 10);
+		if (scale < 1)
+			scale = 1;
+	}
+
+	bench_list(scale);
+	bench_hash_map(scale);
+	bench_str_pool(scale);
+	bench_block_merge(scale);
+	bench_ses_write_msg(scale);
+	bench_scan();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#!/usr/bin/bash
+
+# SPDX-License-Identifier: GPL-3.0-or-later
+# Copyright (C) 2026 Intel Corporation.
+
+# Records the sysfs subtrees libled scans into a tarball, so a production
+# topology can be replayed on another machine:
+#
+#    ./sysfs-snapshot.sh host-topology.tar.gz          # on the real host
+#
+#    mkdir snap && tar -C snap -xf host-topology.tar.gz
+#    LEDMON_SYSFS_ROOT=$PWD/snap ledctl --list-controllers
+#
+# Every libled sysfs access honours LEDMON_SYSFS_ROOT (see sysfs_path() in
+# src/lib/utils.c), so scans against an extracted snapshot are deterministic
+# and can be benchmarked, profiled and bisected without the hardware.
+#
+# Attribute values are captured with a bounded read, because some sysfs
+# attributes block or are write-only; unreadable ones are recorded empty.
+
+set -u
+
+OUT=${1:?usage: $0 <output.tar.gz>}
+STAGE=$(mktemp -d)
+trap 'rm -rf "$STAGE"' EXIT
+
+# Subtrees the library scans, see src/lib/sysfs.c and the controller modules.
+ROOTS="/sys/block
+/sys/class/enclosure
+/sys/class/sas_end_device
+/sys/bus/pci/slots
+/sys/bus/pci/devices
+/sys/bus/pci/drivers/vmd
+/sys/module/pciehp
+/sys/module/libahci
+/sys/class/dmi/id"
+
+declare -A RECORDED
+
+copy_attr() {
+	mkdir -p "$STAGE${1%/*}"
+	timeout 2 dd if="$1" of="$STAGE$1" bs=4096 count=1 status=none \
+		2>/dev/null || : > "$STAGE$1"
+}
+
+copy_link() {
+	mkdir -p "$STAGE${1%/*}"
+	cp -P "$1" "$STAGE$1" 2>/dev/null || :
+}
+
+# Plain attributes and symlinks of a single directory, non-recursive.
+copy_dir_attrs() {
+	local f
+
+	[ -n "${RECORDED[$1]:-}" ] && return
+	RECORDED[$1]=1
+	mkdir -p "$STAGE$1"
+	for f in "$1"/*; do
+		if [ -L "$f" ]; then
+			copy_link "$f"
+		elif [ -f "$f" ]; then
+			copy_attr "$f"
+		fi
+	done
+}
+
+# A whole subtree, links preserved, oversized files skipped.
+copy_tree() {
+	local f
+
+	[ -n "${RECORDED[$1]:-}" ] && return
+	RECORDED[$1]=1
+	find "$1" -type d 2>/dev/null | while read -r f; do
+		mkdir -p "$STAGE$f"
+	done
+	find "$1" -type l 2>/dev/null | while read -r f; do
+		copy_link "$f"
+	done
+	find "$1" -type f -size -16k 2>/dev/null | while read -r f; do
+		copy_attr "$f"
+	done
+}
+
+# The device subtree a class entry resolves to, plus the attributes of its
+# ancestors - the library climbs from a device towards its controller.
+record_device() {
+	local d
+
+	d=$(realpath "$1" 2>/dev/null) || return
+	copy_tree "$d"
+	d=${d%/*}
+	while [ "${d%/*}" != "/" ] && [ "$d" != "/sys" ]; do
+		copy_dir_attrs "$d"
+		d=${d%/*}
+	done
+}
+
+for root in $ROOTS; do
+	[ -d "$root" ] || continue
+	echo "recording $root"
+	copy_tree "$root"
+	for entry in "$root"/*; do
+		[ -L "$entry" ] && record_device "$entry"
+	done
+done
+
+tar -C "$STAGE" -czf "$OUT" sys
+echo "snapshot written to $OUT"